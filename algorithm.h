@@ -10,10 +10,10 @@
 
 namespace mmm {
 
-/***********equal(begin1,end1,begin)****************/
+/***********equal(begin1,end1,begin) 考虑分段迭代器****************/
 
 template <class InputIt1, class InputIt2>
-bool equal(InputIt1 first1, InputIt1 last1, InputIt2 first2) {
+bool _equal_loop(InputIt1 &first1, InputIt1 last1, InputIt2 &first2) {
   for (; first1 != last1; ++first1, ++first2) {
     if (!(*first1 == *first2)) {
       return false;
@@ -22,6 +22,67 @@ bool equal(InputIt1 first1, InputIt1 last1, InputIt2 first2) {
   return true;
 }
 
+//[first1,last1)是连续内存, first2按段推进
+template <class T, class InputIt2>
+bool _equal_seg2(T *first1, T *last1, InputIt2 &first2, false_type) {
+  return _equal_loop(first1, last1, first2);
+}
+template <class T, class InputIt2>
+bool _equal_seg2(T *first1, T *last1, InputIt2 &first2, true_type) {
+  typedef segmented_iterator_traits<InputIt2> traits;
+  //空区间不能进循环: first2可能是end(), 其段为空, 往后走会越界
+  if (first1 == last1)
+    return true;
+  auto seg = traits::segment(first2);
+  auto local = traits::local(first2);
+  while (true) {
+    const auto n = last1 - first1;
+    const auto room = traits::end(seg) - local;
+    if (n < room) {
+      bool ok = _equal_loop(first1, last1, local);
+      first2 = traits::compose(seg, local);
+      return ok;
+    }
+    if (!_equal_loop(first1, first1 + room, local))
+      return false;
+    ++seg;
+    local = traits::begin(seg);
+    if (first1 == last1) {
+      first2 = traits::compose(seg, local);
+      return true;
+    }
+  }
+}
+
+template <class InputIt1, class InputIt2>
+bool _equal(InputIt1 first1, InputIt1 last1, InputIt2 &first2, false_type) {
+  return _equal_loop(first1, last1, first2);
+}
+template <class T, class InputIt2>
+bool _equal(T *first1, T *last1, InputIt2 &first2, false_type) {
+  return _equal_seg2(first1, last1, first2, is_segmented_iterator<InputIt2>());
+}
+template <class InputIt1, class InputIt2>
+bool _equal(InputIt1 first1, InputIt1 last1, InputIt2 &first2, true_type) {
+  typedef segmented_iterator_traits<InputIt1> traits;
+  auto sf = traits::segment(first1), sl = traits::segment(last1);
+  if (sf == sl)
+    return _equal(traits::local(first1), traits::local(last1), first2,
+                  false_type());
+  if (!_equal(traits::local(first1), traits::end(sf), first2, false_type()))
+    return false;
+  for (++sf; sf != sl; ++sf) {
+    if (!_equal(traits::begin(sf), traits::end(sf), first2, false_type()))
+      return false;
+  }
+  return _equal(traits::begin(sl), traits::local(last1), first2, false_type());
+}
+
+template <class InputIt1, class InputIt2>
+bool equal(InputIt1 first1, InputIt1 last1, InputIt2 first2) {
+  return _equal(first1, last1, first2, is_segmented_iterator<InputIt1>());
+}
+
 template <class InputIt1, class InputIt2, class BinaryPredicate>
 bool equal(InputIt1 first1, InputIt1 last1, InputIt2 first2,
            BinaryPredicate p) {
@@ -80,33 +141,285 @@ OutputIterator fill_n(OutputIterator first, Size n, const T &value) {
   return first; //返回最后赋值元素后一位置的迭代
 }
 
+/*************fill(first,last,value) 考虑分段迭代器, 单字节类型用memset*********/
 template <class ForwardIterator, class T>
-void fill(ForwardIterator first, ForwardIterator last, const T &value) {
+void _fill_leaf(ForwardIterator first, ForwardIterator last, const T &value) {
   for (; first != last; ++first)
     *first = value;
 }
+template <class T> void _fill_leaf(char *first, char *last, const T &value) {
+  memset(first, static_cast<unsigned char>(value), last - first);
+}
+template <class T>
+void _fill_leaf(signed char *first, signed char *last, const T &value) {
+  memset(first, static_cast<unsigned char>(value), last - first);
+}
+template <class T>
+void _fill_leaf(unsigned char *first, unsigned char *last, const T &value) {
+  memset(first, static_cast<unsigned char>(value), last - first);
+}
 
-/***********copy(it1,it2,dest_it) 考虑平凡/非平凡类型构造****************/
+template <class ForwardIterator, class T>
+void _fill(ForwardIterator first, ForwardIterator last, const T &value,
+           false_type) {
+  _fill_leaf(first, last, value);
+}
+template <class ForwardIterator, class T>
+void _fill(ForwardIterator first, ForwardIterator last, const T &value,
+           true_type) {
+  typedef segmented_iterator_traits<ForwardIterator> traits;
+  auto sf = traits::segment(first), sl = traits::segment(last);
+  if (sf == sl) {
+    _fill_leaf(traits::local(first), traits::local(last), value);
+    return;
+  }
+  _fill_leaf(traits::local(first), traits::end(sf), value);
+  for (++sf; sf != sl; ++sf)
+    _fill_leaf(traits::begin(sf), traits::end(sf), value);
+  _fill_leaf(traits::begin(sl), traits::local(last), value);
+}
+
+template <class ForwardIterator, class T>
+void fill(ForwardIterator first, ForwardIterator last, const T &value) {
+  _fill(first, last, value, is_segmented_iterator<ForwardIterator>());
+}
+
+/***********copy(it1,it2,dest_it) 考虑平凡/非平凡类型构造及分段迭代器****************/
 //指向目标范围中最后复制元素的下个元素的输出迭代器。
+//分段迭代器先按输入的段拆开, 再按输出的段拆开, 最终落到指针到指针的复制,
+//平凡类型的指针复制使用memmove.
 
 template <class InputIterator, class OutputIterator>
-OutputIterator copy(InputIterator first, InputIterator last,
-                    OutputIterator result) {
+OutputIterator _copy_loop(InputIterator first, InputIterator last,
+                          OutputIterator result) {
   while (first != last) {
     *result++ = *first++;
   }
   return result;
 }
+template <class T>
+T *_copy_trivial(const T *first, const T *last, T *result, true_type) {
+  const size_t n = last - first;
+  if (n != 0)
+    memmove(result, first, n * sizeof(T));
+  return result + n;
+}
+template <class T>
+T *_copy_trivial(const T *first, const T *last, T *result, false_type) {
+  return _copy_loop(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_leaf(InputIterator first, InputIterator last,
+                          OutputIterator result) {
+  return _copy_loop(first, last, result);
+}
+template <class T> T *_copy_leaf(const T *first, const T *last, T *result) {
+  return _copy_trivial(first, last, result, is_pod<T>());
+}
+template <class T> T *_copy_leaf(T *first, T *last, T *result) {
+  return _copy_trivial<T>(first, last, result, is_pod<T>());
+}
 
+//输出为分段迭代器: 每次填满一个目标段
 template <class InputIterator, class OutputIterator>
-OutputIterator copy_backward(InputIterator first, InputIterator last,
-                             OutputIterator result) {
+OutputIterator _copy_out_seg(InputIterator first, InputIterator last,
+                             OutputIterator result, input_iterator_tag) {
+  return _copy_loop(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_out_seg(InputIterator first, InputIterator last,
+                             OutputIterator result,
+                             random_access_iterator_tag) {
+  typedef segmented_iterator_traits<OutputIterator> traits;
+  if (first == last)
+    return result;
+  auto seg = traits::segment(result);
+  auto local = traits::local(result);
+  while (true) {
+    const auto n = last - first;
+    const auto room = traits::end(seg) - local;
+    if (n < room)
+      return traits::compose(seg, _copy_leaf(first, last, local));
+    _copy_leaf(first, first + room, local);
+    first += room;
+    ++seg;
+    local = traits::begin(seg);
+    if (first == last)
+      return traits::compose(seg, local);
+  }
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_out(InputIterator first, InputIterator last,
+                         OutputIterator result, false_type) {
+  return _copy_leaf(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_out(InputIterator first, InputIterator last,
+                         OutputIterator result, true_type) {
+  return _copy_out_seg(first, last, result, iterator_category<InputIterator>());
+}
 
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy(InputIterator first, InputIterator last,
+                     OutputIterator result, false_type) {
+  return _copy_out(first, last, result,
+                   is_segmented_iterator<OutputIterator>());
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy(InputIterator first, InputIterator last,
+                     OutputIterator result, true_type) {
+  typedef segmented_iterator_traits<InputIterator> traits;
+  auto sf = traits::segment(first), sl = traits::segment(last);
+  if (sf == sl)
+    return _copy(traits::local(first), traits::local(last), result,
+                 false_type());
+  result = _copy(traits::local(first), traits::end(sf), result, false_type());
+  for (++sf; sf != sl; ++sf)
+    result = _copy(traits::begin(sf), traits::end(sf), result, false_type());
+  return _copy(traits::begin(sl), traits::local(last), result, false_type());
+}
+
+template <class InputIterator, class OutputIterator>
+OutputIterator copy(InputIterator first, InputIterator last,
+                    OutputIterator result) {
+  return _copy(first, last, result, is_segmented_iterator<InputIterator>());
+}
+
+/***********copy_backward: 与copy对称, 从尾部逐段向前****************/
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_loop(InputIterator first, InputIterator last,
+                                   OutputIterator result) {
   while (first != last) {
     *(--result) = *(--last);
   }
   return result;
 }
+template <class T>
+T *_copy_backward_trivial(const T *first, const T *last, T *result,
+                          true_type) {
+  const size_t n = last - first;
+  if (n != 0)
+    memmove(result - n, first, n * sizeof(T));
+  return result - n;
+}
+template <class T>
+T *_copy_backward_trivial(const T *first, const T *last, T *result,
+                          false_type) {
+  return _copy_backward_loop(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_leaf(InputIterator first, InputIterator last,
+                                   OutputIterator result) {
+  return _copy_backward_loop(first, last, result);
+}
+template <class T>
+T *_copy_backward_leaf(const T *first, const T *last, T *result) {
+  return _copy_backward_trivial(first, last, result, is_pod<T>());
+}
+template <class T> T *_copy_backward_leaf(T *first, T *last, T *result) {
+  return _copy_backward_trivial<T>(first, last, result, is_pod<T>());
+}
+
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_out_seg(InputIterator first, InputIterator last,
+                                      OutputIterator result,
+                                      bidirectional_iterator_tag) {
+  return _copy_backward_loop(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_out_seg(InputIterator first, InputIterator last,
+                                      OutputIterator result,
+                                      random_access_iterator_tag) {
+  typedef segmented_iterator_traits<OutputIterator> traits;
+  auto seg = traits::segment(result);
+  auto local = traits::local(result);
+  while (first != last) {
+    if (local == traits::begin(seg)) {
+      --seg;
+      local = traits::end(seg);
+    }
+    auto n = last - first;
+    const auto room = local - traits::begin(seg);
+    if (n > room)
+      n = room;
+    local = _copy_backward_leaf(last - n, last, local);
+    last -= n;
+  }
+  return traits::compose(seg, local);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_out(InputIterator first, InputIterator last,
+                                  OutputIterator result, false_type) {
+  return _copy_backward_leaf(first, last, result);
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward_out(InputIterator first, InputIterator last,
+                                  OutputIterator result, true_type) {
+  return _copy_backward_out_seg(first, last, result,
+                                iterator_category<InputIterator>());
+}
+
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward(InputIterator first, InputIterator last,
+                              OutputIterator result, false_type) {
+  return _copy_backward_out(first, last, result,
+                            is_segmented_iterator<OutputIterator>());
+}
+template <class InputIterator, class OutputIterator>
+OutputIterator _copy_backward(InputIterator first, InputIterator last,
+                              OutputIterator result, true_type) {
+  typedef segmented_iterator_traits<InputIterator> traits;
+  auto sf = traits::segment(first), sl = traits::segment(last);
+  if (sf == sl)
+    return _copy_backward(traits::local(first), traits::local(last), result,
+                          false_type());
+  result = _copy_backward(traits::begin(sl), traits::local(last), result,
+                          false_type());
+  for (--sl; sl != sf; --sl)
+    result = _copy_backward(traits::begin(sl), traits::end(sl), result,
+                            false_type());
+  return _copy_backward(traits::local(first), traits::end(sf), result,
+                        false_type());
+}
+
+template <class InputIterator, class OutputIterator>
+OutputIterator copy_backward(InputIterator first, InputIterator last,
+                             OutputIterator result) {
+  return _copy_backward(first, last, result,
+                        is_segmented_iterator<InputIterator>());
+}
+
+/**********for_each(first,last,f) 考虑分段迭代器*******************/
+template <class InputIterator, class Function>
+void _for_each_leaf(InputIterator first, InputIterator last, Function &f) {
+  for (; first != last; ++first)
+    f(*first);
+}
+template <class InputIterator, class Function>
+void _for_each(InputIterator first, InputIterator last, Function &f,
+               false_type) {
+  _for_each_leaf(first, last, f);
+}
+template <class InputIterator, class Function>
+void _for_each(InputIterator first, InputIterator last, Function &f,
+               true_type) {
+  typedef segmented_iterator_traits<InputIterator> traits;
+  auto sf = traits::segment(first), sl = traits::segment(last);
+  if (sf == sl) {
+    _for_each_leaf(traits::local(first), traits::local(last), f);
+    return;
+  }
+  _for_each_leaf(traits::local(first), traits::end(sf), f);
+  for (++sf; sf != sl; ++sf)
+    _for_each_leaf(traits::begin(sf), traits::end(sf), f);
+  _for_each_leaf(traits::begin(sl), traits::local(last), f);
+}
+
+template <class InputIterator, class Function>
+Function for_each(InputIterator first, InputIterator last, Function f) {
+  _for_each(first, last, f, is_segmented_iterator<InputIterator>());
+  return f;
+}
 
 /*********堆: this is for priorty queue****************/
 //部分函数发生ADL查找，应限定命名空间
@@ -223,14 +536,62 @@ bool is_heap(RandomIterator first, RandomIterator last) {
 /**********find(it1,it2,val)*******************/
 
 //指向首个满足条件的迭代器，或若找不到这种元素则为 last 。
+//分段迭代器逐段查找, 单字节类型的段内查找用memchr.
 template <class InputIterator, class T>
-InputIterator find(InputIterator first, InputIterator last, const T &val) {
+InputIterator _find_leaf(InputIterator first, InputIterator last,
+                         const T &val) {
   for (; first != last; ++first) {
     if (*first == val)
       return first;
   }
   return last;
 }
+template <class T>
+const char *_find_char(const char *first, const char *last, const T &val) {
+  if (!(char(val) == val))
+    return last;
+  const void *p = memchr(first, static_cast<unsigned char>(val), last - first);
+  return p ? static_cast<const char *>(p) : last;
+}
+template <class T> char *_find_leaf(char *first, char *last, const T &val) {
+  return const_cast<char *>(_find_char(first, last, val));
+}
+template <class T>
+const char *_find_leaf(const char *first, const char *last, const T &val) {
+  return _find_char(first, last, val);
+}
+
+template <class InputIterator, class T>
+InputIterator _find(InputIterator first, InputIterator last, const T &val,
+                    false_type) {
+  return _find_leaf(first, last, val);
+}
+template <class InputIterator, class T>
+InputIterator _find(InputIterator first, InputIterator last, const T &val,
+                    true_type) {
+  typedef segmented_iterator_traits<InputIterator> traits;
+  auto sf = traits::segment(first), sl = traits::segment(last);
+  if (sf == sl)
+    return traits::compose(
+        sf, _find_leaf(traits::local(first), traits::local(last), val));
+  auto seg_end = traits::end(sf);
+  auto pos = _find_leaf(traits::local(first), seg_end, val);
+  if (pos != seg_end)
+    return traits::compose(sf, pos);
+  for (++sf; sf != sl; ++sf) {
+    seg_end = traits::end(sf);
+    pos = _find_leaf(traits::begin(sf), seg_end, val);
+    if (pos != seg_end)
+      return traits::compose(sf, pos);
+  }
+  return traits::compose(
+      sl, _find_leaf(traits::begin(sl), traits::local(last), val));
+}
+
+template <class InputIterator, class T>
+InputIterator find(InputIterator first, InputIterator last, const T &val) {
+  return _find(first, last, val, is_segmented_iterator<InputIterator>());
+}
 
 template <class InputIt, class UnaryPredicate>
 InputIt find_if(InputIt first, InputIt last, UnaryPredicate p) {
@@ -316,8 +677,8 @@ void quicksort(ForwardIterator first, ForwardIterator last,
       [pivot, cmp](const iterator_value_type<ForwardIterator> &em) {
         return !cmp(pivot, em);
       }); // em >= pivot 使用<. 因为可能没有实现其他操作.
-  quicksort(first, middle1);
-  quicksort(middle2, last);
+  quicksort(first, middle1, cmp);
+  quicksort(middle2, last, cmp);
 }
 
 // https://stackoverflow.com/questions/2447458/default-template-arguments-for-function-templates
@@ -3,8 +3,10 @@
 
 #include "alloc.h"
 #include "construct.h"
+#include <atomic>
 #include <new>
 #include <stdlib.h>
+#include <thread>
 
 namespace mmm{
 
@@ -37,6 +39,49 @@ namespace mmm{
 		}
 	};
 
+	//allocator_alloc的加锁版本: alloc的内存池本身不是线程安全的,
+	//多个线程同时分配/释放(如并发队列的节点)时用这个. 所有类型共用一把自旋锁.
+	struct alloc_lock{
+		static std::atomic_flag &flag(){
+			static std::atomic_flag f = ATOMIC_FLAG_INIT;
+			return f;
+		}
+		alloc_lock(){
+			while (flag().test_and_set(std::memory_order_acquire))
+				std::this_thread::yield();
+		}
+		~alloc_lock(){ flag().clear(std::memory_order_release); }
+	};
+
+	template<class T>
+	class locked_allocator_alloc{
+	public:
+		typedef T			value_type;
+		typedef T*			pointer;
+		typedef const T*	const_pointer;
+		typedef T&			reference;
+		typedef const T&	const_reference;
+		typedef size_t		size_type;
+		typedef ptrdiff_t	difference_type;
+	public:
+		static T* allocate(){
+			alloc_lock lock;
+			return allocator_alloc<T>::allocate();
+		}
+		static T* allocate(size_t n){
+			alloc_lock lock;
+			return allocator_alloc<T>::allocate(n);
+		}
+		static void deallocate(T *ptr){
+			alloc_lock lock;
+			allocator_alloc<T>::deallocate(ptr);
+		}
+		static void deallocate(T *ptr, size_t n){
+			alloc_lock lock;
+			allocator_alloc<T>::deallocate(ptr, n);
+		}
+	};
+
 	template<class T>
 	class allocator{
 	public:
@@ -63,6 +108,20 @@ namespace mmm{
 			free(ptr);
 		}
 	};
+
+	//以上分配器都没有状态, 任意两个实例可以互相释放对方分配的内存
+	template<class T, class U>
+	inline bool operator==(const allocator_alloc<T>&, const allocator_alloc<U>&){ return true; }
+	template<class T, class U>
+	inline bool operator!=(const allocator_alloc<T>&, const allocator_alloc<U>&){ return false; }
+	template<class T, class U>
+	inline bool operator==(const locked_allocator_alloc<T>&, const locked_allocator_alloc<U>&){ return true; }
+	template<class T, class U>
+	inline bool operator!=(const locked_allocator_alloc<T>&, const locked_allocator_alloc<U>&){ return false; }
+	template<class T, class U>
+	inline bool operator==(const allocator<T>&, const allocator<U>&){ return true; }
+	template<class T, class U>
+	inline bool operator!=(const allocator<T>&, const allocator<U>&){ return false; }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,259 @@
+#ifndef _BLOCKING_QUEUE_H_
+#define _BLOCKING_QUEUE_H_
+
+#include "deque.h"
+#include "iterator.h"
+#include "utility.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+
+namespace mmm {
+
+// blocking_queue: 加锁的阻塞队列, 底层为mmm::deque.
+// 空时消费者睡眠, 满时(max_size() != 0)生产者睡眠.
+// push_bulk/pop_bulk一次加锁搬运多个元素, 用来摊薄同步开销.
+// close()之后不再接受新元素, 已有元素仍可取出; 取空之后pop系列返回false/0.
+// 只有登记了等待者时才notify, 没人睡眠时不会进入条件变量.
+template <class T> class blocking_queue {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  size_type pop_waiters_;
+  size_type push_waiters_;
+  mmm::deque<T> container_;
+  size_type max_size_; // 0: 无界
+  bool closed_;
+
+public:
+  explicit blocking_queue(size_type max_size = 0)
+      : pop_waiters_(0), push_waiters_(0), max_size_(max_size),
+        closed_(false) {}
+  blocking_queue(const blocking_queue &) = delete;
+  blocking_queue &operator=(const blocking_queue &) = delete;
+
+  //生产者. 队列已关闭时返回false
+  bool push(const value_type &val) { return emplace(val); }
+  bool push(value_type &&val) { return emplace(mmm::move(val)); }
+  template <class... Args> bool emplace(Args &&... args);
+  bool try_push(const value_type &val);
+  //放入[first, last), 有界时按空位分批; 返回放入的个数(只有关闭时才会少于全部)
+  template <class InputIterator>
+  size_type push_bulk(InputIterator first, InputIterator last);
+
+  //消费者. 队列已关闭且为空时返回false
+  bool pop_wait(value_type &out);
+  template <class Rep, class Period>
+  bool pop_wait(value_type &out,
+                const std::chrono::duration<Rep, Period> &timeout);
+  bool try_pop(value_type &out);
+  //等到至少有一个元素, 取出最多max个; 关闭且为空时返回0
+  template <class OutputIterator>
+  size_type pop_bulk(OutputIterator out, size_type max);
+  //不等待, 取出当前所有元素
+  template <class OutputIterator> size_type drain(OutputIterator out);
+
+  void close();
+  bool closed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+  }
+  size_type size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return container_.size();
+  }
+  bool empty() const { return size() == 0; }
+  size_type max_size() const noexcept { return max_size_; }
+
+private:
+  bool full() const { return max_size_ != 0 && container_.size() >= max_size_; }
+  size_type room() const {
+    return max_size_ == 0 ? size_type(-1) : max_size_ - container_.size();
+  }
+  //等待直到pred成立, 期间登记为等待者
+  template <class Pred>
+  void wait(std::unique_lock<std::mutex> &lock, std::condition_variable &cv,
+            size_type &waiters, Pred pred) {
+    ++waiters;
+    cv.wait(lock, pred);
+    --waiters;
+  }
+  //取出n个元素, 调用方持有锁
+  template <class OutputIterator>
+  OutputIterator take(OutputIterator out, size_type n) {
+    for (size_type i = 0; i != n; ++i, ++out) {
+      *out = mmm::move(container_.front());
+      container_.pop_front();
+    }
+    return out;
+  }
+  //解锁后按需唤醒
+  void wake_consumers(std::unique_lock<std::mutex> &lock, size_type n) {
+    const size_type waiters = pop_waiters_;
+    lock.unlock();
+    if (waiters == 0)
+      return;
+    if (n == 1)
+      not_empty_.notify_one();
+    else
+      not_empty_.notify_all();
+  }
+  void wake_producers(std::unique_lock<std::mutex> &lock, size_type n) {
+    const size_type waiters = push_waiters_;
+    lock.unlock();
+    if (waiters == 0)
+      return;
+    if (n == 1)
+      not_full_.notify_one();
+    else
+      not_full_.notify_all();
+  }
+
+  template <class InputIterator>
+  void append_n(InputIterator &first, InputIterator last, size_type n,
+                input_iterator_tag) {
+    for (; n != 0 && first != last; --n, ++first)
+      container_.push_back(*first);
+  }
+  template <class ForwardIterator>
+  void append_n(ForwardIterator &first, ForwardIterator last, size_type n,
+                forward_iterator_tag) {
+    ForwardIterator mid = first;
+    for (; n != 0 && mid != last; --n)
+      ++mid;
+    container_.append(first, mid);
+    first = mid;
+  }
+}; // end of blocking_queue
+
+template <class T>
+template <class... Args>
+bool blocking_queue<T>::emplace(Args &&... args) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (full() && !closed_)
+    wait(lock, not_full_, push_waiters_, [this] { return !full() || closed_; });
+  if (closed_)
+    return false;
+  container_.emplace_back(mmm::forward<Args>(args)...);
+  wake_consumers(lock, 1);
+  return true;
+}
+
+template <class T>
+bool blocking_queue<T>::try_push(const value_type &val) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_ || full())
+    return false;
+  container_.push_back(val);
+  wake_consumers(lock, 1);
+  return true;
+}
+
+template <class T>
+template <class InputIterator>
+typename blocking_queue<T>::size_type
+blocking_queue<T>::push_bulk(InputIterator first, InputIterator last) {
+  size_type pushed = 0;
+  while (first != last) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (full() && !closed_)
+      wait(lock, not_full_, push_waiters_,
+           [this] { return !full() || closed_; });
+    if (closed_)
+      break;
+    const size_type before = container_.size();
+    append_n(first, last, room(), iterator_category<InputIterator>());
+    const size_type n = container_.size() - before;
+    pushed += n;
+    wake_consumers(lock, n);
+  }
+  return pushed;
+}
+
+template <class T>
+bool blocking_queue<T>::pop_wait(value_type &out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (container_.empty() && !closed_)
+    wait(lock, not_empty_, pop_waiters_,
+         [this] { return !container_.empty() || closed_; });
+  if (container_.empty())
+    return false;
+  take(&out, 1);
+  wake_producers(lock, 1);
+  return true;
+}
+
+template <class T>
+template <class Rep, class Period>
+bool blocking_queue<T>::pop_wait(
+    value_type &out, const std::chrono::duration<Rep, Period> &timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (container_.empty() && !closed_) {
+    ++pop_waiters_;
+    not_empty_.wait_for(lock, timeout,
+                        [this] { return !container_.empty() || closed_; });
+    --pop_waiters_;
+  }
+  if (container_.empty())
+    return false;
+  take(&out, 1);
+  wake_producers(lock, 1);
+  return true;
+}
+
+template <class T>
+bool blocking_queue<T>::try_pop(value_type &out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (container_.empty())
+    return false;
+  take(&out, 1);
+  wake_producers(lock, 1);
+  return true;
+}
+
+template <class T>
+template <class OutputIterator>
+typename blocking_queue<T>::size_type
+blocking_queue<T>::pop_bulk(OutputIterator out, size_type max) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (container_.empty() && !closed_)
+    wait(lock, not_empty_, pop_waiters_,
+         [this] { return !container_.empty() || closed_; });
+  const size_type n = container_.size() < max ? container_.size() : max;
+  take(out, n);
+  if (n != 0)
+    wake_producers(lock, n);
+  return n;
+}
+
+template <class T>
+template <class OutputIterator>
+typename blocking_queue<T>::size_type
+blocking_queue<T>::drain(OutputIterator out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const size_type n = container_.size();
+  take(out, n);
+  if (n != 0)
+    wake_producers(lock, n);
+  return n;
+}
+
+template <class T> void blocking_queue<T>::close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  closed_ = true;
+  lock.unlock();
+  not_empty_.notify_all();
+  not_full_.notify_all();
+}
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,876 @@
+#ifndef _BTREE_H_
+#define _BTREE_H_
+
+#include "algorithm.h"
+#include "allocator.h"
+#include "iterator.h"
+#include "pair.h"
+#include "type_traits.h"
+#include "utility.h"
+#include <initializer_list>
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+//默认节点大小(字节), 即4条cache line. 数据量很大时可以按页(4096)实例化
+#ifndef _MMM_BTREE_NODE_SIZE
+#define _MMM_BTREE_NODE_SIZE 256
+#endif
+
+// btree: btree_map/btree_set的底层B树. 每个节点存一段有序的值(最多N个),
+// 内部节点另有N+1个孩子, 值同时存在于内部节点和叶子中. 每个节点只有一个父指针,
+// 查找只访问O(log_N n)个节点, 且节点内是连续内存, 比rbtree每个值一个节点
+// (三个指针+颜色)少很多次cache miss, 也省内存.
+// 代价: 插入/删除会在节点内移动元素, 修改之后所有迭代器和元素地址都失效.
+// N由节点大小和sizeof(value_type)推出, 至少为3.
+namespace Detail {
+template <class Value, size_t N> struct btree_node {
+  btree_node *parent;      //根节点为nullptr
+  unsigned short position; //在父节点children中的下标
+  unsigned short count;
+  bool leaf;
+  alignas(Value) unsigned char storage[N * sizeof(Value)];
+
+  Value &value(size_t i) { return reinterpret_cast<Value *>(storage)[i]; }
+  btree_node *&child(size_t i);
+};
+template <class Value, size_t N>
+struct btree_internal_node : public btree_node<Value, N> {
+  btree_node<Value, N> *children[N + 1];
+};
+template <class Value, size_t N>
+inline btree_node<Value, N> *&btree_node<Value, N>::child(size_t i) {
+  return static_cast<btree_internal_node<Value, N> *>(this)->children[i];
+}
+constexpr size_t btree_node_values(size_t node_size, size_t size) {
+  return (node_size - 2 * sizeof(void *)) / size < 3
+             ? 3
+             : (node_size - 2 * sizeof(void *)) / size > 32767
+                   ? 32767
+                   : (node_size - 2 * sizeof(void *)) / size;
+}
+} // namespace Detail
+
+// 迭代器: (节点, 节点内下标). end()是(最右叶子, count), 空树时为(nullptr, 0)
+template <class Value, size_t N, class Ref, class Ptr> struct btree_iterator {
+public:
+  typedef ptrdiff_t difference_type;
+  typedef mmm::bidirectional_iterator_tag iterator_category;
+  typedef Value value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef Detail::btree_node<Value, N> node_type;
+  typedef btree_iterator<Value, N, Value &, Value *> iterator;
+  typedef btree_iterator self;
+
+  node_type *node_;
+  int position_;
+
+public:
+  btree_iterator(node_type *n = nullptr, int pos = 0)
+      : node_(n), position_(pos) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                btree_iterator<Value, N, R, P>, iterator>::value>::type>
+  btree_iterator(const btree_iterator<Value, N, R, P> &other)
+      : node_(other.node_), position_(other.position_) {}
+
+  self &operator++() {
+    if (!node_->leaf) {
+      node_ = node_->child(position_ + 1);
+      while (!node_->leaf)
+        node_ = node_->child(0);
+      position_ = 0;
+    } else if (++position_ == node_->count) {
+      //叶子走完, 向上找第一个还有后继值的祖先; 找不到就停在end()
+      node_type *n = node_;
+      int pos = position_;
+      while (pos == n->count && n->parent) {
+        pos = n->position;
+        n = n->parent;
+      }
+      if (pos != n->count) {
+        node_ = n;
+        position_ = pos;
+      }
+    }
+    return *this;
+  }
+  self operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  self &operator--() {
+    if (!node_->leaf) {
+      node_ = node_->child(position_);
+      while (!node_->leaf)
+        node_ = node_->child(node_->count);
+      position_ = node_->count - 1;
+    } else if (position_ == 0) {
+      while (position_ == 0 && node_->parent) {
+        position_ = node_->position;
+        node_ = node_->parent;
+      }
+      --position_;
+    } else
+      --position_;
+    return *this;
+  }
+  self operator--(int) {
+    auto tmp = *this;
+    --*this;
+    return tmp;
+  }
+  reference operator*() const { return node_->value(position_); }
+  pointer operator->() const { return &(operator*()); }
+  bool operator==(const self &right) const {
+    return node_ == right.node_ && position_ == right.position_;
+  }
+  bool operator!=(const self &right) const { return !(*this == right); }
+};
+
+template <class Key, class Value, class Compare, class ExtractKey,
+          bool bMutableIterators, bool bUniqueKeys,
+          size_t NodeSize = _MMM_BTREE_NODE_SIZE>
+class btree {
+public:
+  static constexpr size_t node_values =
+      Detail::btree_node_values(NodeSize, sizeof(Value));
+
+  typedef Key key_type;
+  typedef Value value_type;
+  typedef Compare key_compare;
+  typedef ExtractKey extract_key;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef value_type &reference;
+  typedef const value_type &const_reference;
+  typedef btree_iterator<Value, node_values, const Value &, const Value *>
+      const_iterator;
+  typedef typename type_select<
+      bMutableIterators, btree_iterator<Value, node_values, Value &, Value *>,
+      const_iterator>::type iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef typename type_select<bUniqueKeys, mmm::pair<iterator, bool>,
+                               iterator>::type insert_return_type;
+  typedef integral_constant<bool, bUniqueKeys> has_unique_keys_type;
+
+protected:
+  typedef Detail::btree_node<Value, node_values> node_type;
+  typedef Detail::btree_internal_node<Value, node_values> internal_node_type;
+  typedef btree_iterator<Value, node_values, Value &, Value *> base_iterator;
+  //除根以外的节点少于该数时删除后要合并或从兄弟借值
+  static constexpr int min_values = node_values / 2;
+
+  node_type *root_;
+  node_type *leftmost_;
+  node_type *rightmost_;
+  size_type size_;
+  Compare compare_;
+
+public:
+  btree() : btree(Compare()) {}
+  explicit btree(const Compare &compare)
+      : root_(nullptr), leftmost_(nullptr), rightmost_(nullptr), size_(0),
+        compare_(compare) {}
+  template <class InputIterator>
+  btree(InputIterator first, InputIterator last,
+        const Compare &compare = Compare())
+      : btree(compare) {
+    insert(first, last);
+  }
+  //输入已按key严格递增时逐个追加到最右叶子, O(n)且节点是满的
+  template <class InputIterator>
+  btree(sorted_unique_t, InputIterator first, InputIterator last,
+        const Compare &compare = Compare())
+      : btree(compare) {
+    for (; first != last; ++first)
+      internal_insert(end_position(), *first);
+  }
+  btree(const btree &x) : btree(x.compare_) {
+    for (const_iterator it = x.begin(); it != x.end(); ++it)
+      internal_insert(end_position(), *it);
+  }
+  btree(btree &&x) : btree(x.compare_) { swap(x); }
+  ~btree() { clear(); }
+
+  btree &operator=(const btree &x) {
+    if (this != &x) {
+      btree tmp(x);
+      swap(tmp);
+    }
+    return *this;
+  }
+  btree &operator=(btree &&x) {
+    if (&x != this) {
+      clear();
+      swap(x);
+    }
+    return *this;
+  }
+  btree &operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    insert(ilist.begin(), ilist.end());
+    return *this;
+  }
+
+  iterator begin() noexcept { return base_iterator(leftmost_, 0); }
+  iterator end() noexcept { return end_position(); }
+  const_iterator begin() const noexcept { return base_iterator(leftmost_, 0); }
+  const_iterator end() const noexcept { return end_position(); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  key_compare key_comp() const { return compare_; }
+
+  template <class... Args> insert_return_type emplace(Args &&... args) {
+    return DoInsertValue(has_unique_keys_type(),
+                         value_type(mmm::forward<Args>(args)...));
+  }
+  template <class... Args>
+  iterator emplace_hint(const_iterator position, Args &&... args) {
+    return DoInsertValueHint(has_unique_keys_type(), position,
+                             value_type(mmm::forward<Args>(args)...));
+  }
+  insert_return_type insert(const value_type &value) {
+    return DoInsertValue(has_unique_keys_type(), value);
+  }
+  insert_return_type insert(value_type &&value) {
+    return DoInsertValue(has_unique_keys_type(), mmm::move(value));
+  }
+  //hint正好是插入位置(插在hint之前)时不用查找
+  iterator insert(const_iterator position, const value_type &value) {
+    return DoInsertValueHint(has_unique_keys_type(), position, value);
+  }
+  iterator insert(const_iterator position, value_type &&value) {
+    return DoInsertValueHint(has_unique_keys_type(), position,
+                             mmm::move(value));
+  }
+  //有序输入每次都命中end()这个hint
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first)
+      DoInsertValueHint(has_unique_keys_type(), end(), *first);
+  }
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  //返回被删除元素之后的位置
+  iterator erase(const_iterator position);
+  iterator erase(const_iterator first, const_iterator last);
+  size_type erase(const key_type &key);
+  void clear() {
+    if (root_)
+      destroy_subtree(root_);
+    root_ = leftmost_ = rightmost_ = nullptr;
+    size_ = 0;
+  }
+  void swap(btree &x) {
+    mmm::swap(root_, x.root_);
+    mmm::swap(leftmost_, x.leftmost_);
+    mmm::swap(rightmost_, x.rightmost_);
+    mmm::swap(size_, x.size_);
+    mmm::swap(compare_, x.compare_);
+  }
+
+  iterator find(const key_type &key) { return find_position(key); }
+  const_iterator find(const key_type &key) const { return find_position(key); }
+  size_type count(const key_type &key) const {
+    if (bUniqueKeys)
+      return find_position(key) != end_position() ? 1 : 0;
+    return mmm::distance(lower_bound(key), upper_bound(key));
+  }
+  iterator lower_bound(const key_type &key) {
+    return root_ ? normalize(locate_lower(key)) : end_position();
+  }
+  const_iterator lower_bound(const key_type &key) const {
+    return root_ ? normalize(locate_lower(key)) : end_position();
+  }
+  iterator upper_bound(const key_type &key) {
+    return root_ ? normalize(locate_upper(key)) : end_position();
+  }
+  const_iterator upper_bound(const key_type &key) const {
+    return root_ ? normalize(locate_upper(key)) : end_position();
+  }
+  mmm::pair<iterator, iterator> equal_range(const key_type &key) {
+    return mmm::pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+  }
+  mmm::pair<const_iterator, const_iterator>
+  equal_range(const key_type &key) const {
+    return mmm::pair<const_iterator, const_iterator>(lower_bound(key),
+                                                     upper_bound(key));
+  }
+
+  //检查有序性, 父子指针, 节点填充和所有叶子同深度
+  bool validate() const;
+
+protected:
+  static node_type *new_node(bool leaf, node_type *parent) {
+    node_type *n = leaf ? allocator<node_type>::allocate()
+                        : allocator<internal_node_type>::allocate();
+    n->parent = parent;
+    n->position = 0;
+    n->count = 0;
+    n->leaf = leaf;
+    return n;
+  }
+  static void delete_node(node_type *n) {
+    if (n->leaf)
+      allocator<node_type>::deallocate(n);
+    else
+      allocator<internal_node_type>::deallocate(
+          static_cast<internal_node_type *>(n));
+  }
+  void destroy_subtree(node_type *n) {
+    if (!n->leaf)
+      for (int i = 0; i <= n->count; ++i)
+        destroy_subtree(n->child(i));
+    for (int i = 0; i < n->count; ++i)
+      n->value(i).~Value();
+    delete_node(n);
+  }
+  //把src的第i个值移到dst的第j个槽, 源槽随后视为未构造
+  static void transfer(node_type *dst, int j, node_type *src, int i) {
+    ::new (static_cast<void *>(&dst->value(j)))
+        Value(mmm::move(src->value(i)));
+    src->value(i).~Value();
+  }
+  static void set_child(node_type *n, int i, node_type *c) {
+    n->child(i) = c;
+    c->parent = n;
+    c->position = i;
+  }
+  const key_type &key(node_type *n, int i) const {
+    return ExtractKey()(n->value(i));
+  }
+
+  base_iterator end_position() const {
+    return base_iterator(rightmost_, rightmost_ ? rightmost_->count : 0);
+  }
+  //停在节点末尾的位置换成中序意义上的下一个元素
+  base_iterator normalize(base_iterator it) const {
+    while (it.position_ == it.node_->count && it.node_->parent) {
+      it.position_ = it.node_->position;
+      it.node_ = it.node_->parent;
+    }
+    return it.position_ == it.node_->count ? end_position() : it;
+  }
+  //返回叶子上的位置, 规范化之后才是lower_bound/upper_bound
+  base_iterator locate_lower(const key_type &k) const {
+    node_type *n = root_;
+    for (;;) {
+      int lo = 0, hi = n->count;
+      while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (compare_(key(n, mid), k))
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      if (n->leaf)
+        return base_iterator(n, lo);
+      n = n->child(lo);
+    }
+  }
+  base_iterator locate_upper(const key_type &k) const {
+    node_type *n = root_;
+    for (;;) {
+      int lo = 0, hi = n->count;
+      while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (compare_(k, key(n, mid)))
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+      if (n->leaf)
+        return base_iterator(n, lo);
+      n = n->child(lo);
+    }
+  }
+  base_iterator find_position(const key_type &k) const {
+    if (!root_)
+      return end_position();
+    base_iterator it = normalize(locate_lower(k));
+    if (it != end_position() && !compare_(k, key(it.node_, it.position_)))
+      return it;
+    return end_position();
+  }
+  //紧挨在it之前的叶子槽位
+  static base_iterator leaf_position(base_iterator it) {
+    if (it.node_->leaf)
+      return it;
+    --it;
+    ++it.position_;
+    return it;
+  }
+
+  template <class V>
+  mmm::pair<iterator, bool> DoInsertValue(true_type, V &&value);
+  template <class V> iterator DoInsertValue(false_type, V &&value);
+  template <class V>
+  iterator DoInsertValueHint(true_type, const_iterator position, V &&value);
+  template <class V>
+  iterator DoInsertValueHint(false_type, const_iterator position, V &&value);
+
+  template <class... Args>
+  base_iterator internal_insert(base_iterator it, Args &&... args);
+  void split(base_iterator &it);
+  base_iterator rebalance_after_delete(base_iterator it);
+  bool try_merge_or_rebalance(base_iterator &it);
+  void merge_nodes(node_type *left, node_type *right);
+  void rebalance_right_to_left(node_type *node, node_type *right, int to_move);
+  void rebalance_left_to_right(node_type *left, node_type *node, int to_move);
+  int validate_subtree(node_type *n) const;
+}; // btree
+
+#define _MMM_BTREE_TEMPLATE                                                    \
+  template <class Key, class Value, class Compare, class ExtractKey,           \
+            bool bM, bool bU, size_t NodeSize>
+#define _MMM_BTREE_TYPE btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize>
+
+_MMM_BTREE_TEMPLATE
+template <class V>
+mmm::pair<typename _MMM_BTREE_TYPE::iterator, bool>
+_MMM_BTREE_TYPE::DoInsertValue(true_type, V &&value) {
+  base_iterator it;
+  if (root_) {
+    const key_type &k = ExtractKey()(value);
+    it = locate_lower(k);
+    base_iterator found = normalize(it);
+    if (found != end_position() &&
+        !compare_(k, key(found.node_, found.position_)))
+      return mmm::pair<iterator, bool>(found, false);
+  }
+  return mmm::pair<iterator, bool>(
+      internal_insert(it, mmm::forward<V>(value)), true);
+}
+
+// 等值元素插在最后, 与multimap一致
+_MMM_BTREE_TEMPLATE
+template <class V>
+typename _MMM_BTREE_TYPE::iterator
+_MMM_BTREE_TYPE::DoInsertValue(false_type, V &&value) {
+  base_iterator it;
+  if (root_)
+    it = locate_upper(ExtractKey()(value));
+  return internal_insert(it, mmm::forward<V>(value));
+}
+
+_MMM_BTREE_TEMPLATE
+template <class V>
+typename _MMM_BTREE_TYPE::iterator
+_MMM_BTREE_TYPE::DoInsertValueHint(true_type, const_iterator position,
+                                   V &&value) {
+  base_iterator pos(position.node_, position.position_);
+  if (root_) {
+    const key_type &k = ExtractKey()(value);
+    if (pos == end_position() || compare_(k, key(pos.node_, pos.position_))) {
+      base_iterator prev = pos;
+      if (pos.node_ == leftmost_ && pos.position_ == 0)
+        return internal_insert(pos, mmm::forward<V>(value));
+      --prev;
+      if (compare_(key(prev.node_, prev.position_), k))
+        return internal_insert(leaf_position(pos), mmm::forward<V>(value));
+    }
+  }
+  return DoInsertValue(true_type(), mmm::forward<V>(value)).first;
+}
+
+_MMM_BTREE_TEMPLATE
+template <class V>
+typename _MMM_BTREE_TYPE::iterator
+_MMM_BTREE_TYPE::DoInsertValueHint(false_type, const_iterator position,
+                                   V &&value) {
+  base_iterator pos(position.node_, position.position_);
+  if (root_) {
+    const key_type &k = ExtractKey()(value);
+    if (pos == end_position() || !compare_(key(pos.node_, pos.position_), k)) {
+      base_iterator prev = pos;
+      if (pos.node_ == leftmost_ && pos.position_ == 0)
+        return internal_insert(pos, mmm::forward<V>(value));
+      --prev;
+      if (!compare_(k, key(prev.node_, prev.position_)))
+        return internal_insert(leaf_position(pos), mmm::forward<V>(value));
+    }
+  }
+  return DoInsertValue(false_type(), mmm::forward<V>(value));
+}
+
+// it必须是叶子上的槽位(空树时忽略); 满了先分裂
+_MMM_BTREE_TEMPLATE
+template <class... Args>
+typename _MMM_BTREE_TYPE::base_iterator
+_MMM_BTREE_TYPE::internal_insert(base_iterator it, Args &&... args) {
+  if (!root_) {
+    root_ = leftmost_ = rightmost_ = new_node(true, nullptr);
+    it = base_iterator(root_, 0);
+  } else if (it.node_->count == node_values)
+    split(it);
+  node_type *n = it.node_;
+  //构造可能抛出时先在局部构造好, 再腾出槽位移进去;
+  //否则挪开后槽位已析构, 抛出会让节点里留下一个空洞
+  if constexpr (std::is_nothrow_constructible<Value, Args &&...>::value) {
+    for (int j = n->count; j > it.position_; --j)
+      transfer(n, j, n, j - 1);
+    ::new (static_cast<void *>(&n->value(it.position_)))
+        Value(mmm::forward<Args>(args)...);
+  } else {
+    Value value(mmm::forward<Args>(args)...);
+    for (int j = n->count; j > it.position_; --j)
+      transfer(n, j, n, j - 1);
+    ::new (static_cast<void *>(&n->value(it.position_))) Value(mmm::move(value));
+  }
+  ++n->count;
+  ++size_;
+  return it;
+}
+
+// 分裂满节点it.node_, 分隔值上移到父节点(父节点满了先递归分裂), it随之调整.
+// 插在节点末尾时左边保留N-1个, 插在开头时只保留0个, 这样顺序/逆序插入得到满节点
+_MMM_BTREE_TEMPLATE
+void _MMM_BTREE_TYPE::split(base_iterator &it) {
+  node_type *n = it.node_;
+  if (!n->parent) {
+    root_ = new_node(false, nullptr);
+    set_child(root_, 0, n);
+  } else if (n->parent->count == node_values) {
+    base_iterator pit(n->parent, n->position);
+    split(pit);
+  }
+  node_type *p = n->parent;
+  const int k = it.position_ == (int)node_values
+                    ? node_values - 1
+                    : it.position_ == 0 ? 0 : node_values / 2;
+  const int rcount = node_values - k - 1;
+  node_type *r = new_node(n->leaf, p);
+  for (int j = 0; j < rcount; ++j)
+    transfer(r, j, n, k + 1 + j);
+  if (!n->leaf)
+    for (int j = 0; j <= rcount; ++j)
+      set_child(r, j, n->child(k + 1 + j));
+  r->count = rcount;
+
+  const int pos = n->position;
+  for (int j = p->count; j > pos; --j) {
+    transfer(p, j, p, j - 1);
+    set_child(p, j + 1, p->child(j));
+  }
+  transfer(p, pos, n, k);
+  set_child(p, pos + 1, r);
+  ++p->count;
+  n->count = k;
+  if (rightmost_ == n)
+    rightmost_ = r;
+  if (it.position_ > k) {
+    it.node_ = r;
+    it.position_ -= k + 1;
+  }
+}
+
+// 内部节点上的值先与前驱(左子树最右叶子的最后一个值)交换, 删除总发生在叶子上
+_MMM_BTREE_TEMPLATE
+typename _MMM_BTREE_TYPE::iterator
+_MMM_BTREE_TYPE::erase(const_iterator position) {
+  base_iterator it(position.node_, position.position_);
+  const bool internal_delete = !it.node_->leaf;
+  if (internal_delete) {
+    base_iterator pred = it;
+    --pred;
+    it.node_->value(it.position_).~Value();
+    transfer(it.node_, it.position_, pred.node_, pred.position_);
+    it = pred;
+  } else {
+    it.node_->value(it.position_).~Value();
+    for (int j = it.position_ + 1; j < it.node_->count; ++j)
+      transfer(it.node_, j - 1, it.node_, j);
+  }
+  --it.node_->count;
+  --size_;
+  // 叶子上的it现在指向被删元素的后继; 从内部节点删除时后继还要再后移一位
+  base_iterator res = rebalance_after_delete(it);
+  if (internal_delete)
+    ++res;
+  return res;
+}
+
+_MMM_BTREE_TEMPLATE
+typename _MMM_BTREE_TYPE::iterator
+_MMM_BTREE_TYPE::erase(const_iterator first, const_iterator last) {
+  if (first == begin() && last == end()) {
+    clear();
+    return end();
+  }
+  for (difference_type n = mmm::distance(first, last); n > 0; --n)
+    first = erase(first);
+  return base_iterator(first.node_, first.position_);
+}
+
+_MMM_BTREE_TEMPLATE
+typename _MMM_BTREE_TYPE::size_type
+_MMM_BTREE_TYPE::erase(const key_type &key) {
+  if (bU) {
+    const_iterator it = find_position(key);
+    if (it == end())
+      return 0;
+    erase(it);
+    return 1;
+  }
+  mmm::pair<const_iterator, const_iterator> range = equal_range(key);
+  const size_type n = mmm::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return n;
+}
+
+// 自叶子向上: 节点不足min_values时与兄弟合并(可能继续向上)或从兄弟借值;
+// res在第一层之后不再改变, 最后规范化成真正的元素位置
+_MMM_BTREE_TEMPLATE
+typename _MMM_BTREE_TYPE::base_iterator
+_MMM_BTREE_TYPE::rebalance_after_delete(base_iterator it) {
+  base_iterator res = it;
+  bool first = true;
+  for (;;) {
+    if (it.node_ == root_) {
+      if (root_->count == 0) {
+        if (root_->leaf) {
+          delete_node(root_);
+          root_ = leftmost_ = rightmost_ = nullptr;
+          return end_position();
+        }
+        //根只剩一个孩子, 树高减一
+        node_type *c = root_->child(0);
+        delete_node(root_);
+        c->parent = nullptr;
+        c->position = 0;
+        root_ = c;
+      }
+      break;
+    }
+    if (it.node_->count >= min_values)
+      break;
+    const bool merged = try_merge_or_rebalance(it);
+    if (first) {
+      res = it;
+      first = false;
+    }
+    if (!merged)
+      break;
+    it.position_ = it.node_->position;
+    it.node_ = it.node_->parent;
+  }
+  if (res.position_ == res.node_->count) {
+    res.position_ = res.node_->count - 1;
+    ++res;
+  }
+  return res;
+}
+
+_MMM_BTREE_TEMPLATE
+bool _MMM_BTREE_TYPE::try_merge_or_rebalance(base_iterator &it) {
+  node_type *n = it.node_;
+  node_type *p = n->parent;
+  if (n->position > 0) {
+    node_type *left = p->child(n->position - 1);
+    if (1u + left->count + n->count <= node_values) {
+      it.position_ += 1 + left->count;
+      merge_nodes(left, n);
+      it.node_ = left;
+      return true;
+    }
+  }
+  if (n->position < p->count) {
+    node_type *right = p->child(n->position + 1);
+    if (1u + n->count + right->count <= node_values) {
+      merge_nodes(n, right);
+      return true;
+    }
+    //从前面连续删除时不借, 留给合并处理
+    if (right->count > min_values &&
+        (n->count == 0 || it.position_ > 0)) {
+      int to_move = (right->count - n->count) / 2;
+      if (to_move > right->count - 1)
+        to_move = right->count - 1;
+      rebalance_right_to_left(n, right, to_move);
+      return false;
+    }
+  }
+  if (n->position > 0) {
+    node_type *left = p->child(n->position - 1);
+    if (left->count > min_values &&
+        (n->count == 0 || it.position_ < n->count)) {
+      int to_move = (left->count - n->count) / 2;
+      if (to_move > left->count - 1)
+        to_move = left->count - 1;
+      rebalance_left_to_right(left, n, to_move);
+      it.position_ += to_move;
+      return false;
+    }
+  }
+  return false;
+}
+
+// right与分隔值并入left, 然后释放right
+_MMM_BTREE_TEMPLATE
+void _MMM_BTREE_TYPE::merge_nodes(node_type *left, node_type *right) {
+  node_type *p = left->parent;
+  const int pos = left->position;
+  const int c = left->count;
+  transfer(left, c, p, pos);
+  for (int j = 0; j < right->count; ++j)
+    transfer(left, c + 1 + j, right, j);
+  if (!left->leaf)
+    for (int j = 0; j <= right->count; ++j)
+      set_child(left, c + 1 + j, right->child(j));
+  left->count += 1 + right->count;
+  for (int j = pos + 1; j < p->count; ++j) {
+    transfer(p, j - 1, p, j);
+    set_child(p, j, p->child(j + 1));
+  }
+  --p->count;
+  if (rightmost_ == right)
+    rightmost_ = left;
+  delete_node(right);
+}
+
+// 经由父节点的分隔值, 把right开头的to_move个值轮转到node末尾
+_MMM_BTREE_TEMPLATE
+void _MMM_BTREE_TYPE::rebalance_right_to_left(node_type *node,
+                                              node_type *right, int to_move) {
+  node_type *p = node->parent;
+  const int pos = node->position;
+  const int c = node->count;
+  transfer(node, c, p, pos);
+  for (int j = 0; j < to_move - 1; ++j)
+    transfer(node, c + 1 + j, right, j);
+  transfer(p, pos, right, to_move - 1);
+  for (int j = to_move; j < right->count; ++j)
+    transfer(right, j - to_move, right, j);
+  if (!node->leaf) {
+    for (int j = 0; j < to_move; ++j)
+      set_child(node, c + 1 + j, right->child(j));
+    for (int j = to_move; j <= right->count; ++j)
+      set_child(right, j - to_move, right->child(j));
+  }
+  node->count += to_move;
+  right->count -= to_move;
+}
+
+_MMM_BTREE_TEMPLATE
+void _MMM_BTREE_TYPE::rebalance_left_to_right(node_type *left,
+                                              node_type *node, int to_move) {
+  node_type *p = left->parent;
+  const int pos = left->position;
+  const int c = left->count;
+  for (int j = node->count - 1; j >= 0; --j)
+    transfer(node, j + to_move, node, j);
+  if (!node->leaf)
+    for (int j = node->count; j >= 0; --j)
+      set_child(node, j + to_move, node->child(j));
+  transfer(node, to_move - 1, p, pos);
+  for (int j = 0; j < to_move - 1; ++j)
+    transfer(node, j, left, c - to_move + 1 + j);
+  transfer(p, pos, left, c - to_move);
+  if (!node->leaf)
+    for (int j = 0; j < to_move; ++j)
+      set_child(node, j, left->child(c - to_move + 1 + j));
+  left->count -= to_move;
+  node->count += to_move;
+}
+
+_MMM_BTREE_TEMPLATE
+bool _MMM_BTREE_TYPE::validate() const {
+  if (!root_)
+    return size_ == 0 && !leftmost_ && !rightmost_;
+  if (root_->parent)
+    return false;
+  node_type *n = root_;
+  while (!n->leaf)
+    n = n->child(0);
+  if (n != leftmost_)
+    return false;
+  n = root_;
+  while (!n->leaf)
+    n = n->child(n->count);
+  if (n != rightmost_)
+    return false;
+  if (validate_subtree(root_) < 0)
+    return false;
+  size_type count = 0;
+  const_iterator prev = end();
+  for (const_iterator it = begin(); it != end(); prev = it, ++it, ++count) {
+    if (prev != end() && (bU ? !compare_(ExtractKey()(*prev),
+                                                  ExtractKey()(*it))
+                                      : compare_(ExtractKey()(*it),
+                                                 ExtractKey()(*prev))))
+      return false;
+  }
+  return count == size_;
+}
+
+// 返回子树高度, 不合法时返回-1
+_MMM_BTREE_TEMPLATE
+int _MMM_BTREE_TYPE::validate_subtree(node_type *n) const {
+  if (n->count > node_values || (n != root_ && n->count == 0))
+    return -1;
+  if (n->leaf)
+    return 1;
+  int height = -1;
+  for (int i = 0; i <= n->count; ++i) {
+    node_type *c = n->child(i);
+    if (c->parent != n || c->position != i)
+      return -1;
+    const int h = validate_subtree(c);
+    if (h < 0 || (height >= 0 && h != height))
+      return -1;
+    height = h;
+  }
+  return height + 1;
+}
+
+#undef _MMM_BTREE_TYPE
+#undef _MMM_BTREE_TEMPLATE
+
+template <class Key, class Value, class Compare, class ExtractKey, bool bM,
+          bool bU, size_t NodeSize>
+inline bool
+operator==(const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &a,
+           const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &b) {
+  return a.size() == b.size() && mmm::equal(a.begin(), a.end(), b.begin());
+}
+
+template <class Key, class Value, class Compare, class ExtractKey, bool bM,
+          bool bU, size_t NodeSize>
+inline bool
+operator!=(const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &a,
+           const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &b) {
+  return !(a == b);
+}
+
+template <class Key, class Value, class Compare, class ExtractKey, bool bM,
+          bool bU, size_t NodeSize>
+inline bool
+operator<(const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &a,
+          const btree<Key, Value, Compare, ExtractKey, bM, bU, NodeSize> &b) {
+  return mmm::lexicographical_compare(a.begin(), a.end(), b.begin(),
+                                      b.end());
+}
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef _BTREE_MAP_H_
+#define _BTREE_MAP_H_
+
+#include "btree.h"
+#include "exception.h"
+#include "functional.h"
+#include "pair.h"
+
+namespace mmm {
+
+// btree_map/btree_multimap: 接口同map/multimap, 底层是B树(见btree.h).
+// 节点直接由mmm::allocator分配, 没有Allocator参数; NodeSize是每个节点的字节数.
+// 与map不同, 插入/删除会使所有迭代器失效.
+template <typename Key, typename T, typename Compare = mmm::less<Key>,
+          size_t NodeSize = _MMM_BTREE_NODE_SIZE>
+class btree_map
+    : public btree<Key, mmm::pair<const Key, T>, Compare,
+                   mmm::select1st<mmm::pair<const Key, T>>, true, true,
+                   NodeSize> {
+public:
+  typedef btree<Key, mmm::pair<const Key, T>, Compare,
+                mmm::select1st<mmm::pair<const Key, T>>, true, true, NodeSize>
+      base_type;
+  typedef btree_map<Key, T, Compare, NodeSize> this_type;
+  typedef typename base_type::size_type size_type;
+  typedef typename base_type::key_type key_type;
+  typedef T mapped_type;
+  typedef typename base_type::value_type value_type;
+  typedef typename base_type::iterator iterator;
+  typedef typename base_type::const_iterator const_iterator;
+
+  using base_type::end;
+  using base_type::insert;
+  using base_type::lower_bound;
+
+  class value_compare {
+  protected:
+    friend class btree_map;
+    Compare compare;
+    value_compare(Compare c) : compare(c) {}
+
+  public:
+    bool operator()(const value_type &x, const value_type &y) const {
+      return compare(x.first, y.first);
+    }
+  };
+
+public:
+  btree_map() {}
+  explicit btree_map(const Compare &compare) : base_type(compare) {}
+  btree_map(std::initializer_list<value_type> ilist,
+            const Compare &compare = Compare())
+      : base_type(ilist.begin(), ilist.end(), compare) {}
+  template <typename Iterator>
+  btree_map(Iterator itBegin, Iterator itEnd,
+            const Compare &compare = Compare())
+      : base_type(itBegin, itEnd, compare) {}
+  template <typename Iterator>
+  btree_map(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+            const Compare &compare = Compare())
+      : base_type(sorted_unique, itBegin, itEnd, compare) {}
+
+  value_compare value_comp() const { return value_compare(this->compare_); }
+
+  T &operator[](const Key &key) {
+    iterator it(lower_bound(key));
+    if (it == end() || this->compare_(key, (*it).first))
+      it = insert(it, value_type(key, T()));
+    return (*it).second;
+  }
+
+  T &at(const Key &key) {
+    iterator it(this->find(key));
+    if (it == end())
+      throw mmm::out_of_range("btree_map::at key does not exist");
+    return (*it).second;
+  }
+  const T &at(const Key &key) const {
+    const_iterator it(this->find(key));
+    if (it == end())
+      throw mmm::out_of_range("btree_map::at key does not exist");
+    return (*it).second;
+  }
+}; // btree_map
+
+template <typename Key, typename T, typename Compare = mmm::less<Key>,
+          size_t NodeSize = _MMM_BTREE_NODE_SIZE>
+class btree_multimap
+    : public btree<Key, mmm::pair<const Key, T>, Compare,
+                   mmm::select1st<mmm::pair<const Key, T>>, true, false,
+                   NodeSize> {
+public:
+  typedef btree<Key, mmm::pair<const Key, T>, Compare,
+                mmm::select1st<mmm::pair<const Key, T>>, true, false, NodeSize>
+      base_type;
+  typedef btree_multimap<Key, T, Compare, NodeSize> this_type;
+  typedef typename base_type::key_type key_type;
+  typedef T mapped_type;
+  typedef typename base_type::value_type value_type;
+
+public:
+  btree_multimap() {}
+  explicit btree_multimap(const Compare &compare) : base_type(compare) {}
+  btree_multimap(std::initializer_list<value_type> ilist,
+                 const Compare &compare = Compare())
+      : base_type(ilist.begin(), ilist.end(), compare) {}
+  template <typename Iterator>
+  btree_multimap(Iterator itBegin, Iterator itEnd,
+                 const Compare &compare = Compare())
+      : base_type(itBegin, itEnd, compare) {}
+}; // btree_multimap
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _BTREE_SET_H_
+#define _BTREE_SET_H_
+
+#include "btree.h"
+#include "functional.h"
+
+namespace mmm {
+
+// btree_set/btree_multiset: 接口同set/multiset, 底层是B树(见btree.h).
+// 与set不同, 插入/删除会使所有迭代器失效.
+template <typename Key, typename Compare = mmm::less<Key>,
+          size_t NodeSize = _MMM_BTREE_NODE_SIZE>
+class btree_set : public btree<Key, Key, Compare, mmm::identity<Key>, false,
+                               true, NodeSize> {
+public:
+  typedef btree<Key, Key, Compare, mmm::identity<Key>, false, true, NodeSize>
+      base_type;
+  typedef btree_set<Key, Compare, NodeSize> this_type;
+  typedef typename base_type::value_type value_type;
+  typedef Compare value_compare;
+
+public:
+  btree_set() {}
+  explicit btree_set(const Compare &compare) : base_type(compare) {}
+  btree_set(std::initializer_list<value_type> ilist,
+            const Compare &compare = Compare())
+      : base_type(ilist.begin(), ilist.end(), compare) {}
+  template <typename Iterator>
+  btree_set(Iterator itBegin, Iterator itEnd,
+            const Compare &compare = Compare())
+      : base_type(itBegin, itEnd, compare) {}
+  template <typename Iterator>
+  btree_set(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+            const Compare &compare = Compare())
+      : base_type(sorted_unique, itBegin, itEnd, compare) {}
+
+  value_compare value_comp() const { return this->compare_; }
+}; // btree_set
+
+template <typename Key, typename Compare = mmm::less<Key>,
+          size_t NodeSize = _MMM_BTREE_NODE_SIZE>
+class btree_multiset : public btree<Key, Key, Compare, mmm::identity<Key>,
+                                    false, false, NodeSize> {
+public:
+  typedef btree<Key, Key, Compare, mmm::identity<Key>, false, false, NodeSize>
+      base_type;
+  typedef btree_multiset<Key, Compare, NodeSize> this_type;
+  typedef typename base_type::value_type value_type;
+  typedef Compare value_compare;
+
+public:
+  btree_multiset() {}
+  explicit btree_multiset(const Compare &compare) : base_type(compare) {}
+  btree_multiset(std::initializer_list<value_type> ilist,
+                 const Compare &compare = Compare())
+      : base_type(ilist.begin(), ilist.end(), compare) {}
+  template <typename Iterator>
+  btree_multiset(Iterator itBegin, Iterator itEnd,
+                 const Compare &compare = Compare())
+      : base_type(itBegin, itEnd, compare) {}
+
+  value_compare value_comp() const { return this->compare_; }
+}; // btree_multiset
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef _CIRCULAR_BUFFER_H_
+#define _CIRCULAR_BUFFER_H_
+
+#include "algorithm.h"
+#include "allocator.h"
+#include "exception.h"
+#include "iterator.h"
+#include "utility.h"
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+//默认构造时的容量
+#ifndef _MMM_CIRCULAR_BUFFER_CAPACITY
+#define _MMM_CIRCULAR_BUFFER_CAPACITY 64
+#endif
+
+// circular_buffer: 容量固定的环形缓冲区, 一次分配的连续内存.
+// 存储长度取整为2的幂, 下标用掩码回绕: slot(i) = (head_ + i) & mask_.
+// head_是不回绕的计数, 迭代器保存的也是不回绕的位置, 相减即为距离.
+// 容量以构造时给出的值为准(可以不是2的幂), 满了之后:
+//   overwrite: 覆盖另一端最旧的元素(push_back覆盖front, push_front覆盖back)
+//   reject:    丢弃新元素, push返回false
+// 提供front/back/push_back/pop_front/pop_back, 可作为queue/stack的Container.
+// 默认构造的容量为_MMM_CIRCULAR_BUFFER_CAPACITY(不是0, 否则作为queue的容器时
+// 每次push都会被悄悄丢掉); 只有被移走后的对象容量为0.
+
+enum class overflow_policy { overwrite, reject };
+
+template <class T, class Ref, class Ptr> class circular_buffer_iterator {
+public:
+  typedef mmm::random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef ptrdiff_t difference_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef circular_buffer_iterator<T, T &, T *> iterator;
+  typedef circular_buffer_iterator self;
+
+  T *buf_;
+  size_t mask_;
+  size_t pos_; //不回绕的位置
+
+public:
+  circular_buffer_iterator() : buf_(nullptr), mask_(0), pos_(0) {}
+  circular_buffer_iterator(T *buf, size_t mask, size_t pos)
+      : buf_(buf), mask_(mask), pos_(pos) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                circular_buffer_iterator<T, R, P>, iterator>::value>::type>
+  circular_buffer_iterator(const circular_buffer_iterator<T, R, P> &other)
+      : buf_(other.buf_), mask_(other.mask_), pos_(other.pos_) {}
+
+  reference operator*() const { return buf_[pos_ & mask_]; }
+  pointer operator->() const { return buf_ + (pos_ & mask_); }
+  reference operator[](difference_type n) const {
+    return buf_[(pos_ + n) & mask_];
+  }
+  self &operator++() {
+    ++pos_;
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    ++pos_;
+    return tmp;
+  }
+  self &operator--() {
+    --pos_;
+    return *this;
+  }
+  self operator--(int) {
+    self tmp = *this;
+    --pos_;
+    return tmp;
+  }
+  self &operator+=(difference_type n) {
+    pos_ += n;
+    return *this;
+  }
+  self &operator-=(difference_type n) {
+    pos_ -= n;
+    return *this;
+  }
+  self operator+(difference_type n) const { return self(buf_, mask_, pos_ + n); }
+  self operator-(difference_type n) const { return self(buf_, mask_, pos_ - n); }
+  difference_type operator-(const self &other) const {
+    return difference_type(pos_ - other.pos_);
+  }
+  bool operator==(const self &other) const { return pos_ == other.pos_; }
+  bool operator!=(const self &other) const { return pos_ != other.pos_; }
+  bool operator<(const self &other) const {
+    return difference_type(pos_ - other.pos_) < 0;
+  }
+};
+
+template <class T, class Alloc = allocator<T>> class circular_buffer {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef Alloc allocator_type;
+  typedef circular_buffer_iterator<T, T &, T *> iterator;
+  typedef circular_buffer_iterator<T, const T &, const T *> const_iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+  typedef Alloc dataAllocator;
+
+  T *buf_;
+  size_type mask_;     //存储长度-1
+  size_type capacity_; //逻辑容量, <= mask_+1
+  size_type head_;
+  size_type size_;
+  overflow_policy policy_;
+
+public:
+  circular_buffer() : circular_buffer(_MMM_CIRCULAR_BUFFER_CAPACITY) {}
+  explicit circular_buffer(size_type capacity,
+                           overflow_policy policy = overflow_policy::overwrite)
+      : buf_(nullptr), mask_(0), capacity_(0), head_(0), size_(0),
+        policy_(policy) {
+    allocate_storage(capacity);
+  }
+  circular_buffer(const circular_buffer &other)
+      : circular_buffer(other.capacity_, other.policy_) {
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      emplace_back(*it);
+  }
+  //容量0不分配内存
+  circular_buffer(circular_buffer &&other) noexcept : circular_buffer(0) {
+    this->swap(other);
+  }
+  circular_buffer &operator=(const circular_buffer &other) {
+    circular_buffer tmp(other);
+    this->swap(tmp);
+    return *this;
+  }
+  circular_buffer &operator=(circular_buffer &&other) noexcept {
+    if (&other != this)
+      this->swap(other);
+    return *this;
+  }
+  ~circular_buffer() {
+    clear();
+    if (buf_)
+      dataAllocator::deallocate(buf_, mask_ + 1);
+  }
+
+  iterator begin() noexcept { return iterator(buf_, mask_, head_); }
+  iterator end() noexcept { return iterator(buf_, mask_, head_ + size_); }
+  const_iterator begin() const noexcept {
+    return const_iterator(buf_, mask_, head_);
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(buf_, mask_, head_ + size_);
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  //容量
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+  bool full() const noexcept { return size_ == capacity_; }
+  overflow_policy policy() const noexcept { return policy_; }
+  void set_policy(overflow_policy p) noexcept { policy_ = p; }
+  //改变容量, 元素多于新容量时保留最新的(靠back一端的)元素
+  void set_capacity(size_type n);
+
+  //元素访问
+  reference operator[](size_type i) { return buf_[(head_ + i) & mask_]; }
+  const_reference operator[](size_type i) const {
+    return buf_[(head_ + i) & mask_];
+  }
+  reference at(size_type i) {
+    range_check(i);
+    return (*this)[i];
+  }
+  const_reference at(size_type i) const {
+    range_check(i);
+    return (*this)[i];
+  }
+  reference front() { return buf_[head_ & mask_]; }
+  const_reference front() const { return buf_[head_ & mask_]; }
+  reference back() { return buf_[(head_ + size_ - 1) & mask_]; }
+  const_reference back() const { return buf_[(head_ + size_ - 1) & mask_]; }
+
+  //修改器. 满时按policy()处理, 返回新元素是否被放入
+  bool push_back(const value_type &val) { return emplace_back(val); }
+  bool push_back(value_type &&val) { return emplace_back(mmm::move(val)); }
+  bool push_front(const value_type &val) { return emplace_front(val); }
+  bool push_front(value_type &&val) { return emplace_front(mmm::move(val)); }
+  template <class... Args> bool emplace_back(Args &&... args);
+  template <class... Args> bool emplace_front(Args &&... args);
+  void pop_front() {
+    buf_[head_ & mask_].~T();
+    ++head_;
+    --size_;
+  }
+  void pop_back() {
+    --size_;
+    buf_[(head_ + size_) & mask_].~T();
+  }
+  void clear() {
+    while (size_ != 0)
+      pop_back();
+    head_ = 0;
+  }
+  void swap(circular_buffer &other) noexcept {
+    mmm::swap(buf_, other.buf_);
+    mmm::swap(mask_, other.mask_);
+    mmm::swap(capacity_, other.capacity_);
+    mmm::swap(head_, other.head_);
+    mmm::swap(size_, other.size_);
+    mmm::swap(policy_, other.policy_);
+  }
+
+private:
+  static size_type round_pow2(size_type n) {
+    size_type len = 1;
+    while (len < n)
+      len <<= 1;
+    return len;
+  }
+  void allocate_storage(size_type capacity) {
+    const size_type len = round_pow2(capacity);
+    buf_ = capacity == 0 ? nullptr : dataAllocator::allocate(len);
+    mask_ = len - 1;
+    capacity_ = capacity;
+  }
+  void range_check(size_type i) const {
+    if (i >= size_)
+      throw mmm::out_of_range("circular_buffer::at Out Of Range");
+  }
+}; // end of circular_buffer
+
+template <class T, class Alloc>
+template <class... Args>
+bool circular_buffer<T, Alloc>::emplace_back(Args &&... args) {
+  if (size_ == capacity_) {
+    if (policy_ == overflow_policy::reject || capacity_ == 0)
+      return false;
+    //先构造新元素, 参数可能引用着将被覆盖的front
+    value_type tmp(mmm::forward<Args>(args)...);
+    pop_front();
+    new (buf_ + ((head_ + size_) & mask_)) T(mmm::move(tmp));
+  } else {
+    new (buf_ + ((head_ + size_) & mask_)) T(mmm::forward<Args>(args)...);
+  }
+  ++size_;
+  return true;
+}
+
+template <class T, class Alloc>
+template <class... Args>
+bool circular_buffer<T, Alloc>::emplace_front(Args &&... args) {
+  if (size_ == capacity_) {
+    if (policy_ == overflow_policy::reject || capacity_ == 0)
+      return false;
+    value_type tmp(mmm::forward<Args>(args)...);
+    pop_back();
+    new (buf_ + ((head_ - 1) & mask_)) T(mmm::move(tmp));
+  } else {
+    new (buf_ + ((head_ - 1) & mask_)) T(mmm::forward<Args>(args)...);
+  }
+  --head_;
+  ++size_;
+  return true;
+}
+
+template <class T, class Alloc>
+void circular_buffer<T, Alloc>::set_capacity(size_type n) {
+  circular_buffer tmp(n, policy_);
+  const size_type keep = size_ < n ? size_ : n;
+  for (iterator it = end() - difference_type(keep); it != end(); ++it)
+    tmp.emplace_back(mmm::move(*it));
+  this->swap(tmp);
+}
+
+template <class T, class Alloc>
+inline void swap(circular_buffer<T, Alloc> &x,
+                 circular_buffer<T, Alloc> &y) noexcept {
+  x.swap(y);
+}
+
+template <class T, class Alloc>
+bool operator==(const circular_buffer<T, Alloc> &x,
+                const circular_buffer<T, Alloc> &y) {
+  return x.size() == y.size() && mmm::equal(x.begin(), x.end(), y.begin());
+}
+template <class T, class Alloc>
+inline bool operator!=(const circular_buffer<T, Alloc> &x,
+                       const circular_buffer<T, Alloc> &y) {
+  return !(x == y);
+}
+template <class T, class Alloc>
+inline bool operator<(const circular_buffer<T, Alloc> &x,
+                      const circular_buffer<T, Alloc> &y) {
+  return mmm::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+}
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,472 @@
+#ifndef _CONCURRENT_VECTOR_H_
+#define _CONCURRENT_VECTOR_H_
+
+#include "algorithm.h"
+#include "allocator.h"
+#include "construct.h"
+#include "iterator.h"
+#include "uninitialized.h"
+#include "utility.h"
+#include "vector.h"
+#include "exception.h"
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+// concurrent_vector: 只增不减的并发vector.
+// 存储分段: 段k的容量为2^k(段0为2), 段一旦分配永不移动, 因此已有元素的地址稳定.
+//   index i -> 段 k = log2(i|1), 段内偏移 i - segment_base(k).
+// push_back/grow_by 通过对 reserved_ 的 fetch_add 预留下标, 无锁;
+// 缺失的段由 CAS 安装到段表, 竞争失败者释放自己的段.
+// 每个槽位有一个状态字节(和元素放在同一块段内存的末尾), 构造完成后逐个置为就绪.
+// size_ 是"全部就绪"的最长前缀: 写完的线程顺手把 size_ 推过后面连续就绪的槽位,
+// 前面的槽位还没好就直接返回, 由完成那个槽位的线程继续推进, 谁也不用等谁.
+// 读者只会看到 [0, size()) 内已构造完成的元素.
+// 构造抛出异常时, 能默认构造的槽位以 T() 填上; 否则该槽位作废, size() 停在它之前.
+// clear/swap/析构/拷贝 不是线程安全的.
+
+template <class Vector, class T> class concurrent_vector_iterator {
+public:
+  typedef mmm::random_access_iterator_tag iterator_category;
+  typedef typename Vector::value_type value_type;
+  typedef ptrdiff_t difference_type;
+  typedef T *pointer;
+  typedef T &reference;
+  typedef concurrent_vector_iterator self;
+
+  Vector *vec_;
+  size_t index_;
+
+public:
+  concurrent_vector_iterator() : vec_(nullptr), index_(0) {}
+  concurrent_vector_iterator(Vector *v, size_t i) : vec_(v), index_(i) {}
+  template <class V2, class T2>
+  concurrent_vector_iterator(const concurrent_vector_iterator<V2, T2> &other)
+      : vec_(other.vec_), index_(other.index_) {}
+
+  reference operator*() const { return (*vec_)[index_]; }
+  pointer operator->() const { return &(operator*()); }
+  reference operator[](difference_type n) const { return (*vec_)[index_ + n]; }
+
+  self &operator++() {
+    ++index_;
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    ++index_;
+    return tmp;
+  }
+  self &operator--() {
+    --index_;
+    return *this;
+  }
+  self operator--(int) {
+    self tmp = *this;
+    --index_;
+    return tmp;
+  }
+  self &operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+  self &operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+  self operator+(difference_type n) const { return self(vec_, index_ + n); }
+  self operator-(difference_type n) const { return self(vec_, index_ - n); }
+  difference_type operator-(const self &other) const {
+    return difference_type(index_) - difference_type(other.index_);
+  }
+
+  bool operator==(const self &other) const { return index_ == other.index_; }
+  bool operator!=(const self &other) const { return index_ != other.index_; }
+  bool operator<(const self &other) const { return index_ < other.index_; }
+  bool operator>(const self &other) const { return other < *this; }
+  bool operator<=(const self &other) const { return !(other < *this); }
+  bool operator>=(const self &other) const { return !(*this < other); }
+};
+
+template <class T, class Allocator = allocator<T>> class concurrent_vector {
+public:
+  typedef T value_type;
+  typedef Allocator allocator_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef concurrent_vector_iterator<concurrent_vector, T> iterator;
+  typedef concurrent_vector_iterator<const concurrent_vector, const T>
+      const_iterator;
+
+private:
+  enum { kNumOfSegments = sizeof(size_t) * 8 };
+  //槽位状态
+  enum { kSlotEmpty = 0, kSlotReady = 1, kSlotBroken = 2 };
+  typedef std::atomic<unsigned char> slot_state;
+
+  std::atomic<T *> segments_[kNumOfSegments];
+  std::atomic<size_t> reserved_; //已预留的元素个数
+  std::atomic<size_t> size_;     //已构造并发布的元素个数
+
+public:
+  concurrent_vector() : reserved_(0), size_(0) { init_segments(); }
+  explicit concurrent_vector(size_type n, const value_type &val = value_type())
+      : concurrent_vector() {
+    grow_by(n, val);
+  }
+  template <class InputIterator>
+  concurrent_vector(InputIterator first, InputIterator last)
+      : concurrent_vector() {
+    for (; first != last; ++first)
+      push_back(*first);
+  }
+  concurrent_vector(const concurrent_vector &other) : concurrent_vector() {
+    const size_type n = other.size();
+    for (size_type i = 0; i != n; ++i)
+      push_back(other[i]);
+  }
+  concurrent_vector(concurrent_vector &&other) : concurrent_vector() {
+    this->swap(other);
+  }
+  concurrent_vector &operator=(const concurrent_vector &other) {
+    concurrent_vector tmp(other);
+    this->swap(tmp);
+    return *this;
+  }
+  concurrent_vector &operator=(concurrent_vector &&other) {
+    if (&other != this)
+      this->swap(other);
+    return *this;
+  }
+  ~concurrent_vector() { release_segments(); }
+
+  iterator begin() noexcept { return iterator(this, 0); }
+  iterator end() noexcept { return iterator(this, size()); }
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+  const_iterator end() const noexcept { return const_iterator(this, size()); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  //容量: size()只统计已发布元素, 并发下是一个快照
+  size_type size() const noexcept {
+    return size_.load(std::memory_order_acquire);
+  }
+  bool empty() const noexcept { return size() == 0; }
+  size_type capacity() const noexcept;
+  void reserve(size_type n);
+
+  //元素访问: 下标必须小于某次size()的返回值
+  reference operator[](size_type i) { return *element_at(i); }
+  const_reference operator[](size_type i) const { return *element_at(i); }
+  reference at(size_type i) {
+    range_check(i);
+    return (*this)[i];
+  }
+  const_reference at(size_type i) const {
+    range_check(i);
+    return (*this)[i];
+  }
+  reference front() { return (*this)[0]; }
+  const_reference front() const { return (*this)[0]; }
+  reference back() { return (*this)[size() - 1]; }
+  const_reference back() const { return (*this)[size() - 1]; }
+
+  //修改器: push_back/emplace_back/grow_by 可被多个线程同时调用
+  iterator push_back(const value_type &val) { return emplace_back(val); }
+  iterator push_back(value_type &&val) { return emplace_back(mmm::move(val)); }
+  template <class... Args> iterator emplace_back(Args &&... args);
+  iterator grow_by(size_type n, const value_type &val = value_type());
+  template <class InputIterator>
+  iterator grow_by(InputIterator first, InputIterator last) {
+    return grow_by_aux(first, last, is_integer<InputIterator>());
+  }
+
+  void clear();
+  void swap(concurrent_vector &other) noexcept;
+
+private:
+  static size_t log2_floor(size_t x) { // x != 0
+#if defined(__GNUC__)
+    return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(x);
+#else
+    size_t k = 0;
+    while (x >>= 1)
+      ++k;
+    return k;
+#endif
+  }
+  static size_t segment_index_of(size_t i) { return log2_floor(i | 1); }
+  static size_t segment_base(size_t k) {
+    return (size_t(1) << k) & ~size_t(1);
+  }
+  static size_t segment_size(size_t k) {
+    return k == 0 ? size_t(2) : size_t(1) << k;
+  }
+  //段内存以T为单位: 元素之后紧跟每个槽位的状态字节
+  static size_t segment_alloc_count(size_t k) {
+    return segment_size(k) + (segment_size(k) + sizeof(T) - 1) / sizeof(T);
+  }
+  static slot_state *segment_states(T *seg, size_t k) {
+    return reinterpret_cast<slot_state *>(seg + segment_size(k));
+  }
+
+  void init_segments() {
+    for (size_t k = 0; k != kNumOfSegments; ++k)
+      segments_[k].store(nullptr, std::memory_order_relaxed);
+  }
+  T *element_at(size_t i) const {
+    const size_t k = segment_index_of(i);
+    return segments_[k].load(std::memory_order_acquire) + (i - segment_base(k));
+  }
+  //槽位i的状态, 所在段尚未分配时返回nullptr
+  slot_state *state_at(size_t i) const {
+    const size_t k = segment_index_of(i);
+    T *seg = segments_[k].load(std::memory_order_acquire);
+    return seg ? segment_states(seg, k) + (i - segment_base(k)) : nullptr;
+  }
+  T *ensure_segment(size_t k);
+  size_type reserve_range(size_type n);
+  void publish();
+  void abandon(size_type first, size_type last);
+  void range_check(size_type i) const {
+    if (i >= size())
+      throw mmm::out_of_range("concurrent_vector::at Out Of Range");
+  }
+  void release_segments();
+
+  template <class Integer>
+  iterator grow_by_aux(Integer n, const value_type &val, true_type) {
+    return grow_by(size_type(n), val);
+  }
+  template <class InputIterator>
+  iterator grow_by_aux(InputIterator first, InputIterator last, false_type) {
+    return grow_by_range(first, last, iterator_category<InputIterator>());
+  }
+  //单遍的输入迭代器先缓存下来, 才能预先知道个数
+  template <class InputIterator>
+  iterator grow_by_range(InputIterator first, InputIterator last,
+                         input_iterator_tag) {
+    mmm::vector<value_type> buffer;
+    for (; first != last; ++first)
+      buffer.push_back(*first);
+    return grow_by_range(buffer.begin(), buffer.end(), forward_iterator_tag());
+  }
+  template <class ForwardIterator>
+  iterator grow_by_range(ForwardIterator first, ForwardIterator last,
+                         forward_iterator_tag);
+}; // end of concurrent_vector
+
+template <class T, class Allocator>
+inline void swap(concurrent_vector<T, Allocator> &x,
+                 concurrent_vector<T, Allocator> &y) noexcept {
+  x.swap(y);
+}
+
+//安装段k. 多个线程同时发现段缺失时只有一个CAS成功, 其余释放自己的段.
+template <class T, class Allocator>
+T *concurrent_vector<T, Allocator>::ensure_segment(size_t k) {
+  T *seg = segments_[k].load(std::memory_order_acquire);
+  if (seg)
+    return seg;
+  T *fresh = allocator_type::allocate(segment_alloc_count(k));
+  slot_state *states = segment_states(fresh, k);
+  for (size_t i = 0; i != segment_size(k); ++i)
+    new (states + i) slot_state(kSlotEmpty);
+  if (segments_[k].compare_exchange_strong(seg, fresh,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire))
+    return fresh;
+  allocator_type::deallocate(fresh, segment_alloc_count(k));
+  return seg;
+}
+
+//预留[start, start+n)并保证覆盖它的段都已存在
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::size_type
+concurrent_vector<T, Allocator>::reserve_range(size_type n) {
+  const size_type start = reserved_.fetch_add(n, std::memory_order_relaxed);
+  if (n != 0) {
+    const size_t last = segment_index_of(start + n - 1);
+    for (size_t k = segment_index_of(start); k <= last; ++k)
+      ensure_segment(k);
+  }
+  return start;
+}
+
+//把size_推过其后连续就绪的槽位. 置就绪与这里读状态都用seq_cst:
+//两个线程分别完成相邻槽位时, 至少有一个能看到对方的就绪, 前缀不会停在中途
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::publish() {
+  size_type n = size_.load();
+  while (true) {
+    size_type end = n;
+    for (slot_state *state; (state = state_at(end)) && *state == kSlotReady;)
+      ++end;
+    if (end == n || size_.compare_exchange_weak(n, end))
+      return;
+  }
+}
+
+//[first, last)的构造失败了: 尽量用T()填上, 填不上的标记作废
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::abandon(size_type first,
+                                              size_type last) {
+  for (; first != last; ++first) {
+    unsigned char state = kSlotBroken;
+    if constexpr (std::is_default_constructible<T>::value) {
+      try {
+        new (element_at(first)) T();
+        state = kSlotReady;
+      } catch (...) {
+      }
+    }
+    state_at(first)->store(state);
+  }
+  publish();
+}
+
+template <class T, class Allocator>
+template <class... Args>
+typename concurrent_vector<T, Allocator>::iterator
+concurrent_vector<T, Allocator>::emplace_back(Args &&... args) {
+  const size_type i = reserve_range(1);
+  try {
+    new (element_at(i)) T(mmm::forward<Args>(args)...);
+  } catch (...) {
+    abandon(i, i + 1);
+    throw;
+  }
+  state_at(i)->store(kSlotReady);
+  publish();
+  return iterator(this, i);
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::iterator
+concurrent_vector<T, Allocator>::grow_by(size_type n, const value_type &val) {
+  const size_type start = reserve_range(n);
+  size_type i = start;
+  try {
+    for (; i != start + n; ++i) {
+      new (element_at(i)) T(val);
+      state_at(i)->store(kSlotReady);
+    }
+  } catch (...) {
+    abandon(i, start + n);
+    throw;
+  }
+  publish();
+  return iterator(this, start);
+}
+
+template <class T, class Allocator>
+template <class ForwardIterator>
+typename concurrent_vector<T, Allocator>::iterator
+concurrent_vector<T, Allocator>::grow_by_range(ForwardIterator first,
+                                               ForwardIterator last,
+                                               forward_iterator_tag) {
+  const size_type n = mmm::distance(first, last);
+  const size_type start = reserve_range(n);
+  size_type i = start;
+  try {
+    for (; i != start + n; ++i, ++first) {
+      new (element_at(i)) T(*first);
+      state_at(i)->store(kSlotReady);
+    }
+  } catch (...) {
+    abandon(i, start + n);
+    throw;
+  }
+  publish();
+  return iterator(this, start);
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::size_type
+concurrent_vector<T, Allocator>::capacity() const noexcept {
+  size_type cap = 0;
+  for (size_t k = 0; k != kNumOfSegments; ++k) {
+    if (!segments_[k].load(std::memory_order_acquire))
+      break;
+    cap = segment_base(k) + segment_size(k);
+  }
+  return cap;
+}
+
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::reserve(size_type n) {
+  if (n == 0)
+    return;
+  const size_t last = segment_index_of(n - 1);
+  for (size_t k = 0; k <= last; ++k)
+    ensure_segment(k);
+}
+
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::clear() {
+  //作废槽位之后可能还有已构造的元素, 按状态逐个析构
+  const size_type n = reserved_.load(std::memory_order_relaxed);
+  for (size_type i = 0; i != n; ++i) {
+    slot_state *state = state_at(i);
+    if (!state) //预留时段分配失败
+      continue;
+    if (*state == kSlotReady)
+      mmm::destroy(element_at(i));
+    state->store(kSlotEmpty, std::memory_order_relaxed);
+  }
+  reserved_.store(0, std::memory_order_relaxed);
+  size_.store(0, std::memory_order_release);
+}
+
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::release_segments() {
+  clear();
+  for (size_t k = 0; k != kNumOfSegments; ++k) {
+    T *seg = segments_[k].load(std::memory_order_relaxed);
+    if (seg)
+      allocator_type::deallocate(seg, segment_alloc_count(k));
+    segments_[k].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::swap(concurrent_vector &other) noexcept {
+  if (this == &other)
+    return;
+  for (size_t k = 0; k != kNumOfSegments; ++k) {
+    T *tmp = segments_[k].load(std::memory_order_relaxed);
+    segments_[k].store(other.segments_[k].load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+    other.segments_[k].store(tmp, std::memory_order_relaxed);
+  }
+  size_t r = reserved_.load(std::memory_order_relaxed);
+  reserved_.store(other.reserved_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  other.reserved_.store(r, std::memory_order_relaxed);
+  size_t s = size_.load(std::memory_order_relaxed);
+  size_.store(other.size_.load(std::memory_order_relaxed),
+              std::memory_order_release);
+  other.size_.store(s, std::memory_order_release);
+}
+
+template <class T, class Allocator>
+bool operator==(const concurrent_vector<T, Allocator> &x,
+                const concurrent_vector<T, Allocator> &y) {
+  return x.size() == y.size() && mmm::equal(x.begin(), x.end(), y.begin());
+}
+template <class T, class Allocator>
+bool operator!=(const concurrent_vector<T, Allocator> &x,
+                const concurrent_vector<T, Allocator> &y) {
+  return !(x == y);
+}
+
+} // namespace mmm
+
+#endif
@@ -7,17 +7,45 @@
 #include "iterator.h"
 #include "type_traits.h"
 #include "utility.h"
+#include <new>
 namespace mmm {
 
+//默认块大小(字节), 可通过deque的第三个模板参数修改
 #define _MMM_DEQUE_BUF_SIZE 512
 
+//每块元素个数: BufBytes/sizeof(T)向上取整到2的幂(至少为1),
+//这样随机访问只需移位和掩码, 不需要除法和取模.
+template <typename T, size_t BufBytes> struct deque_buf_traits {
+private:
+  static constexpr size_t round_pow2(size_t n) {
+    size_t r = 1;
+    while (r < n)
+      r <<= 1;
+    return r;
+  }
+  static constexpr size_t log2(size_t n) {
+    size_t k = 0;
+    while (n >>= 1)
+      ++k;
+    return k;
+  }
+
+public:
+  static constexpr size_t len =
+      round_pow2(sizeof(T) < BufBytes ? BufBytes / sizeof(T) : size_t(1));
+  static constexpr size_t shift = log2(len);
+  static constexpr size_t mask = len - 1;
+};
+
 // template <typename T, typename Ref, typename Ptr> 兼容const_iterator.
 // ex: iterator<int,int&,int*> 对应 const_iterator<int,const int&,const int*> hav
 //  same ::iterator. so constructor is same.
-template <typename T, typename Ref, typename Ptr> struct deque_iterator {
+template <typename T, typename Ref, typename Ptr,
+          size_t BufBytes = _MMM_DEQUE_BUF_SIZE>
+struct deque_iterator {
 
-  typedef deque_iterator<T, T &, T *> iterator;
-  typedef deque_iterator<T, const T &, const T *> const_iterator;
+  typedef deque_iterator<T, T &, T *, BufBytes> iterator;
+  typedef deque_iterator<T, const T &, const T *, BufBytes> const_iterator;
   typedef T value_type;
   typedef mmm::random_access_iterator_tag iterator_category;
   typedef Ptr pointer;
@@ -26,17 +54,14 @@ template <typename T, typename Ref, typename Ptr> struct deque_iterator {
   typedef ptrdiff_t difference_type;
   typedef deque_iterator self;
   typedef T **map_pointer;
+  typedef deque_buf_traits<T, BufBytes> buf_traits;
 
   pointer cur_;
   pointer first_;
   pointer last_;
   map_pointer map_;
 
-  static inline size_t deque_buf_len() {
-    return (sizeof(T) < _MMM_DEQUE_BUF_SIZE
-                ? size_t(_MMM_DEQUE_BUF_SIZE / sizeof(T))
-                : size_t(1));
-  }
+  static constexpr size_t deque_buf_len() { return buf_traits::len; }
   deque_iterator()
       : cur_(nullptr), first_(nullptr), last_(nullptr), map_(nullptr) {}
 
@@ -80,18 +105,17 @@ template <typename T, typename Ref, typename Ptr> struct deque_iterator {
     return tmp;
   }
 
+  //块长为2的幂: 块号 = offset >> shift, 块内位置 = offset & mask
   self &operator+=(difference_type n) {
     const difference_type offset = n + (cur_ - first_);
-    if (offset >= 0 && offset < difference_type(deque_buf_len()))
+    if (size_t(offset) < deque_buf_len())
       cur_ += n;
     else {
-      //超过尾部
       const difference_type node_offset =
-          offset > 0 ? offset / difference_type(deque_buf_len())
-                     : -difference_type((-offset - 1) / deque_buf_len()) -
-                           1; // map + i
+          offset > 0 ? offset >> buf_traits::shift
+                     : -difference_type((-offset - 1) >> buf_traits::shift) - 1;
       set_map(map_ + node_offset);
-      cur_ = first_ + (offset - node_offset * difference_type(deque_buf_len()));
+      cur_ = first_ + (offset & difference_type(buf_traits::mask));
     }
     return *this;
   }
@@ -125,40 +149,77 @@ template <typename T, typename Ref, typename Ptr> struct deque_iterator {
   }
 };
 
-template <typename T, typename Ref, typename Ptr>
-void swap(deque_iterator<T, Ref, Ptr> x, deque_iterator<T, Ref, Ptr> y){
+template <typename T, typename Ref, typename Ptr, size_t B>
+void swap(deque_iterator<T, Ref, Ptr, B> x, deque_iterator<T, Ref, Ptr, B> y){
   x.swap(y);
 }
 
-template <typename T, typename Ref, typename Ptr>
-inline typename deque_iterator<T, Ref, Ptr>::difference_type
-operator-(const deque_iterator<T, Ref, Ptr> &x,
-          const deque_iterator<T, Ref, Ptr> &y) {
-  return typename deque_iterator<T, Ref, Ptr>::difference_type(
-             deque_iterator<T, Ref, Ptr>::deque_buf_len()) *
-             (x.map_ - y.map_ - 1) +
+template <typename T, typename Ref, typename Ptr, size_t B>
+inline typename deque_iterator<T, Ref, Ptr, B>::difference_type
+operator-(const deque_iterator<T, Ref, Ptr, B> &x,
+          const deque_iterator<T, Ref, Ptr, B> &y) {
+  typedef typename deque_iterator<T, Ref, Ptr, B>::difference_type
+      difference_type;
+  return ((x.map_ - y.map_ - 1) *
+          difference_type(deque_buf_traits<T, B>::len)) +
          (x.cur_ - x.first_) + (y.last_ - y.cur_);
 }
 
-template <typename T, typename Ref, typename Ptr>
-inline bool operator==(const deque_iterator<T, Ref, Ptr> &x,
-                       const deque_iterator<T, Ref, Ptr> &y) {
+template <typename T, typename Ref, typename Ptr, size_t B>
+inline bool operator==(const deque_iterator<T, Ref, Ptr, B> &x,
+                       const deque_iterator<T, Ref, Ptr, B> &y) {
   return x.cur_ == y.cur_;
 }
 
-template <typename T, typename Ref, typename Ptr>
-inline bool operator!=(const deque_iterator<T, Ref, Ptr> &x,
-                       const deque_iterator<T, Ref, Ptr> &y) {
+template <typename T, typename Ref, typename Ptr, size_t B>
+inline bool operator!=(const deque_iterator<T, Ref, Ptr, B> &x,
+                       const deque_iterator<T, Ref, Ptr, B> &y) {
   return !(x == y);
 }
 
+// deque_iterator是分段迭代器: 段为map中的一个槽位, 段内为原始指针.
+// copy/fill/find等算法借此按块处理.
+template <typename T, typename Ref, typename Ptr, size_t B>
+struct segmented_iterator_traits<deque_iterator<T, Ref, Ptr, B>> {
+  typedef true_type is_segmented_iterator;
+  typedef deque_iterator<T, Ref, Ptr, B> iterator;
+  typedef typename iterator::map_pointer segment_iterator;
+  typedef Ptr local_iterator;
+
+  static segment_iterator segment(const iterator &it) { return it.map_; }
+  static local_iterator local(const iterator &it) { return it.cur_; }
+  static local_iterator begin(segment_iterator s) { return *s; }
+  static local_iterator end(segment_iterator s) {
+    return *s + deque_buf_traits<T, B>::len;
+  }
+  //落在段末尾时规范化到下一段的开头, 与operator++一致
+  static iterator compose(segment_iterator s, local_iterator l) {
+    iterator it;
+    if (l == end(s)) {
+      it.set_map(s + 1);
+      it.cur_ = it.first_;
+    } else {
+      it.set_map(s);
+      it.cur_ = l;
+    }
+    return it;
+  }
+};
+
 // -------------------------------------------------------------------------
 // deque
-template <class T, class Alloc = allocator<T>> class deque {
+// map_是一段T*数组, 只有[begin_.map_, end_.map_]之间的槽位指向已分配的块,
+// 其余槽位为空. 块在第一次被使用时才分配, end_.cur_总是指向一个已分配块内部.
+// map不够用时只搬动块指针(居中或换更大的map), 元素本身从不移动.
+// 空出来的块先放进备用块链表(spare_), 下次需要新块时优先复用; 备用块个数超过
+// max_spare_blocks()才真正还给allocator. FIFO使用时内存保持平稳.
+template <class T, class Alloc = allocator<T>,
+          size_t BufBytes = _MMM_DEQUE_BUF_SIZE>
+class deque {
 public:
   typedef T value_type;
-  typedef deque_iterator<T, T &, T *> iterator;
-  typedef deque_iterator<T, const T &, const T *> const_iterator;
+  typedef deque_iterator<T, T &, T *, BufBytes> iterator;
+  typedef deque_iterator<T, const T &, const T *, BufBytes> const_iterator;
   typedef T &reference;
   typedef const T &const_reference;
   typedef size_t size_type;
@@ -167,20 +228,36 @@ public:
 
 private:
   typedef Alloc dataAllocator;
+  typedef allocator<T *> mapAllocator;
+  typedef T **map_pointer;
+  typedef deque_buf_traits<T, BufBytes> buf_traits;
+
+  enum { kInitialMapSize = 8, kDefaultMaxSpareBlocks = 4 };
 
 private:
   iterator begin_;
   iterator end_;
   size_type map_len;
   T **map_;
+  T *spare_;               //备用块链表, 块首存放下一个备用块的地址
+  size_type spare_count_;
+  size_type max_spare_;    //高水位
 
 public:
-  deque();
-  explicit deque(size_type n, const value_type &val = value_type()) : deque() {
+  deque()
+      : map_len(0), map_(0), spare_(0), spare_count_(0),
+        max_spare_(kDefaultMaxSpareBlocks) {
+    initialize_map(0);
+  }
+  explicit deque(size_type n, const value_type &val = value_type())
+      : map_len(0), map_(0), spare_(0), spare_count_(0),
+        max_spare_(kDefaultMaxSpareBlocks) {
     deque_aux(n, val, is_integer<size_type>());
   }
   template <class InputIterator>
-  deque(InputIterator first, InputIterator last) : deque() {
+  deque(InputIterator first, InputIterator last)
+      : map_len(0), map_(0), spare_(0), spare_count_(0),
+        max_spare_(kDefaultMaxSpareBlocks) {
     deque_aux(first, last, is_integer<InputIterator>());
   }
   deque(const deque &x);
@@ -215,7 +292,11 @@ public:
   size_type size() const noexcept { return end() - begin(); }
   bool empty() const noexcept { return begin() == end(); }
 
-  reference operator[](size_type n) { return *(begin() + n); }
+  //以begin_所在块为基址, 移位得到块号, 掩码得到块内位置
+  reference operator[](size_type n) {
+    const size_type offset = n + (begin_.cur_ - begin_.first_);
+    return begin_.map_[offset >> buf_traits::shift][offset & buf_traits::mask];
+  }
   reference front() { return *begin(); }
   const_reference front() const { return *begin(); }
 
@@ -223,46 +304,197 @@ public:
 
   const_reference back() const { return *(end() - 1); }
 
-  reference operator[](size_type n) const { return *(begin() + n); }
+  reference operator[](size_type n) const {
+    const size_type offset = n + (begin_.cur_ - begin_.first_);
+    return begin_.map_[offset >> buf_traits::shift][offset & buf_traits::mask];
+  }
 
-  void push_back(const value_type &val);
-  void push_front(const value_type &val);
-  void pop_back() {
-    --end_;
-    mmm::destroy(end_.cur_);
+  void push_back(const value_type &val) { emplace_back(val); }
+  void push_back(value_type &&val) { emplace_back(mmm::move(val)); }
+  void push_front(const value_type &val) { emplace_front(val); }
+  void push_front(value_type &&val) { emplace_front(mmm::move(val)); }
+  template <class... Args> reference emplace_back(Args &&... args);
+  template <class... Args> reference emplace_front(Args &&... args);
+  void pop_back();
+  void pop_front();
+
+  //中间插入/删除: 移动离position较近一侧的元素
+  template <class... Args> iterator emplace(iterator position, Args &&... args);
+  iterator insert(iterator position, const value_type &val);
+  iterator insert(iterator position, value_type &&val);
+  void insert(iterator position, size_type n, const value_type &val) {
+    insert_aux(position, n, val, true_type());
+  }
+  template <class InputIterator>
+  void insert(iterator position, InputIterator first, InputIterator last) {
+    insert_aux(position, first, last, is_integer<InputIterator>());
+  }
+  iterator erase(iterator position);
+  iterator erase(iterator first, iterator last);
+
+  //批量追加: map只预留一次, 整块用uninitialized_copy填充
+  template <class InputIterator> void append(InputIterator first, InputIterator last) {
+    append_aux(first, last, iterator_category<InputIterator>());
   }
-  void pop_front() {
-    mmm::destroy(begin_.cur_);
-    ++begin_;
+  template <class InputIterator> void prepend(InputIterator first, InputIterator last) {
+    prepend_aux(first, last, iterator_category<InputIterator>());
   }
   void swap(deque &x) noexcept{
     mmm::swap(map_len, x.map_len);
     mmm::swap(map_, x.map_);
     begin_.swap(x.begin_);
     end_.swap(x.end_);
+    mmm::swap(spare_, x.spare_);
+    mmm::swap(spare_count_, x.spare_count_);
+    mmm::swap(max_spare_, x.max_spare_);
   }
   void clear();
 
+  //备用块: 超过高水位的空闲块直接释放
+  size_type spare_blocks() const noexcept { return spare_count_; }
+  size_type max_spare_blocks() const noexcept { return max_spare_; }
+  void set_max_spare_blocks(size_type n) {
+    max_spare_ = n;
+    trim_spare(n);
+  }
+  //释放所有备用块, 并把map缩小到刚好容纳当前的块
+  void shrink_to_fit();
+
 private:
-  static inline size_t deque_buf_len() {
-    return (sizeof(T) < _MMM_DEQUE_BUF_SIZE
-                ? size_t(_MMM_DEQUE_BUF_SIZE / sizeof(T))
-                : size_t(1));
+  static constexpr size_t deque_buf_len() { return buf_traits::len; }
+  //备用块链表把next指针存在块里, 块太小(如deque<char, Alloc, 4>)时多分配一些
+  static constexpr size_t block_alloc_len() {
+    return deque_buf_len() * sizeof(T) >= sizeof(T *)
+               ? deque_buf_len()
+               : (sizeof(T *) + sizeof(T) - 1) / sizeof(T);
+  }
+
+  T *allocate_block() {
+    if (spare_) {
+      T *p = spare_;
+      spare_ = *reinterpret_cast<T **>(p);
+      --spare_count_;
+      return p;
+    }
+    return dataAllocator::allocate(block_alloc_len());
+  }
+  void deallocate_block(T *p) {
+    if (spare_count_ < max_spare_) {
+      *reinterpret_cast<T **>(p) = spare_;
+      spare_ = p;
+      ++spare_count_;
+    } else {
+      dataAllocator::deallocate(p, block_alloc_len());
+    }
+  }
+  void trim_spare(size_type n) {
+    while (spare_count_ > n) {
+      T *p = spare_;
+      spare_ = *reinterpret_cast<T **>(p);
+      --spare_count_;
+      dataAllocator::deallocate(p, block_alloc_len());
+    }
+  }
+  void initialize_map(size_type num_elements);
+  void reserve_map_at_back(size_type nodes_to_add = 1) {
+    if (nodes_to_add + 1 > map_len - (end_.map_ - map_))
+      reallocate_map(nodes_to_add, false);
+  }
+  void reserve_map_at_front(size_type nodes_to_add = 1) {
+    if (nodes_to_add > size_type(begin_.map_ - map_))
+      reallocate_map(nodes_to_add, true);
+  }
+  void reallocate_map(size_type nodes_to_add, bool add_at_front);
+  //为end_之后(begin_之前)的n个元素分配好块, 返回新的end_(begin_), 不构造元素
+  iterator reserve_elements_at_back(size_type n);
+  iterator reserve_elements_at_front(size_type n);
+  //构造抛出时归还上面预留的块. 起止已经挪过去的话什么也不做
+  void free_blocks_at_back(iterator new_finish) {
+    for (map_pointer cur = end_.map_ + 1; cur <= new_finish.map_; ++cur) {
+      deallocate_block(*cur);
+      *cur = nullptr;
+    }
+  }
+  void free_blocks_at_front(iterator new_start) {
+    for (map_pointer cur = new_start.map_; cur < begin_.map_; ++cur) {
+      deallocate_block(*cur);
+      *cur = nullptr;
+    }
+  }
+  void destroy_range(iterator first, iterator last) {
+    for (; first != last; ++first)
+      mmm::destroy(first.cur_);
   }
 
-  T **get_new_map(const size_t size);
-  size_t get_new_map_size() { return (map_len == 0 ? 2 : map_len * 2); }
-  bool is_reach_map_tail() const;
-  bool is_reach_map_head() const;
   void deque_aux(size_t n, const value_type &val, true_type);
   template <class Iterator>
-  void deque_aux(Iterator first, Iterator last, false_type);
-  void enlarge_map();
+  void deque_aux(Iterator first, Iterator last, false_type) {
+    range_initialize(first, last, iterator_category<Iterator>());
+  }
+  template <class InputIterator>
+  void range_initialize(InputIterator first, InputIterator last,
+                        input_iterator_tag);
+  template <class ForwardIterator>
+  void range_initialize(ForwardIterator first, ForwardIterator last,
+                        forward_iterator_tag);
+
+  iterator insert_aux(iterator position, value_type &&x);
+  void insert_aux(iterator position, size_type n, const value_type &val,
+                  true_type);
+  template <class Integer>
+  void insert_aux(iterator position, Integer n, Integer val, true_type) {
+    insert_aux(position, size_type(n), value_type(val), true_type());
+  }
+  template <class InputIterator>
+  void insert_aux(iterator position, InputIterator first, InputIterator last,
+                  false_type) {
+    range_insert(position, first, last, iterator_category<InputIterator>());
+  }
+  template <class InputIterator>
+  void range_insert(iterator position, InputIterator first, InputIterator last,
+                    input_iterator_tag);
+  template <class ForwardIterator>
+  void range_insert(iterator position, ForwardIterator first,
+                    ForwardIterator last, forward_iterator_tag);
+
+  template <class InputIterator>
+  void append_aux(InputIterator first, InputIterator last, input_iterator_tag) {
+    for (; first != last; ++first)
+      emplace_back(*first);
+  }
+  template <class ForwardIterator>
+  void append_aux(ForwardIterator first, ForwardIterator last,
+                  forward_iterator_tag) {
+    iterator new_finish = reserve_elements_at_back(mmm::distance(first, last));
+    try {
+      mmm::uninitialized_copy(first, last, end_);
+    } catch (...) {
+      free_blocks_at_back(new_finish);
+      throw;
+    }
+    end_ = new_finish;
+  }
+  template <class InputIterator>
+  void prepend_aux(InputIterator first, InputIterator last,
+                   input_iterator_tag);
+  template <class ForwardIterator>
+  void prepend_aux(ForwardIterator first, ForwardIterator last,
+                   forward_iterator_tag) {
+    iterator new_start = reserve_elements_at_front(mmm::distance(first, last));
+    try {
+      mmm::uninitialized_copy(first, last, new_start);
+    } catch (...) {
+      free_blocks_at_front(new_start);
+      throw;
+    }
+    begin_ = new_start;
+  }
 
 	void release_map(){
-    for (size_t i = 0; i != map_len; ++i) 
-        dataAllocator::deallocate(map_[i], deque_buf_len());
-    allocator<T*>::deallocate(map_,map_len);
+    for (map_pointer cur = begin_.map_; cur <= end_.map_; ++cur)
+      dataAllocator::deallocate(*cur, block_alloc_len());
+    trim_spare(0);
+    mapAllocator::deallocate(map_, map_len);
 	}
 }; // end of deque
 
@@ -271,147 +503,497 @@ private:
 //不要在类内friend swap<self>. 会导致签名冲突
 //注意gcc禁止内部定义friend, 而clang则允许
 //swap应该仅调用成员函数swap. 因为是类负责封装提供swap的语义
-template <class T, class Alloc>
-inline void swap(deque<T, Alloc>&x, deque<T, Alloc> &y) noexcept {
+template <class T, class Alloc, size_t B>
+inline void swap(deque<T, Alloc, B>&x, deque<T, Alloc, B> &y) noexcept {
     x.swap(y);
 }
 
-template <class T, class Alloc>
-T **deque<T, Alloc>::get_new_map(const size_t size) {
-  // T **map = new T *[size];
-  T **map = allocator<T*>::allocate(size);
-  for (size_t i = 0; i != size; ++i)
-    map[i] = dataAllocator::allocate(deque_buf_len());
-  return map;
-}
-
-template <class T, class Alloc> deque<T, Alloc>::deque() : map_len(0), map_(0) {
-  map_len = 2; //先申请两个段,便于中间(push_back,push_front) ---中----
-  map_ = get_new_map(map_len);
-  begin_.set_map(&map_[map_len - 1]);
-  end_.set_map(&map_[map_len - 1]);
-  begin_.cur_ = end_.cur_ = map_[map_len - 1];
-}
-
-template <class T, class Alloc>
-deque<T, Alloc>::deque(const deque &x) : map_len(0), map_(0) {
-  map_len = x.map_len;
-  map_ = get_new_map(map_len);
-  auto offset = typename deque::iterator::difference_type(
-                    deque::iterator::deque_buf_len()) *
-                    (x.begin().map_ - x.map_ - 1) +
-                (x.begin().cur_ - x.begin().first_) +
-                (x.begin().last_ - x.begin().cur_);
-
-  begin_.set_map(&map_[map_len - 1]);
-  end_.set_map(&map_[map_len - 1]);
-  begin_.cur_ = end_.cur_ = map_[map_len - 1];
-  begin_ = begin_ + offset;
-  end_ = begin_;
-  for (auto cur = x.begin(); cur != x.end(); ++cur)
-    push_back(*cur);
-}
+//为num_elements个元素准备map和块, 块位于map中间, 两端留出空槽
+template <class T, class Alloc, size_t B>
+void deque<T, Alloc, B>::initialize_map(size_type num_elements) {
+  const size_type num_nodes = (num_elements >> buf_traits::shift) + 1;
+  map_len = num_nodes + 2 > size_type(kInitialMapSize) ? num_nodes + 2
+                                                       : size_type(kInitialMapSize);
+  map_ = mapAllocator::allocate(map_len);
+  for (size_type i = 0; i != map_len; ++i)
+    map_[i] = nullptr;
 
-template <class T, class Alloc> void deque<T, Alloc>::enlarge_map() {
-  auto newMapSize = get_new_map_size();
-  T **newMap = get_new_map(newMapSize);
-  size_t startIndex = newMapSize / 4;
+  map_pointer nstart = map_ + (map_len - num_nodes) / 2;
+  map_pointer nfinish = nstart + num_nodes - 1;
+  for (map_pointer cur = nstart; cur <= nfinish; ++cur)
+    *cur = allocate_block();
+  begin_.set_map(nstart);
+  end_.set_map(nfinish);
+  begin_.cur_ = begin_.first_;
+  end_.cur_ = end_.first_ + (num_elements & buf_traits::mask);
+}
 
-  iterator dst;
-  dst.set_map(&newMap[startIndex]);
+//map一端空槽不足: 旧map足够大则把块指针居中, 否则换一个更大的map. 只复制指针.
+template <class T, class Alloc, size_t B>
+void deque<T, Alloc, B>::reallocate_map(size_type nodes_to_add,
+                                     bool add_at_front) {
+  const size_type old_num_nodes = end_.map_ - begin_.map_ + 1;
+  const size_type new_num_nodes = old_num_nodes + nodes_to_add;
 
-  for (auto cur = begin(); cur != end(); ++cur) 
-    *dst = *cur;
-  
-  auto size = this->size();
+  map_pointer new_start;
+  if (map_len > 2 * new_num_nodes) {
+    new_start = map_ + (map_len - new_num_nodes) / 2 +
+                (add_at_front ? nodes_to_add : 0);
+    if (new_start < begin_.map_)
+      mmm::copy(begin_.map_, end_.map_ + 1, new_start);
+    else
+      mmm::copy_backward(begin_.map_, end_.map_ + 1, new_start + old_num_nodes);
+    //搬走后留下的槽位清空
+    for (map_pointer cur = map_; cur != new_start; ++cur)
+      *cur = nullptr;
+    for (map_pointer cur = new_start + old_num_nodes; cur != map_ + map_len; ++cur)
+      *cur = nullptr;
+  } else {
+    const size_type new_map_len =
+        map_len + (map_len > nodes_to_add ? map_len : nodes_to_add) + 2;
+    map_pointer new_map = mapAllocator::allocate(new_map_len);
+    for (size_type i = 0; i != new_map_len; ++i)
+      new_map[i] = nullptr;
+    new_start = new_map + (new_map_len - new_num_nodes) / 2 +
+                (add_at_front ? nodes_to_add : 0);
+    mmm::copy(begin_.map_, end_.map_ + 1, new_start);
+    mapAllocator::deallocate(map_, map_len);
+    map_ = new_map;
+    map_len = new_map_len;
+  }
+  begin_.set_map(new_start);
+  end_.set_map(new_start + old_num_nodes - 1);
+}
 
-  // clear();
-  release_map();
-  map_len = newMapSize;
-  map_ = newMap;
-  begin_.set_map(&map_[startIndex]);
-  begin_.cur_ = map_[startIndex];
-  end_ = begin_ + size;
+template <class T, class Alloc, size_t B>
+deque<T, Alloc, B>::deque(const deque &x)
+    : map_len(0), map_(0), spare_(0), spare_count_(0),
+      max_spare_(x.max_spare_) {
+  initialize_map(x.size());
+  mmm::uninitialized_copy(x.begin(), x.end(), begin_);
 }
-template <class T, class Alloc>
-bool deque<T, Alloc>::is_reach_map_tail() const {
-  // return map_[map_len] == end().cur_;
-  return &map_[map_len] == end().map_;
+
+template <class T, class Alloc, size_t B>
+template <class... Args>
+typename deque<T, Alloc, B>::reference
+deque<T, Alloc, B>::emplace_front(Args &&... args) {
+  if (begin_.cur_ != begin_.first_) {
+    new (begin_.cur_ - 1) T(mmm::forward<Args>(args)...);
+    --begin_.cur_;
+  } else {
+    //前一个槽位还没有块
+    reserve_map_at_front();
+    *(begin_.map_ - 1) = allocate_block();
+    try {
+      new (*(begin_.map_ - 1) + deque_buf_len() - 1)
+          T(mmm::forward<Args>(args)...);
+    } catch (...) {
+      //新块在[begin_, end_)之外, 不还回去就没人释放了
+      deallocate_block(*(begin_.map_ - 1));
+      *(begin_.map_ - 1) = nullptr;
+      throw;
+    }
+    begin_.set_map(begin_.map_ - 1);
+    begin_.cur_ = begin_.last_ - 1;
+  }
+  return *begin_.cur_;
 }
-template <class T, class Alloc>
-bool deque<T, Alloc>::is_reach_map_head() const {
-  return map_[0] == begin().cur_;
+
+template <class T, class Alloc, size_t B>
+template <class... Args>
+typename deque<T, Alloc, B>::reference
+deque<T, Alloc, B>::emplace_back(Args &&... args) {
+  if (end_.cur_ != end_.last_ - 1) {
+    new (end_.cur_) T(mmm::forward<Args>(args)...);
+    ++end_.cur_;
+    return *(end_.cur_ - 1);
+  }
+  //当前块将被填满, 为end_准备下一个块
+  reserve_map_at_back();
+  *(end_.map_ + 1) = allocate_block();
+  try {
+    new (end_.cur_) T(mmm::forward<Args>(args)...);
+  } catch (...) {
+    deallocate_block(*(end_.map_ + 1));
+    *(end_.map_ + 1) = nullptr;
+    throw;
+  }
+  end_.set_map(end_.map_ + 1);
+  end_.cur_ = end_.first_;
+  return *(*(end_.map_ - 1) + deque_buf_len() - 1);
 }
-template <class T, class Alloc>
-void deque<T, Alloc>::push_front(const value_type &val) {
-  if (is_reach_map_head())
-    enlarge_map();
-  --begin_;
-  mmm::construct(begin_.cur_, val);
+
+template <class T, class Alloc, size_t B> void deque<T, Alloc, B>::pop_back() {
+  if (end_.cur_ != end_.first_) {
+    --end_.cur_;
+    mmm::destroy(end_.cur_);
+  } else {
+    deallocate_block(end_.first_);
+    *end_.map_ = nullptr;
+    end_.set_map(end_.map_ - 1);
+    end_.cur_ = end_.last_ - 1;
+    mmm::destroy(end_.cur_);
+  }
 }
 
-template <class T, class Alloc>
-void deque<T, Alloc>::push_back(const value_type &val) {
-  if (is_reach_map_tail()) {
-    enlarge_map();
+template <class T, class Alloc, size_t B> void deque<T, Alloc, B>::pop_front() {
+  mmm::destroy(begin_.cur_);
+  if (begin_.cur_ != begin_.last_ - 1) {
+    ++begin_.cur_;
+  } else {
+    deallocate_block(begin_.first_);
+    *begin_.map_ = nullptr;
+    begin_.set_map(begin_.map_ + 1);
+    begin_.cur_ = begin_.first_;
   }
-  mmm::construct(end_.cur_, val);
-  ++end_;
 }
 
 //以迭代器/n个构造deque
-template <class T, class Alloc>
-void deque<T, Alloc>::deque_aux(size_t n, const value_type &val, true_type) {
-  size_t i = 0;
-  for (; i != n / 2; ++i)
-    push_front(val);
-  for (; i != n; ++i)
-    push_back(val);
-}
-
-template <class T, class Alloc>
-template <class Iterator>
-void deque<T, Alloc>::deque_aux(Iterator first, Iterator last, false_type) {
-  difference_type mid = (last - first) / 2;
-  for (auto it = first + mid; it != first - 1; --it)
-    push_front(*it);
-  for (auto it = first + mid + 1; it != last; ++it)
-    push_back(*it);
-}
-template <class T, class Alloc> void deque<T, Alloc>::clear() {
-  for (auto cur = begin(); cur != end(); ++cur) 
-    mmm::destroy(cur.cur_);
+template <class T, class Alloc, size_t B>
+void deque<T, Alloc, B>::deque_aux(size_t n, const value_type &val, true_type) {
+  initialize_map(n);
+  mmm::uninitialized_fill(begin_, end_, val);
+}
+
+template <class T, class Alloc, size_t B>
+template <class InputIterator>
+void deque<T, Alloc, B>::range_initialize(InputIterator first,
+                                          InputIterator last,
+                                          input_iterator_tag) {
+  initialize_map(0);
+  for (; first != last; ++first)
+    emplace_back(*first);
+}
+
+//个数已知: 一次分配好map和块, 再整块复制
+template <class T, class Alloc, size_t B>
+template <class ForwardIterator>
+void deque<T, Alloc, B>::range_initialize(ForwardIterator first,
+                                          ForwardIterator last,
+                                          forward_iterator_tag) {
+  initialize_map(mmm::distance(first, last));
+  mmm::uninitialized_copy(first, last, begin_);
+}
 
-  // for (size_t i = 0; i != map_len; ++i) {
-  //   for (auto p = map_[i]; !p && p != map_[i] + deque_buf_len(); ++p)
-  //     mmm::destroy(p);
-  // }
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::reserve_elements_at_back(size_type n) {
+  //end_所在块之后还需要的块数
+  const size_type new_nodes =
+      (size_type(end_.cur_ - end_.first_) + n) >> buf_traits::shift;
+  if (new_nodes != 0) {
+    reserve_map_at_back(new_nodes);
+    for (size_type i = 1; i <= new_nodes; ++i)
+      *(end_.map_ + i) = allocate_block();
+  }
+  return end_ + difference_type(n);
+}
+
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::reserve_elements_at_front(size_type n) {
+  const size_type vacancies = begin_.cur_ - begin_.first_;
+  if (n > vacancies) {
+    const size_type new_nodes =
+        (n - vacancies + deque_buf_len() - 1) >> buf_traits::shift;
+    reserve_map_at_front(new_nodes);
+    for (size_type i = 1; i <= new_nodes; ++i)
+      *(begin_.map_ - i) = allocate_block();
+  }
+  return begin_ - difference_type(n);
+}
+
+template <class T, class Alloc, size_t B>
+template <class InputIterator>
+void deque<T, Alloc, B>::prepend_aux(InputIterator first, InputIterator last,
+                                     input_iterator_tag) {
+  //逐个放到前端后顺序是反的, 再翻转回来
+  size_type n = 0;
+  for (; first != last; ++first, ++n)
+    emplace_front(*first);
+  for (iterator lo = begin_, hi = begin_ + difference_type(n);
+       lo != hi && lo != --hi; ++lo)
+    mmm::iter_swap(lo, hi);
+}
+
+template <class T, class Alloc, size_t B>
+template <class... Args>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::emplace(iterator position, Args &&... args) {
+  if (position.cur_ == begin_.cur_) {
+    emplace_front(mmm::forward<Args>(args)...);
+    return begin_;
+  }
+  if (position.cur_ == end_.cur_) {
+    emplace_back(mmm::forward<Args>(args)...);
+    return end_ - 1;
+  }
+  value_type x(mmm::forward<Args>(args)...);
+  return insert_aux(position, mmm::move(x));
+}
+
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::insert(iterator position, const value_type &val) {
+  return emplace(position, val);
+}
 
-  //指向中间
-  begin_.set_map(&map_[map_len / 2]);
-  end_.set_map(&map_[map_len / 2]);
-  begin_.cur_ = end_.cur_ = map_[map_len / 2];
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::insert(iterator position, value_type &&val) {
+  return emplace(position, mmm::move(val));
 }
 
-template <class T, class Alloc> deque<T, Alloc>::~deque() {
-  clear();
-  for (size_t i = 0; i != map_len; ++i)
-    dataAllocator::deallocate(map_[i], deque_buf_len());
+//插入一个: 在较短的一侧push一个元素, 再把这一侧整体挪一格
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::insert_aux(iterator position, value_type &&x) {
+  const difference_type index = position - begin_;
+  if (size_type(index) < size() / 2) {
+    emplace_front(front());
+    iterator front1 = begin_ + 1;
+    iterator front2 = front1 + 1;
+    position = begin_ + index;
+    mmm::copy(front2, position + 1, front1);
+  } else {
+    emplace_back(back());
+    iterator back1 = end_ - 1;
+    iterator back2 = back1 - 1;
+    position = begin_ + index;
+    mmm::copy_backward(position, back2, back1);
+  }
+  *position = mmm::move(x);
+  return position;
+}
 
-  // for (size_t i = 0; i != map_len; ++i) {
-  //   for (auto p = map_[i] + 0; !p && p != map_[i] + deque_buf_len(); ++p)
-  //     mmm::destroy(p);
-  //   if (map_[i]){
-  //     dataAllocator::deallocate(map_[i], deque_buf_len());
-  //   }
-  // }
-  //delete[] map_;
-  allocator<T*>::deallocate(map_,map_len);
+template <class T, class Alloc, size_t B>
+void deque<T, Alloc, B>::insert_aux(iterator position, size_type n,
+                                    const value_type &val, true_type) {
+  if (n == 0)
+    return;
+  const difference_type elems_before = position - begin_;
+  const size_type length = size();
+  value_type x_copy(val);
+  if (size_type(elems_before) < length / 2) {
+    iterator new_start = reserve_elements_at_front(n);
+    iterator old_start = begin_;
+    position = begin_ + elems_before;
+    try {
+      if (size_type(elems_before) >= n) {
+        iterator start_n = begin_ + difference_type(n);
+        mmm::uninitialized_copy(begin_, start_n, new_start);
+        begin_ = new_start;
+        mmm::copy(start_n, position, old_start);
+        mmm::fill(position - difference_type(n), position, x_copy);
+      } else {
+        iterator mid = mmm::uninitialized_copy(begin_, position, new_start);
+        try {
+          mmm::uninitialized_fill(mid, old_start, x_copy);
+        } catch (...) {
+          destroy_range(new_start, mid);
+          throw;
+        }
+        begin_ = new_start;
+        mmm::fill(old_start, position, x_copy);
+      }
+    } catch (...) {
+      free_blocks_at_front(new_start);
+      throw;
+    }
+  } else {
+    iterator new_finish = reserve_elements_at_back(n);
+    iterator old_finish = end_;
+    const difference_type elems_after = difference_type(length) - elems_before;
+    position = end_ - elems_after;
+    try {
+      if (size_type(elems_after) > n) {
+        iterator finish_n = end_ - difference_type(n);
+        mmm::uninitialized_copy(finish_n, end_, end_);
+        end_ = new_finish;
+        mmm::copy_backward(position, finish_n, old_finish);
+        mmm::fill(position, position + difference_type(n), x_copy);
+      } else {
+        mmm::uninitialized_fill(end_, position + difference_type(n), x_copy);
+        try {
+          mmm::uninitialized_copy(position, end_, position + difference_type(n));
+        } catch (...) {
+          destroy_range(end_, position + difference_type(n));
+          throw;
+        }
+        end_ = new_finish;
+        mmm::fill(position, old_finish, x_copy);
+      }
+    } catch (...) {
+      free_blocks_at_back(new_finish);
+      throw;
+    }
+  }
+}
+
+template <class T, class Alloc, size_t B>
+template <class InputIterator>
+void deque<T, Alloc, B>::range_insert(iterator position, InputIterator first,
+                                      InputIterator last, input_iterator_tag) {
+  for (; first != last; ++first) {
+    position = insert(position, *first);
+    ++position;
+  }
+}
+
+//与insert(position, n, val)相同的思路, 只是新元素来自[first, last)
+template <class T, class Alloc, size_t B>
+template <class ForwardIterator>
+void deque<T, Alloc, B>::range_insert(iterator position, ForwardIterator first,
+                                      ForwardIterator last,
+                                      forward_iterator_tag) {
+  const size_type n = mmm::distance(first, last);
+  if (n == 0)
+    return;
+  const difference_type elems_before = position - begin_;
+  const size_type length = size();
+  if (size_type(elems_before) < length / 2) {
+    iterator new_start = reserve_elements_at_front(n);
+    iterator old_start = begin_;
+    position = begin_ + elems_before;
+    try {
+      if (size_type(elems_before) >= n) {
+        iterator start_n = begin_ + difference_type(n);
+        mmm::uninitialized_copy(begin_, start_n, new_start);
+        begin_ = new_start;
+        mmm::copy(start_n, position, old_start);
+        mmm::copy(first, last, position - difference_type(n));
+      } else {
+        ForwardIterator mid = first;
+        mmm::advance(mid, difference_type(n) - elems_before);
+        iterator it = mmm::uninitialized_copy(begin_, position, new_start);
+        try {
+          mmm::uninitialized_copy(first, mid, it);
+        } catch (...) {
+          destroy_range(new_start, it);
+          throw;
+        }
+        begin_ = new_start;
+        mmm::copy(mid, last, old_start);
+      }
+    } catch (...) {
+      free_blocks_at_front(new_start);
+      throw;
+    }
+  } else {
+    iterator new_finish = reserve_elements_at_back(n);
+    iterator old_finish = end_;
+    const difference_type elems_after = difference_type(length) - elems_before;
+    position = end_ - elems_after;
+    try {
+      if (size_type(elems_after) > n) {
+        iterator finish_n = end_ - difference_type(n);
+        mmm::uninitialized_copy(finish_n, end_, end_);
+        end_ = new_finish;
+        mmm::copy_backward(position, finish_n, old_finish);
+        mmm::copy(first, last, position);
+      } else {
+        ForwardIterator mid = first;
+        mmm::advance(mid, elems_after);
+        iterator it = mmm::uninitialized_copy(mid, last, end_);
+        try {
+          mmm::uninitialized_copy(position, end_, it);
+        } catch (...) {
+          destroy_range(end_, it);
+          throw;
+        }
+        end_ = new_finish;
+        mmm::copy(first, mid, position);
+      }
+    } catch (...) {
+      free_blocks_at_back(new_finish);
+      throw;
+    }
+  }
+}
+
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::erase(iterator position) {
+  const difference_type index = position - begin_;
+  if (size_type(index) < size() / 2) {
+    mmm::copy_backward(begin_, position, position + 1);
+    pop_front();
+  } else {
+    mmm::copy(position + 1, end_, position);
+    pop_back();
+  }
+  return begin_ + index;
+}
+
+//删除一段: 挪动较短的一侧, 空出来的块还给备用链表
+template <class T, class Alloc, size_t B>
+typename deque<T, Alloc, B>::iterator
+deque<T, Alloc, B>::erase(iterator first, iterator last) {
+  if (first.cur_ == begin_.cur_ && last.cur_ == end_.cur_) {
+    clear();
+    return end_;
+  }
+  const difference_type n = last - first;
+  const difference_type elems_before = first - begin_;
+  if (size_type(elems_before) < (size() - n) / 2) {
+    mmm::copy_backward(begin_, first, last);
+    iterator new_start = begin_ + n;
+    destroy_range(begin_, new_start);
+    for (map_pointer cur = begin_.map_; cur < new_start.map_; ++cur) {
+      deallocate_block(*cur);
+      *cur = nullptr;
+    }
+    begin_ = new_start;
+  } else {
+    mmm::copy(last, end_, first);
+    iterator new_finish = end_ - n;
+    destroy_range(new_finish, end_);
+    for (map_pointer cur = new_finish.map_ + 1; cur <= end_.map_; ++cur) {
+      deallocate_block(*cur);
+      *cur = nullptr;
+    }
+    end_ = new_finish;
+  }
+  return begin_ + elems_before;
+}
+
+//销毁所有元素, 只保留begin_所在的块
+template <class T, class Alloc, size_t B> void deque<T, Alloc, B>::clear() {
+  for (auto cur = begin(); cur != end(); ++cur) 
+    mmm::destroy(cur.cur_);
+  for (map_pointer cur = begin_.map_ + 1; cur <= end_.map_; ++cur) {
+    deallocate_block(*cur);
+    *cur = nullptr;
+  }
+  begin_.cur_ = begin_.first_;
+  end_ = begin_;
+}
+
+template <class T, class Alloc, size_t B> void deque<T, Alloc, B>::shrink_to_fit() {
+  trim_spare(0);
+  const size_type num_nodes = end_.map_ - begin_.map_ + 1;
+  const size_type new_map_len = num_nodes + 2;
+  if (new_map_len >= map_len)
+    return;
+  map_pointer new_map = mapAllocator::allocate(new_map_len);
+  new_map[0] = new_map[new_map_len - 1] = nullptr;
+  mmm::copy(begin_.map_, end_.map_ + 1, new_map + 1);
+  mapAllocator::deallocate(map_, map_len);
+  map_ = new_map;
+  map_len = new_map_len;
+  begin_.set_map(map_ + 1);
+  end_.set_map(map_ + num_nodes);
+}
+
+template <class T, class Alloc, size_t B> deque<T, Alloc, B>::~deque() {
+  for (auto cur = begin(); cur != end(); ++cur)
+    mmm::destroy(cur.cur_);
+  release_map();
 }
 
 
-template <class T, class Alloc>
-bool operator==(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <class T, class Alloc, size_t B>
+bool operator==(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   auto cit1 = x.begin(), cit2 = y.begin();
   for (; cit1 != x.end() && cit2 != y.end(); ++cit1, ++cit2) {
     if (*cit1 != *cit2)
@@ -421,28 +1003,28 @@ bool operator==(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
     return true;
   return false;
 }
-template <class T, class Alloc>
-inline bool operator!=(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <class T, class Alloc, size_t B>
+inline bool operator!=(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   return !(x == y);
 }
 
-template <typename T, typename Alloc>
-inline bool operator<(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <typename T, typename Alloc, size_t B>
+inline bool operator<(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   return mmm::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
 }
 
-template <typename T, typename Alloc>
-inline bool operator>(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <typename T, typename Alloc, size_t B>
+inline bool operator>(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   return y < x;
 }
 
-template <typename T, typename Alloc>
-inline bool operator<=(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <typename T, typename Alloc, size_t B>
+inline bool operator<=(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   return !(y < x);
 }
 
-template <typename T, typename Alloc>
-inline bool operator>=(const deque<T, Alloc> &x, const deque<T, Alloc> &y) {
+template <typename T, typename Alloc, size_t B>
+inline bool operator>=(const deque<T, Alloc, B> &x, const deque<T, Alloc, B> &y) {
   return !(x < y);
 }
 
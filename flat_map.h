@@ -0,0 +1,398 @@
+#ifndef _FLAT_MAP_H_
+#define _FLAT_MAP_H_
+
+#include "exception.h"
+#include "flat_set.h"
+#include <type_traits>
+
+namespace mmm {
+
+// flat_map的迭代器: 同时指向key数组和value数组的同一下标.
+// 解引用得到pair<const Key&, T&>这样的代理, 不是真正存着的pair
+template <class Key, class T, class TRef, class TPtr> struct flat_map_iterator {
+public:
+  typedef ptrdiff_t difference_type;
+  typedef mmm::random_access_iterator_tag iterator_category;
+  typedef mmm::pair<Key, T> value_type;
+  typedef mmm::pair<const Key &, TRef> reference;
+  typedef flat_map_iterator<Key, T, T &, T *> iterator;
+  typedef flat_map_iterator self;
+  struct pointer {
+    reference ref;
+    const reference *operator->() const { return &ref; }
+  };
+
+  const Key *key_;
+  TPtr value_;
+
+public:
+  flat_map_iterator(const Key *k = nullptr, TPtr v = nullptr)
+      : key_(k), value_(v) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                flat_map_iterator<Key, T, R, P>, iterator>::value>::type>
+  flat_map_iterator(const flat_map_iterator<Key, T, R, P> &other)
+      : key_(other.key_), value_(other.value_) {}
+
+  reference operator*() const { return reference(*key_, *value_); }
+  pointer operator->() const { return pointer{**this}; }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  self &operator++() {
+    ++key_;
+    ++value_;
+    return *this;
+  }
+  self operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  self &operator--() {
+    --key_;
+    --value_;
+    return *this;
+  }
+  self operator--(int) {
+    auto tmp = *this;
+    --*this;
+    return tmp;
+  }
+  self &operator+=(difference_type n) {
+    key_ += n;
+    value_ += n;
+    return *this;
+  }
+  self &operator-=(difference_type n) { return *this += -n; }
+  self operator+(difference_type n) const { return self(*this) += n; }
+  self operator-(difference_type n) const { return self(*this) -= n; }
+  difference_type operator-(const self &right) const {
+    return key_ - right.key_;
+  }
+  bool operator==(const self &right) const { return key_ == right.key_; }
+  bool operator!=(const self &right) const { return key_ != right.key_; }
+  bool operator<(const self &right) const { return key_ < right.key_; }
+  bool operator>(const self &right) const { return key_ > right.key_; }
+  bool operator<=(const self &right) const { return key_ <= right.key_; }
+  bool operator>=(const self &right) const { return key_ >= right.key_; }
+};
+
+// flat_map: key和value分成两个vector存放, 查找只扫key数组, 一条cache line
+// 能装下更多key; value只在命中后访问一次.
+template <class Key, class T, class Compare = mmm::less<Key>> class flat_map {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef mmm::pair<Key, T> value_type;
+  typedef Compare key_compare;
+  typedef mmm::vector<Key> key_container_type;
+  typedef mmm::vector<T> mapped_container_type;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef flat_map_iterator<Key, T, T &, T *> iterator;
+  typedef flat_map_iterator<Key, T, const T &, const T *> const_iterator;
+  typedef typename iterator::reference reference;
+  typedef typename const_iterator::reference const_reference;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+  // extract()交出的两个数组
+  struct containers {
+    key_container_type keys;
+    mapped_container_type values;
+  };
+
+  class value_compare {
+  protected:
+    friend class flat_map;
+    Compare compare;
+    value_compare(Compare c) : compare(c) {}
+
+  public:
+    bool operator()(const_reference x, const_reference y) const {
+      return compare(x.first, y.first);
+    }
+  };
+
+private:
+  key_container_type keys_;
+  mapped_container_type values_;
+  Compare compare_;
+
+public:
+  flat_map() {}
+  explicit flat_map(const Compare &compare) : compare_(compare) {}
+  template <class InputIterator>
+  flat_map(InputIterator first, InputIterator last,
+           const Compare &compare = Compare())
+      : compare_(compare) {
+    insert(first, last);
+  }
+  flat_map(std::initializer_list<value_type> ilist,
+           const Compare &compare = Compare())
+      : flat_map(ilist.begin(), ilist.end(), compare) {}
+  //keys已严格递增且与values一一对应, 直接接管
+  flat_map(sorted_unique_t, key_container_type keys,
+           mapped_container_type values, const Compare &compare = Compare())
+      : keys_(mmm::move(keys)), values_(mmm::move(values)),
+        compare_(compare) {}
+  template <class InputIterator>
+  flat_map(sorted_unique_t, InputIterator first, InputIterator last,
+           const Compare &compare = Compare())
+      : compare_(compare) {
+    for (; first != last; ++first) {
+      keys_.push_back((*first).first);
+      values_.push_back((*first).second);
+    }
+  }
+
+  iterator begin() noexcept { return iterator(keys_.begin(), values_.begin()); }
+  iterator end() noexcept { return iterator(keys_.end(), values_.end()); }
+  const_iterator begin() const noexcept {
+    return const_iterator(keys_.begin(), values_.begin());
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(keys_.end(), values_.end());
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const noexcept { return keys_.empty(); }
+  size_type size() const noexcept { return keys_.size(); }
+  void reserve(size_type n) {
+    keys_.reserve(n);
+    values_.reserve(n);
+  }
+  key_compare key_comp() const { return compare_; }
+  value_compare value_comp() const { return value_compare(compare_); }
+  const key_container_type &keys() const noexcept { return keys_; }
+  const mapped_container_type &values() const noexcept { return values_; }
+
+  T &operator[](const key_type &key) {
+    const size_type i = lower_index(key);
+    if (i == size() || compare_(key, keys_[i]))
+      insert_at(i, key, T());
+    return values_[i];
+  }
+  T &at(const key_type &key) {
+    iterator it = find(key);
+    if (it == end())
+      throw mmm::out_of_range("flat_map::at key does not exist");
+    return *it.value_;
+  }
+  const T &at(const key_type &key) const {
+    const_iterator it = find(key);
+    if (it == end())
+      throw mmm::out_of_range("flat_map::at key does not exist");
+    return *it.value_;
+  }
+
+  mmm::pair<iterator, bool> insert(const value_type &value) {
+    const size_type i = lower_index(value.first);
+    if (i != size() && !compare_(value.first, keys_[i]))
+      return mmm::pair<iterator, bool>(begin() + i, false);
+    insert_at(i, value.first, value.second);
+    return mmm::pair<iterator, bool>(begin() + i, true);
+  }
+  //hint正好是插入位置时不用二分
+  iterator insert(const_iterator position, const value_type &value) {
+    const size_type i = position - begin();
+    if ((i == size() || compare_(value.first, keys_[i])) &&
+        (i == 0 || compare_(keys_[i - 1], value.first))) {
+      insert_at(i, value.first, value.second);
+      return begin() + i;
+    }
+    return insert(value).first;
+  }
+  template <class... Args> mmm::pair<iterator, bool> emplace(Args &&... args) {
+    return insert(value_type(mmm::forward<Args>(args)...));
+  }
+  //追加到末尾, 排序新的一段, 再与原来的部分归并一次
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    const size_type old = size();
+    try {
+      for (; first != last; ++first) {
+        keys_.push_back((*first).first);
+        values_.push_back((*first).second);
+      }
+      merge_tail(old);
+    } catch (...) {
+      //截掉未归并的尾部, 两个数组回到同样长度
+      keys_.erase(keys_.begin() + old, keys_.end());
+      values_.erase(values_.begin() + old, values_.end());
+      throw;
+    }
+  }
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+  template <class InputIterator>
+  void insert(sorted_unique_t, InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  iterator erase(const_iterator position) {
+    return erase(position, position + 1);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    const size_type i = first - begin(), j = last - begin();
+    keys_.erase(keys_.begin() + i, keys_.begin() + j);
+    values_.erase(values_.begin() + i, values_.begin() + j);
+    return begin() + i;
+  }
+  size_type erase(const key_type &key) {
+    iterator it = find(key);
+    if (it == end())
+      return 0;
+    erase(it);
+    return 1;
+  }
+  void clear() {
+    keys_.clear();
+    values_.clear();
+  }
+  void swap(flat_map &x) {
+    keys_.swap(x.keys_);
+    values_.swap(x.values_);
+    mmm::swap(compare_, x.compare_);
+  }
+  //交出底层的两个数组, 自身变空
+  containers extract() {
+    containers c;
+    c.keys.swap(keys_);
+    c.values.swap(values_);
+    return c;
+  }
+  // keys必须已严格递增, 且与values等长
+  void replace(key_container_type &&keys, mapped_container_type &&values) {
+    keys_.swap(keys);
+    values_.swap(values);
+  }
+
+  iterator find(const key_type &key) { return begin() + find_index(key); }
+  const_iterator find(const key_type &key) const {
+    return begin() + find_index(key);
+  }
+  size_type count(const key_type &key) const { return find_index(key) != size(); }
+  bool contains(const key_type &key) const { return find_index(key) != size(); }
+  iterator lower_bound(const key_type &key) { return begin() + lower_index(key); }
+  const_iterator lower_bound(const key_type &key) const {
+    return begin() + lower_index(key);
+  }
+  iterator upper_bound(const key_type &key) { return begin() + upper_index(key); }
+  const_iterator upper_bound(const key_type &key) const {
+    return begin() + upper_index(key);
+  }
+  mmm::pair<iterator, iterator> equal_range(const key_type &key) {
+    const size_type i = find_index(key);
+    return mmm::pair<iterator, iterator>(begin() + i,
+                                         begin() + (i == size() ? i : i + 1));
+  }
+  mmm::pair<const_iterator, const_iterator>
+  equal_range(const key_type &key) const {
+    const size_type i = find_index(key);
+    return mmm::pair<const_iterator, const_iterator>(
+        begin() + i, begin() + (i == size() ? i : i + 1));
+  }
+
+private:
+  size_type lower_index(const key_type &key) const {
+    return Detail::flat_lower_bound(keys_.begin(), size(), key, compare_);
+  }
+  size_type upper_index(const key_type &key) const {
+    return Detail::flat_upper_bound(keys_.begin(), size(), key, compare_);
+  }
+  size_type find_index(const key_type &key) const {
+    const size_type i = lower_index(key);
+    return i != size() && !compare_(key, keys_[i]) ? i : size();
+  }
+  //先插值再插key, 插key失败时撤掉值, 两个数组始终一样长
+  void insert_at(size_type i, const key_type &key, const T &value) {
+    values_.insert(values_.begin() + i, value);
+    try {
+      keys_.insert(keys_.begin() + i, key);
+    } catch (...) {
+      values_.erase(values_.begin() + i);
+      throw;
+    }
+  }
+  void merge_tail(size_type old);
+}; // flat_map
+
+// [0, old)有序, [old, size())是新追加的. 对新的一段排下标(key相同按下标),
+// 再一次归并; 重复的key保留原有的, 新的里面保留先出现的
+template <class Key, class T, class Compare>
+void flat_map<Key, T, Compare>::merge_tail(size_type old) {
+  const size_type n = size();
+  if (old == n)
+    return;
+  const bool sorted = Detail::flat_is_sorted_unique(keys_.begin() + old,
+                                                    keys_.end(), compare_);
+  if (sorted && (old == 0 || compare_(keys_[old - 1], keys_[old])))
+    return;
+  mmm::vector<size_type> idx;
+  idx.reserve(n - old);
+  for (size_type j = old; j != n; ++j)
+    idx.push_back(j);
+  if (!sorted) {
+    const key_container_type &keys = keys_;
+    const Compare &comp = compare_;
+    mmm::quicksort(idx.begin(), idx.end(),
+                   [&keys, &comp](size_type a, size_type b) {
+                     return comp(keys[a], keys[b]) ||
+                            (!comp(keys[b], keys[a]) && a < b);
+                   });
+  }
+  //旧数组随后就丢弃, 元素一律移过去
+  key_container_type merged_keys;
+  mapped_container_type merged_values;
+  merged_keys.reserve(n);
+  merged_values.reserve(n);
+  size_type i = 0;
+  for (size_type j = 0; j != idx.size(); ++j) {
+    Key &k = keys_[idx[j]];
+    for (; i != old && compare_(keys_[i], k); ++i) {
+      merged_keys.push_back(mmm::move(keys_[i]));
+      merged_values.push_back(mmm::move(values_[i]));
+    }
+    if ((i != old && !compare_(k, keys_[i])) ||
+        (!merged_keys.empty() && !compare_(merged_keys.back(), k)))
+      continue;
+    merged_keys.push_back(mmm::move(k));
+    merged_values.push_back(mmm::move(values_[idx[j]]));
+  }
+  for (; i != old; ++i) {
+    merged_keys.push_back(mmm::move(keys_[i]));
+    merged_values.push_back(mmm::move(values_[i]));
+  }
+  keys_.swap(merged_keys);
+  values_.swap(merged_values);
+}
+
+template <class Key, class T, class Compare>
+inline bool operator==(const flat_map<Key, T, Compare> &a,
+                       const flat_map<Key, T, Compare> &b) {
+  return a.keys() == b.keys() && a.values() == b.values();
+}
+template <class Key, class T, class Compare>
+inline bool operator!=(const flat_map<Key, T, Compare> &a,
+                       const flat_map<Key, T, Compare> &b) {
+  return !(a == b);
+}
+template <class Key, class T, class Compare>
+inline void swap(flat_map<Key, T, Compare> &a, flat_map<Key, T, Compare> &b) {
+  a.swap(b);
+}
+
+} // namespace mmm
+
+#endif
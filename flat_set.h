@@ -0,0 +1,264 @@
+#ifndef _FLAT_SET_H_
+#define _FLAT_SET_H_
+
+#include "algorithm.h"
+#include "functional.h"
+#include "pair.h"
+#include "utility.h"
+#include "vector.h"
+#include <initializer_list>
+#include <stddef.h>
+
+namespace mmm {
+
+// flat_set/flat_map: 把元素按key有序地存在mmm::vector里. 查找是在连续内存上二分,
+// 没有节点和指针, 适合建好之后以查找为主的表. 单个插入/删除是O(n)的挪动,
+// 批量插入先排序新元素再与原有序列归并一次.
+namespace Detail {
+// 无分支二分: 每轮只有一个条件选择, 编译成cmov, 不会分支预测失败
+template <class Key, class K, class Compare>
+size_t flat_lower_bound(const Key *first, size_t n, const K &key,
+                        const Compare &comp) {
+  if (n == 0)
+    return 0;
+  const Key *base = first;
+  while (n > 1) {
+    const size_t half = n >> 1;
+    base = comp(base[half], key) ? base + half : base;
+    n -= half;
+  }
+  return (base - first) + comp(*base, key);
+}
+template <class Key, class K, class Compare>
+size_t flat_upper_bound(const Key *first, size_t n, const K &key,
+                        const Compare &comp) {
+  if (n == 0)
+    return 0;
+  const Key *base = first;
+  while (n > 1) {
+    const size_t half = n >> 1;
+    base = comp(key, base[half]) ? base : base + half;
+    n -= half;
+  }
+  return (base - first) + !comp(key, *base);
+}
+//[first, last)是否按comp严格递增
+template <class Iterator, class Compare>
+bool flat_is_sorted_unique(Iterator first, Iterator last, const Compare &comp) {
+  if (first == last)
+    return true;
+  for (Iterator next = first; ++next != last; first = next)
+    if (!comp(*first, *next))
+      return false;
+  return true;
+}
+} // namespace Detail
+
+template <class Key, class Compare = mmm::less<Key>> class flat_set {
+public:
+  typedef Key key_type;
+  typedef Key value_type;
+  typedef Compare key_compare;
+  typedef Compare value_compare;
+  typedef mmm::vector<Key> container_type;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef const Key &reference;
+  typedef const Key &const_reference;
+  typedef typename container_type::const_iterator iterator;
+  typedef typename container_type::const_iterator const_iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+  container_type keys_;
+  Compare compare_;
+
+public:
+  flat_set() {}
+  explicit flat_set(const Compare &compare) : compare_(compare) {}
+  template <class InputIterator>
+  flat_set(InputIterator first, InputIterator last,
+           const Compare &compare = Compare())
+      : compare_(compare) {
+    insert(first, last);
+  }
+  flat_set(std::initializer_list<value_type> ilist,
+           const Compare &compare = Compare())
+      : flat_set(ilist.begin(), ilist.end(), compare) {}
+  //输入已按key严格递增, 直接接管
+  flat_set(sorted_unique_t, container_type keys,
+           const Compare &compare = Compare())
+      : keys_(mmm::move(keys)), compare_(compare) {}
+  template <class InputIterator>
+  flat_set(sorted_unique_t, InputIterator first, InputIterator last,
+           const Compare &compare = Compare())
+      : compare_(compare) {
+    for (; first != last; ++first)
+      keys_.push_back(*first);
+  }
+
+  iterator begin() const noexcept { return keys_.begin(); }
+  iterator end() const noexcept { return keys_.end(); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+  bool empty() const noexcept { return keys_.empty(); }
+  size_type size() const noexcept { return keys_.size(); }
+  size_type capacity() const noexcept { return keys_.capacity(); }
+  void reserve(size_type n) { keys_.reserve(n); }
+  void shrink_to_fit() { keys_.shrink_to_fit(); }
+  key_compare key_comp() const { return compare_; }
+  value_compare value_comp() const { return compare_; }
+
+  mmm::pair<iterator, bool> insert(const value_type &value) {
+    const size_type i = lower_index(value);
+    if (i != size() && !compare_(value, keys_[i]))
+      return mmm::pair<iterator, bool>(begin() + i, false);
+    keys_.insert(keys_.begin() + i, value);
+    return mmm::pair<iterator, bool>(begin() + i, true);
+  }
+  //hint正好是插入位置时不用二分
+  iterator insert(const_iterator position, const value_type &value) {
+    const size_type i = position - begin();
+    if ((i == size() || compare_(value, keys_[i])) &&
+        (i == 0 || compare_(keys_[i - 1], value))) {
+      keys_.insert(keys_.begin() + i, value);
+      return begin() + i;
+    }
+    return insert(value).first;
+  }
+  template <class... Args> mmm::pair<iterator, bool> emplace(Args &&... args) {
+    return insert(value_type(mmm::forward<Args>(args)...));
+  }
+  //追加到末尾, 排序新的一段, 再与原来的部分归并一次
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    const size_type old = size();
+    try {
+      for (; first != last; ++first)
+        keys_.push_back(*first);
+      merge_tail(old);
+    } catch (...) {
+      //截掉未归并的尾部, 保持有序
+      keys_.erase(keys_.begin() + old, keys_.end());
+      throw;
+    }
+  }
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+  //[first, last)已按key严格递增, 省去排序
+  template <class InputIterator>
+  void insert(sorted_unique_t, InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  iterator erase(const_iterator position) {
+    const size_type i = position - begin();
+    keys_.erase(keys_.begin() + i);
+    return begin() + i;
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    const size_type i = first - begin();
+    keys_.erase(keys_.begin() + i, keys_.begin() + (last - begin()));
+    return begin() + i;
+  }
+  size_type erase(const key_type &key) {
+    mmm::pair<iterator, iterator> range = equal_range(key);
+    erase(range.first, range.second);
+    return range.second - range.first;
+  }
+  void clear() { keys_.clear(); }
+  void swap(flat_set &x) {
+    keys_.swap(x.keys_);
+    mmm::swap(compare_, x.compare_);
+  }
+  //交出底层的有序数组, 自身变空
+  container_type extract() {
+    container_type keys;
+    keys.swap(keys_);
+    return keys;
+  }
+  // keys必须已按key严格递增
+  void replace(container_type &&keys) { keys_.swap(keys); }
+
+  iterator find(const key_type &key) const {
+    const size_type i = lower_index(key);
+    return i != size() && !compare_(key, keys_[i]) ? begin() + i : end();
+  }
+  size_type count(const key_type &key) const { return find(key) != end(); }
+  bool contains(const key_type &key) const { return find(key) != end(); }
+  iterator lower_bound(const key_type &key) const {
+    return begin() + lower_index(key);
+  }
+  iterator upper_bound(const key_type &key) const {
+    return begin() +
+           Detail::flat_upper_bound(keys_.begin(), size(), key, compare_);
+  }
+  mmm::pair<iterator, iterator> equal_range(const key_type &key) const {
+    iterator it = find(key);
+    return mmm::pair<iterator, iterator>(it, it == end() ? it : it + 1);
+  }
+
+private:
+  size_type lower_index(const key_type &key) const {
+    return Detail::flat_lower_bound(keys_.begin(), size(), key, compare_);
+  }
+  void merge_tail(size_type old);
+}; // flat_set
+
+// [0, old)有序, [old, size())是新追加的; 重复的key保留原有的那个
+template <class Key, class Compare>
+void flat_set<Key, Compare>::merge_tail(size_type old) {
+  const size_type n = size();
+  if (old == n)
+    return;
+  typename container_type::iterator tail = keys_.begin() + old;
+  const bool sorted = Detail::flat_is_sorted_unique(tail, keys_.end(), compare_);
+  //新的一段整体在后面且严格递增: 已经在位
+  if (sorted && (old == 0 || compare_(keys_[old - 1], *tail)))
+    return;
+  if (!sorted)
+    mmm::quicksort(tail, keys_.end(), compare_);
+  container_type merged;
+  merged.reserve(n);
+  size_type i = 0;
+  for (size_type j = old; j != n; ++j) {
+    while (i != old && compare_(keys_[i], keys_[j]))
+      merged.push_back(mmm::move(keys_[i++]));
+    if ((i != old && !compare_(keys_[j], keys_[i])) ||
+        (!merged.empty() && !compare_(merged.back(), keys_[j])))
+      continue;
+    merged.push_back(mmm::move(keys_[j]));
+  }
+  for (; i != old; ++i)
+    merged.push_back(mmm::move(keys_[i]));
+  keys_.swap(merged);
+}
+
+template <class Key, class Compare>
+inline bool operator==(const flat_set<Key, Compare> &a,
+                       const flat_set<Key, Compare> &b) {
+  return a.size() == b.size() && mmm::equal(a.begin(), a.end(), b.begin());
+}
+template <class Key, class Compare>
+inline bool operator!=(const flat_set<Key, Compare> &a,
+                       const flat_set<Key, Compare> &b) {
+  return !(a == b);
+}
+template <class Key, class Compare>
+inline bool operator<(const flat_set<Key, Compare> &a,
+                      const flat_set<Key, Compare> &b) {
+  return mmm::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+template <class Key, class Compare>
+inline void swap(flat_set<Key, Compare> &a, flat_set<Key, Compare> &b) {
+  a.swap(b);
+}
+
+} // namespace mmm
+
+#endif
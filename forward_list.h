@@ -0,0 +1,384 @@
+#ifndef _FORWARD_LIST_H_
+#define _FORWARD_LIST_H_
+
+#include "algorithm.h"
+#include "allocator.h"
+#include "construct.h"
+#include "functional.h"
+#include "iterator.h"
+#include "type_traits.h"
+#include "utility.h"
+#include <new>
+#include <type_traits>
+
+namespace mmm {
+
+// forward_list: 单向链表. 每个结点只有一个next指针, 比list_node少8字节,
+// 链接/摘除也只改一个指针. 哨兵只是一个不带元素的结点头(before_begin),
+// end()为nullptr. 所有修改都以"某个位置之后"为参照: insert_after/erase_after/
+// splice_after. 与std::forward_list一致, 不提供size().
+namespace Detail {
+struct slist_node_base {
+  slist_node_base *next;
+};
+template <class T> struct slist_node : public slist_node_base {
+  T data;
+};
+} // namespace Detail
+
+template <class T, class Ref, class Ptr> struct slist_iterator {
+public:
+  typedef ptrdiff_t difference_type;
+  typedef mmm::forward_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef Detail::slist_node_base *base_ptr;
+  typedef Detail::slist_node<T> *node_ptr;
+  typedef slist_iterator<T, T &, T *> iterator;
+  typedef slist_iterator self;
+
+  base_ptr p;
+
+public:
+  slist_iterator(base_ptr ptr = nullptr) : p(ptr) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                slist_iterator<T, R, P>, iterator>::value>::type>
+  slist_iterator(const slist_iterator<T, R, P> &other) : p(other.p) {}
+
+  self &operator++() {
+    p = p->next;
+    return *this;
+  }
+  self operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  reference operator*() const { return static_cast<node_ptr>(p)->data; }
+  pointer operator->() const { return &(operator*()); }
+  bool operator==(const self &right) const { return p == right.p; }
+  bool operator!=(const self &right) const { return p != right.p; }
+};
+
+template <class T, class Allocator = allocator<Detail::slist_node<T>>>
+class forward_list {
+public:
+  typedef Allocator allocator_type;
+  typedef T value_type;
+  typedef slist_iterator<T, T &, T *> iterator;
+  typedef slist_iterator<T, const T &, const T *> const_iterator;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+private:
+  typedef Detail::slist_node_base *base_ptr;
+  typedef Detail::slist_node<T> *node_ptr;
+
+  Detail::slist_node_base head_; // before_begin
+
+public:
+  forward_list() { head_.next = nullptr; }
+  explicit forward_list(size_type n, const value_type &val = value_type())
+      : forward_list() {
+    insert_after(before_begin(), n, val);
+  }
+  template <class InputIterator>
+  forward_list(InputIterator first, InputIterator last) : forward_list() {
+    insert_after(before_begin(), first, last);
+  }
+  forward_list(const forward_list &other) : forward_list() {
+    insert_after(before_begin(), other.begin(), other.end());
+  }
+  forward_list(forward_list &&other) noexcept : forward_list() { swap(other); }
+  forward_list &operator=(forward_list other) {
+    swap(other);
+    return *this;
+  }
+  ~forward_list() { clear(); }
+
+  iterator before_begin() noexcept { return &head_; }
+  const_iterator before_begin() const noexcept {
+    return const_cast<base_ptr>(&head_);
+  }
+  const_iterator cbefore_begin() const noexcept { return before_begin(); }
+  iterator begin() noexcept { return head_.next; }
+  const_iterator begin() const noexcept { return head_.next; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  iterator end() noexcept { return nullptr; }
+  const_iterator end() const noexcept { return nullptr; }
+  const_iterator cend() const noexcept { return end(); }
+
+  bool empty() const noexcept { return head_.next == nullptr; }
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+
+  void push_front(const value_type &val) { emplace_front(val); }
+  void push_front(value_type &&val) { emplace_front(mmm::move(val)); }
+  template <class... Args> reference emplace_front(Args &&... args) {
+    return *emplace_after(before_begin(), mmm::forward<Args>(args)...);
+  }
+  void pop_front() { erase_after(before_begin()); }
+
+  //返回新插入的(最后一个)元素
+  template <class... Args>
+  iterator emplace_after(const_iterator position, Args &&... args) {
+    base_ptr n = create_node(mmm::forward<Args>(args)...);
+    n->next = position.p->next;
+    position.p->next = n;
+    return n;
+  }
+  iterator insert_after(const_iterator position, const value_type &val) {
+    return emplace_after(position, val);
+  }
+  iterator insert_after(const_iterator position, value_type &&val) {
+    return emplace_after(position, mmm::move(val));
+  }
+  iterator insert_after(const_iterator position, size_type n,
+                        const value_type &val) {
+    return insert_after_aux(position, n, val, true_type());
+  }
+  template <class InputIterator>
+  iterator insert_after(const_iterator position, InputIterator first,
+                        InputIterator last) {
+    return insert_after_aux(position, first, last,
+                            is_integer<InputIterator>());
+  }
+  //返回被删除元素之后的位置
+  iterator erase_after(const_iterator position) {
+    base_ptr n = position.p->next;
+    position.p->next = n->next;
+    delete_node(n);
+    return position.p->next;
+  }
+  //删除(position, last)
+  iterator erase_after(const_iterator position, const_iterator last) {
+    base_ptr n = position.p->next;
+    while (n != last.p) {
+      base_ptr next = n->next;
+      delete_node(n);
+      n = next;
+    }
+    position.p->next = last.p;
+    return last.p;
+  }
+  void clear() { erase_after(before_begin(), end()); }
+  void swap(forward_list &x) noexcept { mmm::swap(head_.next, x.head_.next); }
+
+  //把x的全部/i之后的一个/(first, last)之间的元素移到position之后
+  void splice_after(const_iterator position, forward_list &x) {
+    if (!x.empty())
+      transfer_after(position.p, &x.head_, last_node(&x.head_));
+  }
+  void splice_after(const_iterator position, forward_list &,
+                    const_iterator i) {
+    base_ptr n = i.p->next;
+    if (position.p == i.p || position.p == n)
+      return;
+    transfer_after(position.p, i.p, n);
+  }
+  void splice_after(const_iterator position, forward_list &,
+                    const_iterator first, const_iterator last) {
+    if (first.p->next == last.p)
+      return;
+    base_ptr before_last = first.p;
+    while (before_last->next != last.p)
+      before_last = before_last->next;
+    transfer_after(position.p, first.p, before_last);
+  }
+
+  void remove(const value_type &val) {
+    remove_if([&val](const value_type &x) { return x == val; });
+  }
+  template <class UnaryPredicate> void remove_if(UnaryPredicate pred);
+  void unique() { unique(mmm::equal_to<T>()); }
+  template <class BinaryPredicate> void unique(BinaryPredicate binary_pred);
+  void merge(forward_list &x) { merge(x, mmm::less<T>()); }
+  template <class Compare> void merge(forward_list &x, Compare comp);
+  void sort() { sort(mmm::less<T>()); }
+  template <class Compare> void sort(Compare comp);
+  void reverse() noexcept;
+
+private:
+  template <class... Args> base_ptr create_node(Args &&... args) {
+    node_ptr n = allocator_type::allocate();
+    new (&n->data) T(mmm::forward<Args>(args)...);
+    n->next = nullptr;
+    return n;
+  }
+  void delete_node(base_ptr n) {
+    mmm::destroy(&static_cast<node_ptr>(n)->data);
+    allocator_type::deallocate(static_cast<node_ptr>(n));
+  }
+  static base_ptr last_node(base_ptr n) {
+    while (n->next)
+      n = n->next;
+    return n;
+  }
+  //把(before_first, last]移到position之后
+  static void transfer_after(base_ptr position, base_ptr before_first,
+                             base_ptr last) {
+    base_ptr first = before_first->next;
+    before_first->next = last->next;
+    last->next = position->next;
+    position->next = first;
+  }
+  iterator insert_after_aux(const_iterator position, size_type n,
+                            const value_type &val, true_type) {
+    base_ptr cur = position.p;
+    for (; n != 0; --n)
+      cur = emplace_after(cur, val).p;
+    return cur;
+  }
+  template <class InputIterator>
+  iterator insert_after_aux(const_iterator position, InputIterator first,
+                            InputIterator last, false_type) {
+    base_ptr cur = position.p;
+    for (; first != last; ++first)
+      cur = emplace_after(cur, *first).p;
+    return cur;
+  }
+  template <class Compare>
+  static base_ptr merge_runs(base_ptr a, base_ptr b, Compare &comp);
+}; // end of forward_list
+
+template <class T, class Allocator>
+template <class UnaryPredicate>
+void forward_list<T, Allocator>::remove_if(UnaryPredicate pred) {
+  base_ptr prev = &head_;
+  while (prev->next) {
+    if (pred(static_cast<node_ptr>(prev->next)->data))
+      erase_after(prev);
+    else
+      prev = prev->next;
+  }
+}
+
+template <class T, class Allocator>
+template <class BinaryPredicate>
+void forward_list<T, Allocator>::unique(BinaryPredicate binary_pred) {
+  base_ptr cur = head_.next;
+  if (!cur)
+    return;
+  while (cur->next) {
+    if (binary_pred(static_cast<node_ptr>(cur)->data,
+                    static_cast<node_ptr>(cur->next)->data))
+      erase_after(cur);
+    else
+      cur = cur->next;
+  }
+}
+
+// merge: 两个有序链表合并, 只改next指针. 相等时*this的元素在前(稳定)
+template <class T, class Allocator>
+template <class Compare>
+void forward_list<T, Allocator>::merge(forward_list &x, Compare comp) {
+  if (this == &x)
+    return;
+  head_.next = merge_runs(head_.next, x.head_.next, comp);
+  x.head_.next = nullptr;
+}
+
+//合并两段以nullptr结尾的链, 相等时a在前
+template <class T, class Allocator>
+template <class Compare>
+typename forward_list<T, Allocator>::base_ptr
+forward_list<T, Allocator>::merge_runs(base_ptr a, base_ptr b, Compare &comp) {
+  base_ptr first = nullptr;
+  base_ptr *tail = &first;
+  while (a && b) {
+    if (comp(static_cast<node_ptr>(b)->data, static_cast<node_ptr>(a)->data)) {
+      *tail = b;
+      tail = &b->next;
+      b = b->next;
+    } else {
+      *tail = a;
+      tail = &a->next;
+      a = a->next;
+    }
+  }
+  *tail = a ? a : b;
+  return first;
+}
+
+// sort: 与list::sort相同的自底向上归并. 稳定, 不分配内存;
+// 单向链表本来就以nullptr结尾, 合并完直接挂回head_即可
+template <class T, class Allocator>
+template <class Compare>
+void forward_list<T, Allocator>::sort(Compare comp) {
+  if (!head_.next || !head_.next->next)
+    return;
+  base_ptr bucket[64];
+  int fill = 0;
+  base_ptr p = head_.next;
+  while (p) {
+    base_ptr carry = p;
+    p = p->next;
+    carry->next = nullptr;
+    int i = 0;
+    for (; i < fill && bucket[i]; ++i) {
+      carry = merge_runs(bucket[i], carry, comp);
+      bucket[i] = nullptr;
+    }
+    bucket[i] = carry;
+    if (i == fill)
+      ++fill;
+  }
+  base_ptr result = nullptr;
+  for (int i = 0; i < fill; ++i) {
+    if (bucket[i])
+      result = result ? merge_runs(bucket[i], result, comp) : bucket[i];
+  }
+  head_.next = result;
+}
+
+template <class T, class Allocator>
+void forward_list<T, Allocator>::reverse() noexcept {
+  base_ptr prev = nullptr, cur = head_.next;
+  while (cur) {
+    base_ptr next = cur->next;
+    cur->next = prev;
+    prev = cur;
+    cur = next;
+  }
+  head_.next = prev;
+}
+
+template <class T, class Allocator>
+inline void swap(forward_list<T, Allocator> &x,
+                 forward_list<T, Allocator> &y) noexcept {
+  x.swap(y);
+}
+
+template <class T, class Allocator>
+bool operator==(const forward_list<T, Allocator> &lhs,
+                const forward_list<T, Allocator> &rhs) {
+  auto first1 = lhs.begin(), first2 = rhs.begin();
+  auto last1 = lhs.end(), last2 = rhs.end();
+  for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+    if (!(*first1 == *first2))
+      return false;
+  }
+  return first1 == last1 && first2 == last2;
+}
+template <class T, class Allocator>
+bool operator!=(const forward_list<T, Allocator> &lhs,
+                const forward_list<T, Allocator> &rhs) {
+  return !(lhs == rhs);
+}
+template <class T, class Allocator>
+bool operator<(const forward_list<T, Allocator> &lhs,
+               const forward_list<T, Allocator> &rhs) {
+  return mmm::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end());
+}
+
+} // namespace mmm
+
+#endif
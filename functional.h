@@ -30,14 +30,30 @@ namespace mmm{
 
 
 	/*************less greater equal*****************/
-	template <class T>
+	template <class T = void>
 	struct less : public binary_function<T, T, bool> {
 		bool operator()(const T& x, const T& y) const { return x < y;}
 	};
 
-	template <class T>
+	template <class T = void>
 	struct greater : public binary_function<T, T, bool> {
-		bool operator()(const T& x, const T& y) const { return !(x < y);}
+		bool operator()(const T& x, const T& y) const { return y < x;}
+	};
+
+	//less<>/greater<>: 两边类型可以不同, 带is_transparent标记,
+	//关联容器见到它就允许用任何能和key比较的类型查找(如map<string, T, less<>>用const char*)
+	template <>
+	struct less<void> {
+		typedef int is_transparent;
+		template <class T, class U>
+		bool operator()(const T& x, const U& y) const { return x < y;}
+	};
+
+	template <>
+	struct greater<void> {
+		typedef int is_transparent;
+		template <class T, class U>
+		bool operator()(const T& x, const U& y) const { return y < x;}
 	};
 
 	template<class T>
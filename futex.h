@@ -0,0 +1,41 @@
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace mmm {
+namespace Detail {
+
+//在一个32位原子变量上睡眠/唤醒. Linux上是futex, 其它平台退化为让出时间片.
+//futex_wait: 若*addr仍等于expected则睡眠, 直到被唤醒、超时或虚假唤醒;
+//调用方总是需要在循环中重新检查条件.
+inline void futex_wait(std::atomic<uint32_t> *addr, uint32_t expected,
+                       const struct timespec *timeout = nullptr) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE,
+          expected, timeout, nullptr, 0);
+#else
+  if (addr->load(std::memory_order_relaxed) == expected)
+    std::this_thread::yield();
+#endif
+}
+
+inline void futex_wake(std::atomic<uint32_t> *addr, int n) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE, n,
+          nullptr, nullptr, 0);
+#endif
+}
+
+} // namespace Detail
+} // namespace mmm
+
+#endif
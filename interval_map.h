@@ -0,0 +1,285 @@
+#ifndef _INTERVAL_MAP_H_
+#define _INTERVAL_MAP_H_
+
+#include "allocator.h"
+#include "functional.h"
+#include "pair.h"
+#include "rbtree.h"
+#include <type_traits>
+
+namespace mmm {
+
+//闭区间[low, high], 要求!(high < low)
+template <typename Key> struct interval {
+  Key low;
+  Key high;
+
+  interval() : low(), high() {}
+  interval(const Key &lo, const Key &hi) : low(lo), high(hi) {}
+};
+
+template <typename Key>
+inline bool operator==(const interval<Key> &a, const interval<Key> &b) {
+  return a.low == b.low && a.high == b.high;
+}
+template <typename Key>
+inline bool operator!=(const interval<Key> &a, const interval<Key> &b) {
+  return !(a == b);
+}
+template <typename Key>
+inline bool operator<(const interval<Key> &a, const interval<Key> &b) {
+  return a.low < b.low || (!(b.low < a.low) && a.high < b.high);
+}
+
+//按(low, high)字典序比较, 作为interval_map在rbtree上的key比较
+template <typename Key, typename Compare> struct interval_less {
+  Compare compare;
+
+  interval_less() : compare() {}
+  interval_less(const Compare &c) : compare(c) {}
+
+  bool operator()(const interval<Key> &a, const interval<Key> &b) const {
+    return compare(a.low, b.low) ||
+           (!compare(b.low, a.low) && compare(a.high, b.high));
+  }
+};
+
+struct rbtree_interval_node_base : public rbtree_node_base {
+  rbtree_node_base *mpNodeMaxHigh; //子树中high最大的结点
+};
+
+//区间树增强: 每个结点记下子树里high最大的结点. 存指针而不是Key本身,
+//结点基类保持平凡, 更新时也不用拷贝Key.
+//更新函数是无状态的静态函数, 所以Compare须可默认构造且无状态.
+template <typename Compare> struct rbtree_interval_augment {
+  static_assert(std::is_empty<Compare>::value,
+                "interval_map requires a stateless Compare");
+  typedef rbtree_interval_node_base node_base_type;
+  typedef false_type has_subtree_size;
+
+  template <typename Node> static void update(rbtree_node_base *pNode) {
+    Compare compare;
+    rbtree_node_base *pNodeMax = pNode;
+
+    if (pNode->mpNodeLeft) {
+      rbtree_node_base *pNodeLeftMax =
+          static_cast<rbtree_interval_node_base *>(pNode->mpNodeLeft)
+              ->mpNodeMaxHigh;
+      if (compare(high<Node>(pNodeMax), high<Node>(pNodeLeftMax)))
+        pNodeMax = pNodeLeftMax;
+    }
+    if (pNode->mpNodeRight) {
+      rbtree_node_base *pNodeRightMax =
+          static_cast<rbtree_interval_node_base *>(pNode->mpNodeRight)
+              ->mpNodeMaxHigh;
+      if (compare(high<Node>(pNodeMax), high<Node>(pNodeRightMax)))
+        pNodeMax = pNodeRightMax;
+    }
+    static_cast<rbtree_interval_node_base *>(pNode)->mpNodeMaxHigh = pNodeMax;
+  }
+  template <typename Node> static RBTreeAugmentFunc get_update() {
+    return &update<Node>;
+  }
+
+private:
+  template <typename Node>
+  static const auto &high(const rbtree_node_base *pNode) {
+    return static_cast<const Node *>(pNode)->mValue.first.high;
+  }
+};
+
+// interval_map: 以区间为key的multimap, 同一区间可出现多次.
+//按low排序, 结点上维护子树最大的high, 重叠/穿刺查询只走可能相交的子树:
+//找任意一个相交区间O(log n), 列出全部k个相交区间O(log n + k)量级.
+template <typename Key, typename T, typename Compare = mmm::less<Key>,
+          typename Allocator = mmm::allocator<rbtree_node<
+              mmm::pair<const interval<Key>, T>, rbtree_interval_node_base>>>
+class interval_map
+    : public rbtree<interval<Key>, mmm::pair<const interval<Key>, T>,
+                    interval_less<Key, Compare>, Allocator,
+                    mmm::select1st<mmm::pair<const interval<Key>, T>>, true,
+                    false, rbtree_interval_augment<Compare>> {
+public:
+  typedef rbtree<interval<Key>, mmm::pair<const interval<Key>, T>,
+                 interval_less<Key, Compare>, Allocator,
+                 mmm::select1st<mmm::pair<const interval<Key>, T>>, true, false,
+                 rbtree_interval_augment<Compare>>
+      base_type;
+  typedef interval_map<Key, T, Compare, Allocator> this_type;
+  typedef typename base_type::size_type size_type;
+  typedef typename base_type::key_type key_type;
+  typedef interval<Key> interval_type;
+  typedef Key endpoint_type;
+  typedef T mapped_type;
+  typedef typename base_type::value_type value_type;
+  typedef typename base_type::node_type node_type;
+  typedef typename base_type::iterator iterator;
+  typedef typename base_type::const_iterator const_iterator;
+  typedef typename base_type::allocator_type allocator_type;
+  typedef typename base_type::key_compare key_compare;
+  // Other types are inherited from the base class.
+
+  using base_type::begin;
+  using base_type::end;
+  using base_type::erase;
+  using base_type::insert;
+  using base_type::lower_bound;
+  using base_type::mAnchor;
+  using base_type::mCompare;
+  using base_type::upper_bound;
+
+public:
+  //不接受Compare实例: 维护最大high时用的是默认构造的Compare, 见rbtree_interval_augment
+  interval_map(const allocator_type &allocator = allocator_type())
+      : base_type(allocator) {}
+  interval_map(const this_type &x) : base_type(x) {}
+  interval_map(this_type &&x) : base_type(mmm::move(x)) {}
+  interval_map(std::initializer_list<value_type> ilist,
+               const allocator_type &allocator = allocator_type())
+      : base_type(ilist.begin(), ilist.end(), key_compare(), allocator) {}
+  template <typename Iterator>
+  interval_map(Iterator itBegin, Iterator itEnd)
+      : base_type(itBegin, itEnd, key_compare(), allocator_type()) {}
+
+  this_type &operator=(const this_type &x) {
+    return (this_type &)base_type::operator=(x);
+  }
+  this_type &operator=(std::initializer_list<value_type> ilist) {
+    return (this_type &)base_type::operator=(ilist);
+  }
+  this_type &operator=(this_type &&x) {
+    return (this_type &)base_type::operator=(mmm::move(x));
+  }
+
+public:
+  iterator insert(const Key &low, const Key &high, const T &value) {
+    return base_type::insert(value_type(interval_type(low, high), value));
+  }
+
+  //删除所有等于key的区间
+  size_type erase(const interval_type &key) {
+    iterator first(lower_bound(key)), last(upper_bound(key));
+    const size_type n = (size_type)mmm::distance(first, last);
+    base_type::erase(first, last);
+    return n;
+  }
+
+  //任意一个与[low, high]相交的区间, 没有则返回end(). O(log n)
+  iterator find_overlap(const Key &low, const Key &high);
+  const_iterator find_overlap(const Key &low, const Key &high) const {
+    return const_iterator(
+        const_cast<this_type *>(this)->find_overlap(low, high));
+  }
+
+  //按low升序对每个与[low, high]相交的区间调用f(value_type&)
+  template <typename Function>
+  void for_each_overlap(const Key &low, const Key &high, Function f) {
+    DoForEachOverlap(mAnchor.mpNodeParent, low, high, f);
+  }
+  template <typename Function>
+  void for_each_overlap(const Key &low, const Key &high, Function f) const {
+    auto g = [&f](const value_type &value) { f(value); };
+    const_cast<this_type *>(this)->DoForEachOverlap(mAnchor.mpNodeParent, low,
+                                                    high, g);
+  }
+
+  //包含point的区间(穿刺查询)
+  template <typename Function>
+  void for_each_stab(const Key &point, Function f) {
+    for_each_overlap(point, point, f);
+  }
+  template <typename Function>
+  void for_each_stab(const Key &point, Function f) const {
+    for_each_overlap(point, point, f);
+  }
+
+  size_type count_overlaps(const Key &low, const Key &high) const {
+    size_type n = 0;
+    for_each_overlap(low, high, [&n](const value_type &) { ++n; });
+    return n;
+  }
+
+  //红黑性质之外, 再检查每个结点记录的最大high
+  bool validate() const {
+    return base_type::validate() && DoValidateMaxHigh(mAnchor.mpNodeParent);
+  }
+
+private:
+  const Key &DoHigh(const rbtree_node_base *pNode) const {
+    return static_cast<const node_type *>(pNode)->mValue.first.high;
+  }
+  const Key &DoMaxHigh(const rbtree_node_base *pNode) const {
+    return DoHigh(
+        static_cast<const rbtree_interval_node_base *>(pNode)->mpNodeMaxHigh);
+  }
+
+  template <typename Function>
+  void DoForEachOverlap(rbtree_node_base *pNode, const Key &low,
+                        const Key &high, Function &f);
+  bool DoValidateMaxHigh(const rbtree_node_base *pNode) const;
+}; // interval_map
+
+template <typename Key, typename T, typename Compare, typename Allocator>
+typename interval_map<Key, T, Compare, Allocator>::iterator
+interval_map<Key, T, Compare, Allocator>::find_overlap(const Key &low,
+                                                       const Key &high) {
+  const Compare &compare = mCompare.compare;
+  rbtree_node_base *pNode = mAnchor.mpNodeParent;
+
+  while (pNode) {
+    const interval_type &value = static_cast<node_type *>(pNode)->mValue.first;
+
+    if (!compare(high, value.low) && !compare(value.high, low))
+      return iterator(static_cast<node_type *>(pNode));
+
+    //左子树里有high够大的区间就只需看左边: 左边都不相交时,
+    //右边的low更大, 同样越过了high
+    if (pNode->mpNodeLeft && !compare(DoMaxHigh(pNode->mpNodeLeft), low))
+      pNode = pNode->mpNodeLeft;
+    else
+      pNode = pNode->mpNodeRight;
+  }
+  return end();
+}
+
+//中序遍历, 剪掉两类子树: 最大high在low左边的, 以及low已越过high之后的
+template <typename Key, typename T, typename Compare, typename Allocator>
+template <typename Function>
+void interval_map<Key, T, Compare, Allocator>::DoForEachOverlap(
+    rbtree_node_base *pNode, const Key &low, const Key &high, Function &f) {
+  const Compare &compare = mCompare.compare;
+
+  while (pNode && !compare(DoMaxHigh(pNode), low)) {
+    DoForEachOverlap(pNode->mpNodeLeft, low, high, f);
+
+    value_type &value = static_cast<node_type *>(pNode)->mValue;
+    if (compare(high, value.first.low))
+      return;
+    if (!compare(value.first.high, low))
+      f(value);
+    pNode = pNode->mpNodeRight;
+  }
+}
+
+template <typename Key, typename T, typename Compare, typename Allocator>
+bool interval_map<Key, T, Compare, Allocator>::DoValidateMaxHigh(
+    const rbtree_node_base *pNode) const {
+  if (!pNode)
+    return true;
+
+  const Compare &compare = mCompare.compare;
+  const Key &maxHigh = DoMaxHigh(pNode);
+
+  if (compare(maxHigh, DoHigh(pNode)))
+    return false;
+  if (pNode->mpNodeLeft && compare(maxHigh, DoMaxHigh(pNode->mpNodeLeft)))
+    return false;
+  if (pNode->mpNodeRight && compare(maxHigh, DoMaxHigh(pNode->mpNodeRight)))
+    return false;
+  return DoValidateMaxHigh(pNode->mpNodeLeft) &&
+         DoValidateMaxHigh(pNode->mpNodeRight);
+}
+
+} // namespace mmm
+
+#endif
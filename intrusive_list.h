@@ -0,0 +1,359 @@
+#ifndef _INTRUSIVE_LIST_H_
+#define _INTRUSIVE_LIST_H_
+
+#include "functional.h"
+#include "iterator.h"
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+// 侵入式双向链表: 链接指针(list_hook)嵌在元素里, 链表不分配也不拷贝元素,
+// 插入/删除只是改指针. 一个对象可以有多个hook, 同时挂在多条链表上:
+//   struct conn { list_hook lru; list_hook by_peer; ... };
+//   intrusive_list<conn, &conn::lru> lru_list;
+// 元素的生命周期由使用者管理. 给出对象本身即可O(1)摘除(iterator_to/unlink).
+// auto_unlink_list_hook析构时自动从所在链表摘除; 正因为元素可能不经过链表就离开,
+// size()是O(n)的.
+
+struct list_hook {
+  list_hook *prev_;
+  list_hook *next_;
+
+  list_hook() : prev_(nullptr), next_(nullptr) {}
+  //复制对象不复制其所在的链表
+  list_hook(const list_hook &) : prev_(nullptr), next_(nullptr) {}
+  list_hook &operator=(const list_hook &) { return *this; }
+
+  bool is_linked() const { return next_ != nullptr; }
+  void unlink() {
+    prev_->next_ = next_;
+    next_->prev_ = prev_;
+    prev_ = next_ = nullptr;
+  }
+};
+
+struct auto_unlink_list_hook : public list_hook {
+  ~auto_unlink_list_hook() {
+    if (is_linked())
+      unlink();
+  }
+};
+
+namespace Detail {
+// hook与所在对象之间的换算
+template <class T, auto Hook> struct hook_traits {
+  static size_t offset() {
+    alignas(T) static char buf[sizeof(T)];
+    T *obj = reinterpret_cast<T *>(buf);
+    return reinterpret_cast<char *>(&(obj->*Hook)) - buf;
+  }
+  static list_hook *to_hook(T &obj) { return &(obj.*Hook); }
+  static T *to_value(list_hook *h) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(h) - offset());
+  }
+};
+} // namespace Detail
+
+template <class T, auto Hook, class Ref, class Ptr> struct intrusive_list_iterator {
+public:
+  typedef ptrdiff_t difference_type;
+  typedef mmm::bidirectional_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef intrusive_list_iterator<T, Hook, T &, T *> iterator;
+  typedef intrusive_list_iterator self;
+  typedef Detail::hook_traits<T, Hook> traits;
+
+  list_hook *p;
+
+public:
+  intrusive_list_iterator(list_hook *h = nullptr) : p(h) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                intrusive_list_iterator<T, Hook, R, P>, iterator>::value>::type>
+  intrusive_list_iterator(const intrusive_list_iterator<T, Hook, R, P> &other)
+      : p(other.p) {}
+
+  self &operator++() {
+    p = p->next_;
+    return *this;
+  }
+  self operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  self &operator--() {
+    p = p->prev_;
+    return *this;
+  }
+  self operator--(int) {
+    auto tmp = *this;
+    --*this;
+    return tmp;
+  }
+  reference operator*() const { return *traits::to_value(p); }
+  pointer operator->() const { return traits::to_value(p); }
+  bool operator==(const self &right) const { return p == right.p; }
+  bool operator!=(const self &right) const { return p != right.p; }
+};
+
+template <class T, auto Hook> class intrusive_list {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef intrusive_list_iterator<T, Hook, T &, T *> iterator;
+  typedef intrusive_list_iterator<T, Hook, const T &, const T *> const_iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+  typedef Detail::hook_traits<T, Hook> traits;
+  list_hook root_; //哨兵, 空链表时指向自己
+
+public:
+  intrusive_list() { root_.prev_ = root_.next_ = &root_; }
+  intrusive_list(const intrusive_list &) = delete;
+  intrusive_list &operator=(const intrusive_list &) = delete;
+  intrusive_list(intrusive_list &&other) : intrusive_list() {
+    splice(end(), other);
+  }
+  intrusive_list &operator=(intrusive_list &&other) {
+    if (&other != this) {
+      clear();
+      splice(end(), other);
+    }
+    return *this;
+  }
+  //摘除所有元素, 元素本身不受影响
+  ~intrusive_list() { clear(); }
+
+  iterator begin() noexcept { return root_.next_; }
+  iterator end() noexcept { return &root_; }
+  const_iterator begin() const noexcept { return root_.next_; }
+  const_iterator end() const noexcept {
+    return const_cast<list_hook *>(&root_);
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const noexcept { return root_.next_ == &root_; }
+  size_type size() const noexcept {
+    size_type n = 0;
+    for (const list_hook *h = root_.next_; h != &root_; h = h->next_)
+      ++n;
+    return n;
+  }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *(--end()); }
+  const_reference back() const { return *(--end()); }
+
+  //由对象得到迭代器/从所在链表摘除, O(1)
+  iterator iterator_to(reference x) { return traits::to_hook(x); }
+  const_iterator iterator_to(const_reference x) const {
+    return traits::to_hook(const_cast<reference>(x));
+  }
+  static void unlink(reference x) { traits::to_hook(x)->unlink(); }
+
+  void push_front(reference x) { insert(begin(), x); }
+  void push_back(reference x) { insert(end(), x); }
+  void pop_front() { erase(begin()); }
+  void pop_back() { erase(--end()); }
+  iterator insert(const_iterator position, reference x) {
+    list_hook *h = traits::to_hook(x);
+    list_hook *next = position.p;
+    h->next_ = next;
+    h->prev_ = next->prev_;
+    next->prev_->next_ = h;
+    next->prev_ = h;
+    return h;
+  }
+  template <class InputIterator>
+  void insert(const_iterator position, InputIterator first,
+              InputIterator last) {
+    for (; first != last; ++first)
+      insert(position, *first);
+  }
+  //只摘除, 返回下一个位置
+  iterator erase(const_iterator position) {
+    list_hook *next = position.p->next_;
+    position.p->unlink();
+    return next;
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last)
+      first = erase(first);
+    return last.p;
+  }
+  void clear() { erase(begin(), end()); }
+  void swap(intrusive_list &x) {
+    intrusive_list tmp;
+    tmp.splice(tmp.end(), x);
+    x.splice(x.end(), *this);
+    splice(end(), tmp);
+  }
+
+  void splice(const_iterator position, intrusive_list &x) {
+    if (!x.empty())
+      transfer(position, x.begin(), x.end());
+  }
+  void splice(const_iterator position, intrusive_list &, const_iterator i) {
+    const_iterator j = i;
+    transfer(position, i, ++j);
+  }
+  void splice(const_iterator position, intrusive_list &, const_iterator first,
+              const_iterator last) {
+    transfer(position, first, last);
+  }
+  template <class UnaryPredicate> void remove_if(UnaryPredicate pred) {
+    for (iterator it = begin(); it != end();) {
+      if (pred(*it))
+        it = erase(it);
+      else
+        ++it;
+    }
+  }
+  void merge(intrusive_list &x) { merge(x, mmm::less<T>()); }
+  template <class Compare> void merge(intrusive_list &x, Compare comp);
+  void sort() { sort(mmm::less<T>()); }
+  template <class Compare> void sort(Compare comp);
+  void reverse();
+
+private:
+  //将[first,last)移动到position之前
+  void transfer(const_iterator position, const_iterator first,
+                const_iterator last) {
+    if (first == last || position == first || position == last)
+      return;
+    list_hook *pos = position.p, *f = first.p, *l = last.p;
+    list_hook *last_node = l->prev_;
+    f->prev_->next_ = l;
+    l->prev_ = f->prev_;
+    list_hook *prev_node = pos->prev_;
+    prev_node->next_ = f;
+    f->prev_ = prev_node;
+    last_node->next_ = pos;
+    pos->prev_ = last_node;
+  }
+  template <class Compare>
+  static list_hook *merge_runs(list_hook *a, list_hook *b, Compare &comp);
+}; // end of intrusive_list
+
+// merge: x中连续一段都小于当前元素时整段搬运, 相等时*this的元素在前
+template <class T, auto Hook>
+template <class Compare>
+void intrusive_list<T, Hook>::merge(intrusive_list &x, Compare comp) {
+  if (this == &x)
+    return;
+  iterator first1 = begin(), last1 = end();
+  iterator first2 = x.begin(), last2 = x.end();
+  while (first1 != last1 && first2 != last2) {
+    if (comp(*first2, *first1)) {
+      iterator run_end = first2;
+      ++run_end;
+      while (run_end != last2 && comp(*run_end, *first1))
+        ++run_end;
+      transfer(first1, first2, run_end);
+      first2 = run_end;
+    } else
+      ++first1;
+  }
+  if (first2 != last2)
+    transfer(last1, first2, last2);
+}
+
+template <class T, auto Hook>
+template <class Compare>
+list_hook *intrusive_list<T, Hook>::merge_runs(list_hook *a, list_hook *b,
+                                               Compare &comp) {
+  list_hook *first = nullptr;
+  list_hook **tail = &first;
+  while (a && b) {
+    if (comp(*traits::to_value(b), *traits::to_value(a))) {
+      *tail = b;
+      tail = &b->next_;
+      b = b->next_;
+    } else {
+      *tail = a;
+      tail = &a->next_;
+      a = a->next_;
+    }
+  }
+  *tail = a ? a : b;
+  return first;
+}
+
+// sort: 与list::sort相同的自底向上归并, 稳定, 不分配内存
+template <class T, auto Hook>
+template <class Compare>
+void intrusive_list<T, Hook>::sort(Compare comp) {
+  if (root_.next_ == &root_ || root_.next_->next_ == &root_)
+    return;
+  list_hook *bucket[64];
+  int fill = 0;
+  list_hook *p = root_.next_;
+  root_.prev_->next_ = nullptr;
+  while (p) {
+    list_hook *carry = p;
+    p = p->next_;
+    carry->next_ = nullptr;
+    int i = 0;
+    for (; i < fill && bucket[i]; ++i) {
+      carry = merge_runs(bucket[i], carry, comp);
+      bucket[i] = nullptr;
+    }
+    bucket[i] = carry;
+    if (i == fill)
+      ++fill;
+  }
+  list_hook *result = nullptr;
+  for (int i = 0; i < fill; ++i) {
+    if (bucket[i])
+      result = result ? merge_runs(bucket[i], result, comp) : bucket[i];
+  }
+  list_hook *prev = &root_;
+  for (list_hook *cur = result; cur; cur = cur->next_) {
+    cur->prev_ = prev;
+    prev->next_ = cur;
+    prev = cur;
+  }
+  prev->next_ = &root_;
+  root_.prev_ = prev;
+}
+
+template <class T, auto Hook> void intrusive_list<T, Hook>::reverse() {
+  list_hook *h = &root_;
+  do {
+    list_hook *next = h->next_;
+    h->next_ = h->prev_;
+    h->prev_ = next;
+    h = next;
+  } while (h != &root_);
+}
+
+template <class T, auto Hook>
+inline void swap(intrusive_list<T, Hook> &x, intrusive_list<T, Hook> &y) {
+  x.swap(y);
+}
+
+} // namespace mmm
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _ITERATOR_H_
 #define _ITERATOR_H_
 
+#include "type_traits.h"
 #include <cstddef> //ptrdiff_t
 #include  <initializer_list>
 
@@ -54,6 +55,19 @@ template <class T> struct iterator_traits<const T *> {
   typedef const T &reference;
 };
 
+//分段迭代器协议: 迭代器底下是若干段连续内存(如deque的块).
+//特化此模板并提供 segment/local/begin/end/compose, 算法即可逐段处理,
+//每段内部退化为指针上的快速路径.
+//  segment(it): it所在段; local(it): 段内指针; begin/end(seg): 段的范围;
+//  compose(seg, local): 由段和段内指针还原迭代器.
+template <class Iterator> struct segmented_iterator_traits {
+  typedef false_type is_segmented_iterator;
+};
+
+template <class Iterator>
+using is_segmented_iterator =
+    typename segmented_iterator_traits<Iterator>::is_segmented_iterator;
+
 //萃取迭代器所指类型
 template <typename Iterator>
 using iterator_value_type = typename iterator_traits<Iterator>::value_type;
@@ -184,7 +198,7 @@ template <class InputIterator>
 iterator_difference_type<InputIterator>
 _distance(InputIterator first, InputIterator last, forward_iterator_tag) {
   iterator_difference_type<InputIterator> dist = 0;
-  while (first++ != last) {
+  for (; first != last; ++first) {
     ++dist;
   }
   return dist;
@@ -96,12 +96,13 @@ private:
   //iterator is not for implement, we use raw data 
 	// begin = end when init ,see reference
   node_ptr head;
+  size_type size_; //元素个数, 所有修改(包括splice/merge)都同步维护
 
 public:
   list();
 
   explicit list(size_type n, const value_type &val = value_type()){
-		listAux(n, val, is_integer<value_type>());
+		listAux(n, val, true_type());
 	}
 
   //stl not support this, same as copy(source.begin(), source.end(), destination);
@@ -130,7 +131,7 @@ public:
 
 public:
   bool empty() const noexcept { return head->next == head; }
-  size_type size() const noexcept;
+  size_type size() const noexcept { return size_; }
 
   iterator begin() noexcept { //若容器为空，则返回的迭代器将等于end() 。
 		return head->next;
@@ -168,7 +169,7 @@ public:
   iterator insert(iterator position, const value_type &val);
 
   void insert(iterator position, size_type n, const value_type &val){
-		insert_aux(position, n, val, is_integer<value_type>());
+		insert_aux(position, n, val, true_type());
 	}
 	
   template <class InputIterator> //声明为模板使得能以其他容器赋值如vector
@@ -196,9 +197,13 @@ public:
   void sort(){ sort(mmm::less<T>());}
   template <class Compare> void sort(Compare comp);
   void reverse();
-  void transfer(const_iterator position, const_iterator first, const_iterator last);
 
 private:
+  //只移动结点, 不维护size_, 由调用方负责
+  void transfer(const_iterator position, const_iterator first, const_iterator last);
+  void empty_initialize();
+  void link_chain(const_iterator position, node_ptr first, node_ptr last,
+                  size_type n);
   void listAux(size_type n, const value_type &val, true_type);
   template <class InputIterator>
   void listAux(InputIterator first, InputIterator last, false_type);
@@ -208,7 +213,10 @@ private:
                   false_type);
   node_ptr create_node(const T &val = T());
   void delete_node(node_ptr p);
+  void delete_chain(node_ptr first);
   const_iterator changeIteratorToConstIterator(iterator &it) const;
+  template <class Compare>
+  static node_ptr merge_runs(node_ptr a, node_ptr b, Compare &comp);
 
 
 }; // end of List
@@ -237,7 +245,12 @@ bool operator!=(const list<T, Allocator> &lhs, const list<T, Allocator> &rhs) {
 template <class T, class Allocator>
 typename list<T, Allocator>::node_ptr list<T, Allocator>::create_node(const T &val) {
   node_ptr tmp = allocator_type::allocate();
-  mmm::construct(&tmp->data, val);
+  try {
+    mmm::construct(&tmp->data, val);
+  } catch (...) {
+    allocator_type::deallocate(tmp);
+    throw;
+  }
 	tmp->next = tmp->prev = nullptr;
   return tmp;
 }
@@ -248,51 +261,46 @@ void list<T, Allocator>::delete_node(node_ptr p) {
   mmm::destroy(&p->data);
   allocator_type::deallocate(p);
 }
-
-//size
+//释放还没接进链表的一串结点(next相连, 以nullptr结尾)
 template <class T, class Allocator>
-typename list<T, Allocator>::size_type list<T, Allocator>::size() const noexcept {
-  size_type length = 0;
-  for (auto h = head->next; h != head; h = h->next)
-    ++length;
-  return length;
+void list<T, Allocator>::delete_chain(node_ptr first) {
+  while (first) {
+    node_ptr next = first->next;
+    delete_node(first);
+    first = next;
+  }
 }
 
 //构造函数,析构函数
 
-template <class T, class Allocator> list<T, Allocator>::list() {
+template <class T, class Allocator> void list<T, Allocator>::empty_initialize() {
   head = create_node(); //dummy
   head->next = head;
   head->prev = head;
+  size_ = 0;
+}
+
+template <class T, class Allocator> list<T, Allocator>::list() {
+  empty_initialize();
 }
 
 template <class T, class Allocator>
 void list<T, Allocator>::listAux(size_type n, const value_type &val,
                                  true_type) {
-  head = create_node();
-  head->next = head;
-  head->prev = head;
-  while (n--)
-    push_back(val);
+  empty_initialize();
+  insert_aux(end(), n, val, true_type());
 }
 template <class T, class Allocator>
 template <class InputIterator>
 void list<T, Allocator>::listAux(InputIterator first, InputIterator last,
                                  false_type) {
-  head = create_node();
-  head->next = head;
-  head->prev = head;
-  auto tmp = first;
-  for (; tmp != last; ++tmp)
-    push_back(*tmp);
+  empty_initialize();
+  insert_aux(end(), first, last, false_type());
 }
 template <class T, class Allocator>
 list<T, Allocator>::list(const list &other) { //直接初始化
-  head = create_node();
-  head->next = head;
-  head->prev = head;
-  for (auto cur = other.begin(); cur != other.end(); ++cur)
-    push_back(*cur);
+  empty_initialize();
+  insert_aux(end(), other.begin(), other.end(), false_type());
 }
 
 // insert
@@ -305,22 +313,64 @@ list<T, Allocator>::insert(iterator position, const value_type &val) {
   tmp->prev = position.prev();
   position.prev()->next = tmp;
   position.prev() = tmp;
+  ++size_;
   return tmp;
 }
 
+//把已经链好的[first, last]这串结点一次接到position之前
+template <class T, class Allocator>
+void list<T, Allocator>::link_chain(const_iterator position, node_ptr first,
+                                    node_ptr last, size_type n) {
+  node_ptr next = position.p;
+  node_ptr prev = next->prev;
+  prev->next = first;
+  first->prev = prev;
+  last->next = next;
+  next->prev = last;
+  size_ += n;
+}
+
+//批量插入: 先在链表之外构造并串好所有结点, 最后只改一次position两侧的指针
 template <class T, class Allocator>
 void list<T, Allocator>::insert_aux(iterator position, size_type n, const T &val, true_type) {
-  for (auto i = n; i != 0; --i) {
-    position = insert(position, val);
+  if (n == 0)
+    return;
+  node_ptr first = create_node(val);
+  node_ptr last = first;
+  try {
+    for (size_type i = 1; i != n; ++i) {
+      node_ptr tmp = create_node(val);
+      last->next = tmp;
+      tmp->prev = last;
+      last = tmp;
+    }
+  } catch (...) {
+    //链表本身还没动过, 只需释放已构造的结点
+    delete_chain(first);
+    throw;
   }
+  link_chain(position, first, last, n);
 }
 template <class T, class Allocator>
 template <class InputIterator>
 void list<T, Allocator>::insert_aux(iterator position, InputIterator first, InputIterator last, false_type) {
-  for (--last; first != last; --last) {
-    position = insert(position, *last);
+  if (first == last)
+    return;
+  node_ptr chain_first = create_node(*first);
+  node_ptr chain_last = chain_first;
+  size_type n = 1;
+  try {
+    for (++first; first != last; ++first, ++n) {
+      node_ptr tmp = create_node(*first);
+      chain_last->next = tmp;
+      tmp->prev = chain_last;
+      chain_last = tmp;
+    }
+  } catch (...) {
+    delete_chain(chain_first);
+    throw;
   }
-  insert(position, *last);
+  link_chain(position, chain_first, chain_last, n);
 }
 
 // push/pop
@@ -335,6 +385,7 @@ list<T, Allocator>::erase(iterator position) {
   position.next()->prev = position.prev();
   position.prev()->next = position.next();
   delete_node(position());
+  --size_;
   return ret;
 }
 template <class T, class Allocator>
@@ -370,6 +421,9 @@ template <class T, class Allocator> void list<T, Allocator>::swap(list &x) noexc
   node_ptr tmp = x.head;
   x.head = this->head;
   this->head = tmp;
+  size_type n = x.size_;
+  x.size_ = size_;
+  size_ = n;
 }
 
 //将[first,last)之间的元素移动到position之前
@@ -398,6 +452,8 @@ void list<T, Allocator>::splice(const_iterator position, list &x) {
   if (x.empty())
     return;
   transfer(position, x.begin(), x.end());
+  size_ += x.size_;
+  x.size_ = 0;
 }
 
 
@@ -405,7 +461,12 @@ void list<T, Allocator>::splice(const_iterator position, list &x) {
 template <class T, class Allocator>
 void list<T, Allocator>::splice(const_iterator position, list &x, const_iterator i) {
   const_iterator j = i;
-  transfer(position, i, ++j);
+  ++j;
+  if (position == i || position == j)
+    return;
+  transfer(position, i, j);
+  ++size_;
+  --x.size_;
 }
 
 template <class T, class Allocator>
@@ -413,6 +474,14 @@ void list<T, Allocator>::splice(const_iterator position, list &x, const_iterator
                                 const_iterator last) {
   if (position == last)
     return;
+  //同一个list内部移动时个数不变; 跨list时只能数一遍(与std::list相同)
+  if (&x != this) {
+    size_type n = 0;
+    for (const_iterator it = first; it != last; ++it)
+      ++n;
+    size_ += n;
+    x.size_ -= n;
+  }
   transfer(position, first, last);
 }
 
@@ -451,39 +520,92 @@ void list<T, Allocator>::unique(BinaryPredicate binary_pred) {
   }
 }
 // merge 将x与*this合并，两个list必须经过递增排序. 抽扑克牌
+// x中连续一段都小于*it1时整段transfer过来. 相等时*this的元素在前(稳定)
 template <class T, class Allocator>
 template <class Compare>
 void list<T, Allocator>::merge(list &x, Compare comp) {
-  auto it1 = begin(), it2 = x.begin();
-  while (it1 != end() && it2 != x.end()) {
-    if (comp(*it2, *it1)) {
-      auto temp = it2;
-			transfer(it1, temp, ++it2);
+  if (this == &x)
+    return;
+  size_ += x.size_;
+  x.size_ = 0;
+  iterator first1 = begin(), last1 = end();
+  iterator first2 = x.begin(), last2 = x.end();
+  while (first1 != last1 && first2 != last2) {
+    if (comp(*first2, *first1)) {
+      iterator run_end = first2;
+      ++run_end;
+      while (run_end != last2 && comp(*run_end, *first1))
+        ++run_end;
+      transfer(first1, first2, run_end);
+      first2 = run_end;
     } else
-      ++it1;
+      ++first1;
   }
-  if (it1 == end()) {
-    splice(it1, x, it2, x.end());
+  if (first2 != last2)
+    transfer(last1, first2, last2);
+}
+
+//合并两段以nullptr结尾的单向链(只用next), 相等时a在前
+template <class T, class Allocator>
+template <class Compare>
+typename list<T, Allocator>::node_ptr
+list<T, Allocator>::merge_runs(node_ptr a, node_ptr b, Compare &comp) {
+  node_ptr first = nullptr;
+  node_ptr *tail = &first;
+  while (a && b) {
+    if (comp(b->data, a->data)) {
+      *tail = b;
+      tail = &b->next;
+      b = b->next;
+    } else {
+      *tail = a;
+      tail = &a->next;
+      a = a->next;
+    }
   }
+  *tail = a ? a : b;
+  return first;
 }
 
-//构造一个临时链表. 从头遍历依次插入
+// sort: 自底向上的归并排序(SGI). bucket[i]存放长度为2^i的有序段,
+// 每取下一个结点就像二进制加一那样向上合并. 稳定, 不分配内存.
+// 段只在next方向上链接, 全部合并完后再一次性补上prev.
 template <class T, class Allocator>
 template <class Compare>
 void list<T, Allocator>::sort(Compare comp) {
-  if (empty() || size() == 1)
+  if (head->next == head || head->next->next == head)
     return;
-  list<T, Allocator> tmp;
-  auto q = begin();
-  while (!empty()) {
-    auto p = tmp.begin();
-    while (p != tmp.end() && comp(*p, *q))
-      p++;
-    tmp.splice(p, *this, q);
-    q = begin();
+  node_ptr bucket[64];
+  int fill = 0;
+  node_ptr p = head->next;
+  head->prev->next = nullptr;
+  while (p) {
+    node_ptr carry = p;
+    p = p->next;
+    carry->next = nullptr;
+    int i = 0;
+    for (; i < fill && bucket[i]; ++i) {
+      carry = merge_runs(bucket[i], carry, comp); // bucket[i]中的元素更靠前
+      bucket[i] = nullptr;
+    }
+    bucket[i] = carry;
+    if (i == fill)
+      ++fill;
+  }
+  node_ptr result = nullptr;
+  for (int i = 0; i < fill; ++i) {
+    if (bucket[i])
+      result = result ? merge_runs(bucket[i], result, comp) : bucket[i];
+  }
+  //恢复成双向循环链表
+  node_ptr prev = head;
+  for (node_ptr cur = result; cur; cur = cur->next) {
+    cur->prev = prev;
+    prev->next = cur;
+    prev = cur;
   }
-  //将tmp赋给本list
-  this->swap(tmp);
+  prev->next = head;
+  head->prev = prev;
 }
 
 } // namespace mmm
@@ -9,14 +9,16 @@
 
 namespace mmm {
 template <typename Key, typename T, typename Compare = mmm::less<Key>,
-          typename Allocator = mmm::allocator<rbtree_node<mmm::pair<const Key, T>>>>
+          typename Allocator = mmm::allocator<rbtree_node<mmm::pair<const Key, T>>>,
+          typename Augment = rbtree_no_augment>
 class map : public rbtree<Key, mmm::pair<const Key, T>, Compare, Allocator,
-                          mmm::select1st<mmm::pair<const Key, T>>, true, true> {
+                          mmm::select1st<mmm::pair<const Key, T>>, true, true,
+                          Augment> {
 public:
   typedef rbtree<Key, mmm::pair<const Key, T>, Compare, Allocator,
-                 mmm::select1st<mmm::pair<const Key, T>>, true, true>
+                 mmm::select1st<mmm::pair<const Key, T>>, true, true, Augment>
       base_type;
-  typedef map<Key, T, Compare, Allocator> this_type;
+  typedef map<Key, T, Compare, Allocator, Augment> this_type;
   typedef typename base_type::size_type size_type;
   typedef typename base_type::key_type key_type;
   typedef T mapped_type;
@@ -29,7 +31,9 @@ public:
   typedef typename base_type::extract_key extract_key;
 
   using base_type::begin;
+  using base_type::count;
   using base_type::end;
+  using base_type::equal_range;
   using base_type::erase;
   using base_type::find;
   using base_type::insert;
@@ -72,6 +76,12 @@ public:
   template <typename Iterator>
   map(Iterator itBegin, Iterator itEnd)
       : base_type(itBegin, itEnd, Compare(), allocator_type()) {}
+  //输入已有序时直接O(n)建树
+  template <typename Iterator>
+  map(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+      const Compare &compare = Compare(),
+      const allocator_type &allocator = allocator_type())
+      : base_type(sorted_unique, itBegin, itEnd, compare, allocator) {}
 
   this_type &operator=(const this_type &x) {
     return (this_type &)base_type::operator=(x);
@@ -121,15 +131,17 @@ public:
 /// multimap
 
 template <typename Key, typename T, typename Compare = mmm::less<Key>,
-          typename Allocator = mmm::allocator<rbtree_node<mmm::pair<const Key, T>>>>
+          typename Allocator = mmm::allocator<rbtree_node<mmm::pair<const Key, T>>>,
+          typename Augment = rbtree_no_augment>
 class multimap
     : public rbtree<Key, mmm::pair<const Key, T>, Compare, Allocator,
-                    mmm::select1st<mmm::pair<const Key, T>>, true, false> {
+                    mmm::select1st<mmm::pair<const Key, T>>, true, false,
+                    Augment> {
 public:
   typedef rbtree<Key, mmm::pair<const Key, T>, Compare, Allocator,
-                 mmm::select1st<mmm::pair<const Key, T>>, true, false>
+                 mmm::select1st<mmm::pair<const Key, T>>, true, false, Augment>
       base_type;
-  typedef multimap<Key, T, Compare, Allocator> this_type;
+  typedef multimap<Key, T, Compare, Allocator, Augment> this_type;
   typedef typename base_type::size_type size_type;
   typedef typename base_type::key_type key_type;
   typedef T mapped_type;
@@ -143,7 +155,9 @@ public:
   // Other types are inherited from the base class.
 
   using base_type::begin;
+  using base_type::count;
   using base_type::end;
+  using base_type::equal_range;
   using base_type::erase;
   using base_type::find;
   using base_type::insert;
@@ -188,6 +202,12 @@ public:
   template <typename Iterator>
   multimap(Iterator itBegin, Iterator itEnd)
       : base_type(itBegin, itEnd, Compare(), allocator_type()) {}
+  //输入已有序时直接O(n)建树
+  template <typename Iterator>
+  multimap(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+           const Compare &compare = Compare(),
+           const allocator_type &allocator = allocator_type())
+      : base_type(sorted_unique, itBegin, itEnd, compare, allocator) {}
   this_type &operator=(const this_type &x) {
     return (this_type &)base_type::operator=(x);
   }
@@ -235,12 +255,56 @@ private:
   using base_type::try_emplace;
 }; // multimap
 
+//集合运算(按key), 返回新的容器, 键相等时取a的值; 实现见rbtree::unite/intersect/subtract
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline map<Key, T, Compare, Allocator, Augment>
+set_union(const map<Key, T, Compare, Allocator, Augment> &a,
+          const map<Key, T, Compare, Allocator, Augment> &b) {
+  map<Key, T, Compare, Allocator, Augment> result(a);
+  result.unite(b);
+  return result;
+}
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline map<Key, T, Compare, Allocator, Augment>
+set_intersection(const map<Key, T, Compare, Allocator, Augment> &a,
+                 const map<Key, T, Compare, Allocator, Augment> &b) {
+  map<Key, T, Compare, Allocator, Augment> result(a);
+  result.intersect(b);
+  return result;
+}
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline map<Key, T, Compare, Allocator, Augment>
+set_difference(const map<Key, T, Compare, Allocator, Augment> &a,
+               const map<Key, T, Compare, Allocator, Augment> &b) {
+  map<Key, T, Compare, Allocator, Augment> result(a);
+  result.subtract(b);
+  return result;
+}
+
+//结点带子树大小的map/multimap, 额外提供O(log n)的nth/rank/count_range
+template <typename Key, typename T, typename Compare = mmm::less<Key>>
+using order_statistic_map =
+    map<Key, T, Compare,
+        mmm::allocator<
+            rbtree_node<mmm::pair<const Key, T>, rbtree_size_node_base>>,
+        rbtree_order_statistics>;
+template <typename Key, typename T, typename Compare = mmm::less<Key>>
+using order_statistic_multimap =
+    multimap<Key, T, Compare,
+             mmm::allocator<
+                 rbtree_node<mmm::pair<const Key, T>, rbtree_size_node_base>>,
+             rbtree_order_statistics>;
+
 // map
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline mmm::pair<typename map<Key, T, Compare, Allocator>::iterator,
-                 typename map<Key, T, Compare, Allocator>::iterator>
-map<Key, T, Compare, Allocator>::equal_range(const Key &key) {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename map<Key, T, Compare, Allocator, Augment>::iterator,
+                 typename map<Key, T, Compare, Allocator, Augment>::iterator>
+map<Key, T, Compare, Allocator, Augment>::equal_range(const Key &key) {
 
   const iterator itLower(lower_bound(key));
 
@@ -253,10 +317,11 @@ map<Key, T, Compare, Allocator>::equal_range(const Key &key) {
   return mmm::pair<iterator, iterator>(itLower, ++itUpper);
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline mmm::pair<typename map<Key, T, Compare, Allocator>::const_iterator,
-                 typename map<Key, T, Compare, Allocator>::const_iterator>
-map<Key, T, Compare, Allocator>::equal_range(const Key &key) const {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename map<Key, T, Compare, Allocator, Augment>::const_iterator,
+                 typename map<Key, T, Compare, Allocator, Augment>::const_iterator>
+map<Key, T, Compare, Allocator, Augment>::equal_range(const Key &key) const {
   const const_iterator itLower(lower_bound(key));
 
   if ((itLower == end()) ||
@@ -268,8 +333,9 @@ map<Key, T, Compare, Allocator>::equal_range(const Key &key) const {
   return mmm::pair<const_iterator, const_iterator>(itLower, ++itUpper);
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline T &map<Key, T, Compare, Allocator>::operator[](const Key &key) {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline T &map<Key, T, Compare, Allocator, Augment>::operator[](const Key &key) {
   iterator itLower(lower_bound(key)); // itLower->first is >= key.
   
   if ((itLower == end()) || mCompare(key, (*itLower).first)) {
@@ -283,8 +349,9 @@ inline T &map<Key, T, Compare, Allocator>::operator[](const Key &key) {
   // T())).first); return it->second;
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline T &map<Key, T, Compare, Allocator>::operator[](Key &&key) {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline T &map<Key, T, Compare, Allocator, Augment>::operator[](Key &&key) {
   iterator itLower(lower_bound(key)); // itLower->first is >= key.
 
   if ((itLower == end()) || mCompare(key, (*itLower).first)) {
@@ -294,8 +361,9 @@ inline T &map<Key, T, Compare, Allocator>::operator[](Key &&key) {
   return (*itLower).second;
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline T &map<Key, T, Compare, Allocator>::at(const Key &key) {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline T &map<Key, T, Compare, Allocator, Augment>::at(const Key &key) {
   iterator itLower(lower_bound(key)); // itLower->first is >= key.
 
   if (itLower == end()) {
@@ -305,8 +373,10 @@ inline T &map<Key, T, Compare, Allocator>::at(const Key &key) {
   return (*itLower).second;
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline const T &map<Key, T, Compare, Allocator>::at(const Key &key) const {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline const T &
+map<Key, T, Compare, Allocator, Augment>::at(const Key &key) const {
   const_iterator itLower(lower_bound(key)); // itLower->first is >= key.
 
   if (itLower == end()) {
@@ -317,10 +387,11 @@ inline const T &map<Key, T, Compare, Allocator>::at(const Key &key) const {
 }
 
 // multimap
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline mmm::pair<typename multimap<Key, T, Compare, Allocator>::iterator,
-                 typename multimap<Key, T, Compare, Allocator>::iterator>
-multimap<Key, T, Compare, Allocator>::equal_range_small(const Key &key) {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename multimap<Key, T, Compare, Allocator, Augment>::iterator,
+                 typename multimap<Key, T, Compare, Allocator, Augment>::iterator>
+multimap<Key, T, Compare, Allocator, Augment>::equal_range_small(const Key &key) {
   const iterator itLower(lower_bound(key));
   iterator itUpper(itLower);
 
@@ -330,10 +401,11 @@ multimap<Key, T, Compare, Allocator>::equal_range_small(const Key &key) {
   return mmm::pair<iterator, iterator>(itLower, itUpper);
 }
 
-template <typename Key, typename T, typename Compare, typename Allocator>
-inline mmm::pair<typename multimap<Key, T, Compare, Allocator>::const_iterator,
-                 typename multimap<Key, T, Compare, Allocator>::const_iterator>
-multimap<Key, T, Compare, Allocator>::equal_range_small(const Key &key) const {
+template <typename Key, typename T, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename multimap<Key, T, Compare, Allocator, Augment>::const_iterator,
+                 typename multimap<Key, T, Compare, Allocator, Augment>::const_iterator>
+multimap<Key, T, Compare, Allocator, Augment>::equal_range_small(const Key &key) const {
   const const_iterator itLower(lower_bound(key));
   const_iterator itUpper(itLower);
 
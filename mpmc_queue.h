@@ -0,0 +1,213 @@
+#ifndef _MPMC_QUEUE_H_
+#define _MPMC_QUEUE_H_
+
+#include "allocator.h"
+#include "futex.h"
+#include "utility.h"
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+
+namespace mmm {
+
+// mpmc_queue: 多生产者/多消费者的有界无锁队列(Vyukov).
+// 容量取整为2的幂, 每个槽位带一个序号seq:
+//   seq == pos        槽位空闲, 等待第pos次入队
+//   seq == pos + 1    槽位已写入, 等待第pos次出队
+// 生产者/消费者各自CAS推进enqueue_pos_/dequeue_pos_抢到槽位, 之后只和这个槽位打交道.
+// 两个位置计数各占一个缓存行.
+// push/pop是阻塞版本: 先自旋重试, 仍不成功则在futex上睡眠;
+// 只有登记了等待者时, 对端才会去唤醒, 没有等待者时不做系统调用.
+// 注意: 元素的构造/移动不应抛出异常, 否则抢到的槽位永远不会被发布.
+template <class T> class mpmc_queue {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+
+private:
+  struct cell {
+    std::atomic<size_type> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+    T *value() { return reinterpret_cast<T *>(storage); }
+  };
+  typedef allocator<cell> cellAllocator;
+
+  enum { kSpinCount = 64 };
+
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<size_type> enqueue_pos_;
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<size_type> dequeue_pos_;
+  alignas(_MMM_CACHE_LINE_SIZE) cell *buf_;
+  size_type mask_;
+  //阻塞等待: 事件计数作为futex字, 等待者个数决定是否需要唤醒
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<uint32_t> not_empty_;
+  std::atomic<uint32_t> pop_waiters_;
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<uint32_t> not_full_;
+  std::atomic<uint32_t> push_waiters_;
+
+public:
+  explicit mpmc_queue(size_type capacity)
+      : enqueue_pos_(0), dequeue_pos_(0), buf_(nullptr), mask_(0),
+        not_empty_(0), pop_waiters_(0), not_full_(0), push_waiters_(0) {
+    size_type len = 2;
+    while (len < capacity)
+      len <<= 1;
+    buf_ = cellAllocator::allocate(len);
+    for (size_type i = 0; i != len; ++i)
+      new (&buf_[i].seq) std::atomic<size_type>(i);
+    mask_ = len - 1;
+  }
+  mpmc_queue(const mpmc_queue &) = delete;
+  mpmc_queue &operator=(const mpmc_queue &) = delete;
+  ~mpmc_queue() {
+    const size_type last = enqueue_pos_.load(std::memory_order_relaxed);
+    for (size_type i = dequeue_pos_.load(std::memory_order_relaxed); i != last;
+         ++i)
+      buf_[i & mask_].value()->~T();
+    cellAllocator::deallocate(buf_, mask_ + 1);
+  }
+
+  //非阻塞: 满/空时立即返回false
+  bool try_push(const value_type &val) { return try_emplace(val); }
+  bool try_push(value_type &&val) { return try_emplace(mmm::move(val)); }
+  template <class... Args> bool try_emplace(Args &&... args);
+  bool try_pop(value_type &out);
+
+  //阻塞: 满/空时先自旋, 再睡眠到对端唤醒
+  void push(const value_type &val) { emplace(val); }
+  void push(value_type &&val) { emplace(mmm::move(val)); }
+  template <class... Args> void emplace(Args &&... args);
+  void pop(value_type &out);
+
+  //并发时只是一个近似值
+  size_type size() const noexcept {
+    const size_type head = dequeue_pos_.load(std::memory_order_acquire);
+    const size_type tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+  size_type capacity() const noexcept { return mask_ + 1; }
+
+private:
+  //抢到的槽位, 满/空时返回nullptr
+  cell *claim_enqueue(size_type &pos);
+  cell *claim_dequeue(size_type &pos);
+  //在event上等待, 直到try_op()成功
+  template <class TryOp>
+  void wait_until(std::atomic<uint32_t> &event, std::atomic<uint32_t> &waiters,
+                  TryOp try_op);
+  static void notify(std::atomic<uint32_t> &event,
+                     std::atomic<uint32_t> &waiters) {
+    //与wait_until中的登记配对: 要么对方看到新状态, 要么这里看到等待者
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+      event.fetch_add(1, std::memory_order_release);
+      Detail::futex_wake(&event, 1);
+    }
+  }
+}; // end of mpmc_queue
+
+template <class T>
+typename mpmc_queue<T>::cell *mpmc_queue<T>::claim_enqueue(size_type &pos) {
+  pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    cell *c = &buf_[pos & mask_];
+    const size_type seq = c->seq.load(std::memory_order_acquire);
+    const intptr_t dif = intptr_t(seq) - intptr_t(pos);
+    if (dif == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed))
+        return c;
+    } else if (dif < 0) {
+      return nullptr; //满
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <class T>
+typename mpmc_queue<T>::cell *mpmc_queue<T>::claim_dequeue(size_type &pos) {
+  pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    cell *c = &buf_[pos & mask_];
+    const size_type seq = c->seq.load(std::memory_order_acquire);
+    const intptr_t dif = intptr_t(seq) - intptr_t(pos + 1);
+    if (dif == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed))
+        return c;
+    } else if (dif < 0) {
+      return nullptr; //空
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <class T>
+template <class... Args>
+bool mpmc_queue<T>::try_emplace(Args &&... args) {
+  size_type pos;
+  cell *c = claim_enqueue(pos);
+  if (!c)
+    return false;
+  new (c->storage) T(mmm::forward<Args>(args)...);
+  c->seq.store(pos + 1, std::memory_order_release);
+  notify(not_empty_, pop_waiters_);
+  return true;
+}
+
+template <class T> bool mpmc_queue<T>::try_pop(value_type &out) {
+  size_type pos;
+  cell *c = claim_dequeue(pos);
+  if (!c)
+    return false;
+  out = mmm::move(*c->value());
+  c->value()->~T();
+  c->seq.store(pos + mask_ + 1, std::memory_order_release);
+  notify(not_full_, push_waiters_);
+  return true;
+}
+
+template <class T>
+template <class TryOp>
+void mpmc_queue<T>::wait_until(std::atomic<uint32_t> &event,
+                               std::atomic<uint32_t> &waiters, TryOp try_op) {
+  for (int i = 0; i != kSpinCount; ++i) {
+    if (try_op())
+      return;
+    std::this_thread::yield();
+  }
+  while (true) {
+    const uint32_t ev = event.load(std::memory_order_acquire);
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool done = try_op();
+    if (!done)
+      Detail::futex_wait(&event, ev);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    if (done || try_op())
+      return;
+  }
+}
+
+template <class T>
+template <class... Args>
+void mpmc_queue<T>::emplace(Args &&... args) {
+  //参数可能在多次重试之间被移动, 先构造好再入队
+  value_type tmp(mmm::forward<Args>(args)...);
+  wait_until(not_full_, push_waiters_,
+             [this, &tmp] { return try_emplace(mmm::move(tmp)); });
+}
+
+template <class T> void mpmc_queue<T>::pop(value_type &out) {
+  wait_until(not_empty_, pop_waiters_, [this, &out] { return try_pop(out); });
+}
+
+} // namespace mmm
+
+#endif
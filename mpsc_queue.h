@@ -0,0 +1,176 @@
+#ifndef _MPSC_QUEUE_H_
+#define _MPSC_QUEUE_H_
+
+#include "allocator.h"
+#include "utility.h"
+#include <atomic>
+#include <new>
+#include <stddef.h>
+
+namespace mmm {
+
+// 无界的多生产者/单消费者队列(Vyukov的侵入式MPSC).
+// 元素自带链接(继承mpsc_hook), 入队只有一次原子exchange: 把自己换成back_,
+// 再把旧的back_链到自己后面, 与生产者个数无关, 也不会失败重试.
+// 消费者独占front_, 出队不需要原子读-改-写; 队列里始终有一个哑节点stub_,
+// 用来在取走最后一个元素时保持链表非空.
+// 生产者刚exchange完、还没链上next时, 消费者会暂时看不到它之后的元素(pop返回nullptr),
+// 稍后重试即可.
+
+struct mpsc_hook {
+  std::atomic<mpsc_hook *> mpsc_next_;
+  mpsc_hook() : mpsc_next_(nullptr) {}
+};
+
+// 侵入式版本: T须继承mpsc_hook, 队列不管理节点的生命周期.
+template <class T> class intrusive_mpsc_queue {
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef size_t size_type;
+
+private:
+  //生产者
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<mpsc_hook *> back_;
+  //消费者
+  alignas(_MMM_CACHE_LINE_SIZE) mpsc_hook *front_;
+  mpsc_hook stub_;
+
+public:
+  intrusive_mpsc_queue() : back_(&stub_), front_(&stub_) {}
+  intrusive_mpsc_queue(const intrusive_mpsc_queue &) = delete;
+  intrusive_mpsc_queue &operator=(const intrusive_mpsc_queue &) = delete;
+
+  //任意线程
+  void push(pointer node) { link(static_cast<mpsc_hook *>(node)); }
+
+  //以下只能由消费者调用
+  //取出队首, 为空(或队首的生产者尚未完成链接)时返回nullptr
+  pointer pop();
+  //一次取出最多max个, 依次写到out, 返回个数
+  template <class OutputIterator>
+  size_type pop_batch(OutputIterator out, size_type max) {
+    size_type n = 0;
+    for (; n != max; ++n, ++out) {
+      pointer p = pop();
+      if (!p)
+        break;
+      *out = p;
+    }
+    return n;
+  }
+  bool empty() const {
+    return front_ == &stub_ &&
+           stub_.mpsc_next_.load(std::memory_order_acquire) == nullptr &&
+           back_.load(std::memory_order_acquire) == &stub_;
+  }
+
+private:
+  void link(mpsc_hook *h) {
+    h->mpsc_next_.store(nullptr, std::memory_order_relaxed);
+    mpsc_hook *prev = back_.exchange(h, std::memory_order_acq_rel);
+    prev->mpsc_next_.store(h, std::memory_order_release);
+  }
+}; // end of intrusive_mpsc_queue
+
+template <class T>
+typename intrusive_mpsc_queue<T>::pointer intrusive_mpsc_queue<T>::pop() {
+  mpsc_hook *front = front_;
+  mpsc_hook *next = front->mpsc_next_.load(std::memory_order_acquire);
+  if (front == &stub_) {
+    if (!next)
+      return nullptr;
+    front_ = front = next;
+    next = next->mpsc_next_.load(std::memory_order_acquire);
+  }
+  if (next) {
+    front_ = next;
+    return static_cast<pointer>(front);
+  }
+  //front是最后一个已链接的节点: 若还有生产者正在链接, 稍后再取
+  if (front != back_.load(std::memory_order_acquire))
+    return nullptr;
+  //把stub放回队尾, 这样front就有了后继, 可以被取走
+  link(&stub_);
+  next = front->mpsc_next_.load(std::memory_order_acquire);
+  if (next) {
+    front_ = next;
+    return static_cast<pointer>(front);
+  }
+  return nullptr;
+}
+
+// 非侵入式版本: 每个元素放在一个节点里. 节点默认直接用malloc分配,
+// malloc本身线程安全, 生产者之间不争同一把锁; 想用alloc内存池可传入
+// locked_allocator_alloc, 代价是所有类型共用一把自旋锁.
+template <class T> struct mpsc_value_node : public mpsc_hook {
+  T value;
+  template <class... Args>
+  explicit mpsc_value_node(Args &&... args)
+      : value(mmm::forward<Args>(args)...) {}
+};
+
+template <class T,
+          class NodeAlloc = allocator<mpsc_value_node<T>>>
+class mpsc_queue {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+
+private:
+  typedef mpsc_value_node<T> node;
+  intrusive_mpsc_queue<node> queue_;
+
+public:
+  mpsc_queue() {}
+  mpsc_queue(const mpsc_queue &) = delete;
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+  ~mpsc_queue() {
+    while (node *p = queue_.pop())
+      destroy_node(p);
+  }
+
+  //任意线程
+  void push(const value_type &val) { emplace(val); }
+  void push(value_type &&val) { emplace(mmm::move(val)); }
+  template <class... Args> void emplace(Args &&... args) {
+    node *p = NodeAlloc::allocate();
+    new (p) node(mmm::forward<Args>(args)...);
+    queue_.push(p);
+  }
+
+  //以下只能由消费者调用
+  bool try_pop(value_type &out) {
+    node *p = queue_.pop();
+    if (!p)
+      return false;
+    out = mmm::move(p->value);
+    destroy_node(p);
+    return true;
+  }
+  template <class OutputIterator>
+  size_type pop_batch(OutputIterator out, size_type max) {
+    size_type n = 0;
+    for (; n != max; ++n, ++out) {
+      node *p = queue_.pop();
+      if (!p)
+        break;
+      *out = mmm::move(p->value);
+      destroy_node(p);
+    }
+    return n;
+  }
+  bool empty() const { return queue_.empty(); }
+
+private:
+  static void destroy_node(node *p) {
+    p->~node();
+    NodeAlloc::deallocate(p);
+  }
+}; // end of mpsc_queue
+
+} // namespace mmm
+
+#endif
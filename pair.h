@@ -18,6 +18,9 @@ namespace mmm {
 		T2 second;
 	public:
 		pair(){}
+		//声明了operator=, 拷贝/移动构造需显式默认, 否则移动退化为拷贝
+		pair(const pair&) = default;
+		pair(pair&&) = default;
 		template<class U, class V> pair(const pair<U, V>& pr);
 		pair(const first_type& a, const second_type& b);
 
@@ -12,6 +12,12 @@
 #include "allocator.h"
 #include "pair.h"
 #include <stddef.h>
+#include <type_traits>
+
+//比较函数自检(EASTL中仅调试时开启), 这里不做任何事
+#ifndef mmm_VALIDATE_COMPARE
+#define mmm_VALIDATE_COMPARE(expression)
+#endif
 
 namespace mmm {
 
@@ -29,10 +35,15 @@ public:
   char mColor;
 };
 
-template <typename Value> struct rbtree_node : public rbtree_node_base {
+template <typename Value, typename NodeBase = rbtree_node_base>
+struct rbtree_node : public NodeBase {
   Value mValue; 
 };
 
+//结点增强: 结构改变后由下往上调用, 用两个孩子重新计算结点上的附加信息(子树大小等).
+//旋转只改变两个结点的子树, RBTreeInsert/RBTreeErase先沿改动路径更新到根, 再做旋转.
+typedef void (*RBTreeAugmentFunc)(rbtree_node_base *pNode);
+
 rbtree_node_base *RBTreeIncrement(const rbtree_node_base *pNode);
 rbtree_node_base *RBTreeDecrement(const rbtree_node_base *pNode);
 rbtree_node_base *RBTreeGetMinChild(const rbtree_node_base *pNode);
@@ -40,10 +51,22 @@ rbtree_node_base *RBTreeGetMaxChild(const rbtree_node_base *pNode);
 size_t RBTreeGetBlackCount(const rbtree_node_base *pNodeTop,
                            const rbtree_node_base *pNodeBottom);
 void RBTreeInsert(rbtree_node_base *pNode, rbtree_node_base *pNodeParent,
-                  rbtree_node_base *pNodeAnchor, RBTreeSide insertionSide);
-void RBTreeErase(rbtree_node_base *pNode, rbtree_node_base *pNodeAnchor);
-rbtree_node_base* RBTreeRotateLeft(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot);
-rbtree_node_base* RBTreeRotateRight(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot);
+                  rbtree_node_base *pNodeAnchor, RBTreeSide insertionSide,
+                  RBTreeAugmentFunc pfnAugment = NULL);
+void RBTreeErase(rbtree_node_base *pNode, rbtree_node_base *pNodeAnchor,
+                 RBTreeAugmentFunc pfnAugment = NULL);
+rbtree_node_base* RBTreeRotateLeft(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot,
+                                   RBTreeAugmentFunc pfnAugment = NULL);
+rbtree_node_base* RBTreeRotateRight(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot,
+                                    RBTreeAugmentFunc pfnAugment = NULL);
+void RBTreeAugmentPath(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor,
+                       RBTreeAugmentFunc pfnAugment);
+void RBTreeInsertFixup(rbtree_node_base* pNode, rbtree_node_base*& pNodeRootRef,
+                       RBTreeAugmentFunc pfnAugment);
+rbtree_node_base* RBTreeJoin(rbtree_node_base* pNodeLeft, size_t nLeftHeight,
+                             rbtree_node_base* pNodePivot,
+                             rbtree_node_base* pNodeRight, size_t nRightHeight,
+                             size_t* pnHeight, RBTreeAugmentFunc pfnAugment = NULL);
 
 
 //-----------------------------红黑树操作实现---------------------------------
@@ -116,7 +139,7 @@ size_t RBTreeGetBlackCount(const rbtree_node_base* pNodeTop, const rbtree_node_b
 	return nCount;
 }
 
-rbtree_node_base* RBTreeRotateLeft(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot)
+rbtree_node_base* RBTreeRotateLeft(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot, RBTreeAugmentFunc pfnAugment)
 {
 	rbtree_node_base* const pNodeTemp = pNode->mpNodeRight;
 
@@ -136,10 +159,16 @@ rbtree_node_base* RBTreeRotateLeft(rbtree_node_base* pNode, rbtree_node_base* pN
 	pNodeTemp->mpNodeLeft = pNode;
 	pNode->mpNodeParent = pNodeTemp;
 
+	if(pfnAugment) // pNode现在是pNodeTemp的孩子, 先更新它
+	{
+		pfnAugment(pNode);
+		pfnAugment(pNodeTemp);
+	}
+
 	return pNodeRoot;
 }
 
-rbtree_node_base* RBTreeRotateRight(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot)
+rbtree_node_base* RBTreeRotateRight(rbtree_node_base* pNode, rbtree_node_base* pNodeRoot, RBTreeAugmentFunc pfnAugment)
 {
 	rbtree_node_base* const pNodeTemp = pNode->mpNodeLeft;
 
@@ -159,13 +188,30 @@ rbtree_node_base* RBTreeRotateRight(rbtree_node_base* pNode, rbtree_node_base* p
 	pNodeTemp->mpNodeRight = pNode;
 	pNode->mpNodeParent = pNodeTemp;
 
+	if(pfnAugment)
+	{
+		pfnAugment(pNode);
+		pfnAugment(pNodeTemp);
+	}
+
 	return pNodeRoot;
 }
 
+// 从pNode往上直到根, 逐个重新计算附加信息
+void RBTreeAugmentPath(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor, RBTreeAugmentFunc pfnAugment)
+{
+	if(pfnAugment)
+	{
+		for(; pNode != pNodeAnchor; pNode = pNode->mpNodeParent)
+			pfnAugment(pNode);
+	}
+}
+
 void RBTreeInsert(rbtree_node_base* pNode,
 							rbtree_node_base* pNodeParent, 
 							rbtree_node_base* pNodeAnchor,
-							RBTreeSide insertionSide)
+							RBTreeSide insertionSide,
+							RBTreeAugmentFunc pfnAugment)
 {
 	rbtree_node_base*& pNodeRootRef = pNodeAnchor->mpNodeParent;
 
@@ -196,7 +242,19 @@ void RBTreeInsert(rbtree_node_base* pNode,
 			pNodeAnchor->mpNodeRight = pNode; // Maintain rightmost pointing to max node
 	}
 
+	// 新结点到根这条路径上的附加信息都变了, 旋转之前先补上
+	RBTreeAugmentPath(pNode, pNodeAnchor, pfnAugment);
+
 	// Rebalance the tree.
+	RBTreeInsertFixup(pNode, pNodeRootRef, pfnAugment);
+	pNodeRootRef->mColor = kRBTreeColorBlack;
+
+} // RBTreeInsert
+
+
+// 红色的pNode刚挂上树, 向上消除连续的红结点. 最后根可能是红的, 由调用方染黑.
+void RBTreeInsertFixup(rbtree_node_base* pNode, rbtree_node_base*& pNodeRootRef, RBTreeAugmentFunc pfnAugment)
+{
 	while((pNode != pNodeRootRef) && (pNode->mpNodeParent->mColor == kRBTreeColorRed)) 
 	{
 
@@ -218,13 +276,13 @@ void RBTreeInsert(rbtree_node_base* pNode,
 				if(pNode->mpNodeParent && pNode == pNode->mpNodeParent->mpNodeRight) 
 				{
 					pNode = pNode->mpNodeParent;
-					pNodeRootRef = RBTreeRotateLeft(pNode, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateLeft(pNode, pNodeRootRef, pfnAugment);
 				}
 
 
 				pNode->mpNodeParent->mColor = kRBTreeColorBlack;
 				pNodeParentParent->mColor = kRBTreeColorRed;
-				pNodeRootRef = RBTreeRotateRight(pNodeParentParent, pNodeRootRef);
+				pNodeRootRef = RBTreeRotateRight(pNodeParentParent, pNodeRootRef, pfnAugment);
 			}
 		}
 		else 
@@ -245,22 +303,114 @@ void RBTreeInsert(rbtree_node_base* pNode,
 				if(pNode == pNode->mpNodeParent->mpNodeLeft) 
 				{
 					pNode = pNode->mpNodeParent;
-					pNodeRootRef = RBTreeRotateRight(pNode, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateRight(pNode, pNodeRootRef, pfnAugment);
 				}
 
 				pNode->mpNodeParent->mColor = kRBTreeColorBlack;
 				pNodeParentParent->mColor = kRBTreeColorRed;
-				pNodeRootRef = RBTreeRotateLeft(pNodeParentParent, pNodeRootRef);
+				pNodeRootRef = RBTreeRotateLeft(pNodeParentParent, pNodeRootRef, pfnAugment);
 			}
 		}
 	}
+}
 
-	pNodeRootRef->mColor = kRBTreeColorBlack;
 
-} // RBTreeInsert
+// 以pNodePivot为中间结点连接两棵红黑树(左树的key都不大于pivot, 右树都不小于pivot).
+// 两棵树的根不必是黑色, parent也不用管. nLeftHeight/nRightHeight是黑高(空树为0).
+// 黑高较大的一侧沿边缘往下找到黑高相等的黑结点, 在那里挂上红色的pivot, 再按插入修正.
+// 返回新根(黑色, parent为NULL), *pnHeight为新的黑高. O(|nLeftHeight - nRightHeight| + 1).
+rbtree_node_base* RBTreeJoin(rbtree_node_base* pNodeLeft, size_t nLeftHeight,
+							 rbtree_node_base* pNodePivot,
+							 rbtree_node_base* pNodeRight, size_t nRightHeight,
+							 size_t* pnHeight, RBTreeAugmentFunc pfnAugment)
+{
+	if(pNodeLeft)
+	{
+		pNodeLeft->mpNodeParent = NULL;
+		if(pNodeLeft->mColor == kRBTreeColorRed)
+		{
+			pNodeLeft->mColor = kRBTreeColorBlack;
+			++nLeftHeight;
+		}
+	}
+	if(pNodeRight)
+	{
+		pNodeRight->mpNodeParent = NULL;
+		if(pNodeRight->mColor == kRBTreeColorRed)
+		{
+			pNodeRight->mColor = kRBTreeColorBlack;
+			++nRightHeight;
+		}
+	}
+
+	if(nLeftHeight == nRightHeight)
+	{
+		pNodePivot->mpNodeLeft   = pNodeLeft;
+		pNodePivot->mpNodeRight  = pNodeRight;
+		pNodePivot->mpNodeParent = NULL;
+		pNodePivot->mColor       = kRBTreeColorBlack;
+		if(pNodeLeft)
+			pNodeLeft->mpNodeParent = pNodePivot;
+		if(pNodeRight)
+			pNodeRight->mpNodeParent = pNodePivot;
+		if(pfnAugment)
+			pfnAugment(pNodePivot);
+
+		*pnHeight = nLeftHeight + 1;
+		return pNodePivot;
+	}
+
+	const bool        bLeftTaller = (nLeftHeight > nRightHeight);
+	const size_t      nHeight     = bLeftTaller ? nRightHeight : nLeftHeight;
+	rbtree_node_base* pNodeRoot   = bLeftTaller ? pNodeLeft : pNodeRight;
+	rbtree_node_base* pNodeParent = NULL;
+	rbtree_node_base* pNode       = pNodeRoot;
+	size_t            nNodeHeight = bLeftTaller ? nLeftHeight : nRightHeight;
+
+	// 高树的右(左)边缘上找黑高为nHeight的黑结点(或空位)
+	while((nNodeHeight > nHeight) || (pNode && (pNode->mColor == kRBTreeColorRed)))
+	{
+		if(pNode->mColor == kRBTreeColorBlack)
+			--nNodeHeight;
+		pNodeParent = pNode;
+		pNode = bLeftTaller ? pNode->mpNodeRight : pNode->mpNodeLeft;
+	}
+
+	pNodePivot->mpNodeParent = pNodeParent;
+	pNodePivot->mColor       = kRBTreeColorRed;
+	if(bLeftTaller)
+	{
+		pNodeParent->mpNodeRight = pNodePivot;
+		pNodePivot->mpNodeLeft   = pNode;
+		pNodePivot->mpNodeRight  = pNodeRight;
+		if(pNodeRight)
+			pNodeRight->mpNodeParent = pNodePivot;
+	}
+	else
+	{
+		pNodeParent->mpNodeLeft  = pNodePivot;
+		pNodePivot->mpNodeRight  = pNode;
+		pNodePivot->mpNodeLeft   = pNodeLeft;
+		if(pNodeLeft)
+			pNodeLeft->mpNodeParent = pNodePivot;
+	}
+	if(pNode)
+		pNode->mpNodeParent = pNodePivot;
+
+	RBTreeAugmentPath(pNodePivot, NULL, pfnAugment);
+	RBTreeInsertFixup(pNodePivot, pNodeRoot, pfnAugment);
+
+	*pnHeight = bLeftTaller ? nLeftHeight : nRightHeight;
+	if(pNodeRoot->mColor == kRBTreeColorRed) // 修正一直传到根, 根染黑后黑高加一
+	{
+		pNodeRoot->mColor = kRBTreeColorBlack;
+		++*pnHeight;
+	}
+	return pNodeRoot;
+}
 
 
-void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
+void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor, RBTreeAugmentFunc pfnAugment)
 {
 	rbtree_node_base*& pNodeRootRef      = pNodeAnchor->mpNodeParent;
 	rbtree_node_base*& pNodeLeftmostRef  = pNodeAnchor->mpNodeLeft;
@@ -364,6 +514,10 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 		mmm::swap(pNodeSuccessor->mColor, pNode->mColor);
 	}
 
+	// pNode摘下后, 从pNodeChildParent到根的附加信息都变了
+	if(pNodeChildParent)
+		RBTreeAugmentPath(pNodeChildParent, pNodeAnchor, pfnAugment);
+
 	// Here we do tree balancing as per the conventional red-black tree algorithm.
 	if(pNode->mColor == kRBTreeColorBlack) 
 	{ 
@@ -377,7 +531,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 				{
 					pNodeTemp->mColor = kRBTreeColorBlack;
 					pNodeChildParent->mColor = kRBTreeColorRed;
-					pNodeRootRef = RBTreeRotateLeft(pNodeChildParent, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateLeft(pNodeChildParent, pNodeRootRef, pfnAugment);
 					pNodeTemp = pNodeChildParent->mpNodeRight;
 				}
 
@@ -394,7 +548,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 					{
 						pNodeTemp->mpNodeLeft->mColor = kRBTreeColorBlack;
 						pNodeTemp->mColor = kRBTreeColorRed;
-						pNodeRootRef = RBTreeRotateRight(pNodeTemp, pNodeRootRef);
+						pNodeRootRef = RBTreeRotateRight(pNodeTemp, pNodeRootRef, pfnAugment);
 						pNodeTemp = pNodeChildParent->mpNodeRight;
 					}
 
@@ -404,7 +558,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 					if(pNodeTemp->mpNodeRight) 
 						pNodeTemp->mpNodeRight->mColor = kRBTreeColorBlack;
 
-					pNodeRootRef = RBTreeRotateLeft(pNodeChildParent, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateLeft(pNodeChildParent, pNodeRootRef, pfnAugment);
 					break;
 				}
 			} 
@@ -418,7 +572,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 					pNodeTemp->mColor        = kRBTreeColorBlack;
 					pNodeChildParent->mColor = kRBTreeColorRed;
 
-					pNodeRootRef = RBTreeRotateRight(pNodeChildParent, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateRight(pNodeChildParent, pNodeRootRef, pfnAugment);
 					pNodeTemp = pNodeChildParent->mpNodeLeft;
 				}
 
@@ -436,7 +590,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 						pNodeTemp->mpNodeRight->mColor = kRBTreeColorBlack;
 						pNodeTemp->mColor              = kRBTreeColorRed;
 
-						pNodeRootRef = RBTreeRotateLeft(pNodeTemp, pNodeRootRef);
+						pNodeRootRef = RBTreeRotateLeft(pNodeTemp, pNodeRootRef, pfnAugment);
 						pNodeTemp = pNodeChildParent->mpNodeLeft;
 					}
 
@@ -446,7 +600,7 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 					if(pNodeTemp->mpNodeLeft) 
 						pNodeTemp->mpNodeLeft->mColor = kRBTreeColorBlack;
 
-					pNodeRootRef = RBTreeRotateRight(pNodeChildParent, pNodeRootRef);
+					pNodeRootRef = RBTreeRotateRight(pNodeChildParent, pNodeRootRef, pfnAugment);
 					break;
 				}
 			}
@@ -459,18 +613,69 @@ void RBTreeErase(rbtree_node_base* pNode, rbtree_node_base* pNodeAnchor)
 } // RBTreeErase
 
 
+//===================================================结点增强=======================================================
+
+//rbtree的最后一个模板参数. node_base_type是结点的基类(附加信息放在这里),
+//get_update<Node>()给出RBTreeAugmentFunc, 返回NULL表示不做增强.
+//has_subtree_size表示能否O(1)取得子树大小(size(pNode)).
+struct rbtree_no_augment {
+  typedef rbtree_node_base node_base_type;
+  typedef false_type has_subtree_size;
+
+  template <typename Node> static RBTreeAugmentFunc get_update() {
+    return NULL;
+  }
+};
+
+struct rbtree_size_node_base : public rbtree_node_base {
+  size_t mnSubtreeSize; //以该结点为根的子树的结点数
+};
+
+//顺序统计: 每个结点记录子树大小, rbtree借此提供O(log n)的nth/rank/count_range.
+struct rbtree_order_statistics {
+  typedef rbtree_size_node_base node_base_type;
+  typedef true_type has_subtree_size;
+
+  static size_t size(const rbtree_node_base *pNode) {
+    return pNode ? static_cast<const rbtree_size_node_base *>(pNode)->mnSubtreeSize
+                 : 0;
+  }
+  static void update(rbtree_node_base *pNode) {
+    static_cast<rbtree_size_node_base *>(pNode)->mnSubtreeSize =
+        1 + size(pNode->mpNodeLeft) + size(pNode->mpNodeRight);
+  }
+  template <typename Node> static RBTreeAugmentFunc get_update() {
+    return &update;
+  }
+};
+
+//异构查找: Compare带is_transparent(如mmm::less<>)时, find/count/lower_bound/upper_bound/
+//equal_range/erase才有接受任意类型U的版本, 免得为查找先构造一个key_type临时对象.
+//bEnable留给调用处排除别的重载, 比如能转成迭代器的U应当走erase(const_iterator).
+template <typename Compare, typename U, typename Result, bool bEnable = true,
+          typename = void>
+struct rbtree_enable_if_transparent {};
+
+template <typename Compare, typename U, typename Result>
+struct rbtree_enable_if_transparent<Compare, U, Result, true,
+                                    std::void_t<typename Compare::is_transparent>> {
+  typedef Result type;
+};
+
+
 //===================================================迭代器=======================================================
 
-template <typename T, typename Pointer, typename Reference>
+template <typename T, typename Pointer, typename Reference,
+          typename NodeBase = rbtree_node_base>
 struct rbtree_iterator {
-  typedef rbtree_iterator<T, Pointer, Reference> this_type;
-  typedef rbtree_iterator<T, T *, T &> iterator;
-  typedef rbtree_iterator<T, const T *, const T &> const_iterator;
+  typedef rbtree_iterator<T, Pointer, Reference, NodeBase> this_type;
+  typedef rbtree_iterator<T, T *, T &, NodeBase> iterator;
+  typedef rbtree_iterator<T, const T *, const T &, NodeBase> const_iterator;
   typedef size_t size_type;
   typedef ptrdiff_t difference_type;
   typedef T value_type;
   typedef rbtree_node_base base_node_type;
-  typedef rbtree_node<T> node_type;
+  typedef rbtree_node<T, NodeBase> node_type;
   typedef Pointer pointer;
   typedef Reference reference;
   typedef mmm::bidirectional_iterator_tag iterator_category;
@@ -574,28 +779,34 @@ public:
 /// bMutableIterators (bool): true if rbtree::iterator is a mutable
 /// iterator, false if iterator and const_iterator are both const iterators. 
 /// It will be true for map and multimap and false for set and multiset.
+///
+/// Augment: 结点增强策略, 默认rbtree_no_augment. 取rbtree_order_statistics时
+/// 结点多存一个子树大小, 可用nth/rank/count_range.
 
 template <typename Key, typename Value, typename Compare, typename Allocator, 
-			typename ExtractKey, bool bMutableIterators, bool bUniqueKeys>
+			typename ExtractKey, bool bMutableIterators, bool bUniqueKeys,
+			typename Augment = rbtree_no_augment>
 class rbtree
 	: public rb_base<Key, Value, Compare, ExtractKey, bUniqueKeys, 
-						rbtree<Key, Value, Compare, Allocator, ExtractKey, bMutableIterators, bUniqueKeys> >
+						rbtree<Key, Value, Compare, Allocator, ExtractKey, bMutableIterators, bUniqueKeys, Augment> >
 {
 public:
 	typedef ptrdiff_t                                                                       difference_type;
 	typedef size_t                                                                          size_type;
 	typedef Key                                                                             key_type;
 	typedef Value                                                                           value_type;
-	typedef rbtree_node<value_type>                                                         node_type;
+	typedef Augment                                                                         augment_type;
+	typedef typename Augment::node_base_type                                                node_base_type;
+	typedef rbtree_node<value_type, node_base_type>                                         node_type;
 	typedef value_type&                                                                     reference;
 	typedef const value_type&                                                               const_reference;
 	typedef value_type*                                                                     pointer;
 	typedef const value_type*                                                               const_pointer;
 
 	typedef typename type_select<bMutableIterators, 
-				rbtree_iterator<value_type, value_type*, value_type&>, 
-				rbtree_iterator<value_type, const value_type*, const value_type&> >::type   iterator;
-	typedef rbtree_iterator<value_type, const value_type*, const value_type&>               const_iterator;
+				rbtree_iterator<value_type, value_type*, value_type&, node_base_type>, 
+				rbtree_iterator<value_type, const value_type*, const value_type&, node_base_type> >::type   iterator;
+	typedef rbtree_iterator<value_type, const value_type*, const value_type&, node_base_type> const_iterator;
 	typedef mmm::reverse_iterator<iterator>                                               reverse_iterator;
 	typedef mmm::reverse_iterator<const_iterator>                                         const_reverse_iterator;
 
@@ -603,7 +814,7 @@ public:
 	typedef Compare                                                                         key_compare;
 	typedef typename type_select<bUniqueKeys, mmm::pair<iterator, bool>, iterator>::type    insert_return_type;  // map/set::insert return a pair, multimap/multiset::iterator return an iterator.
 	typedef rbtree<Key, Value, Compare, Allocator, 
-					ExtractKey, bMutableIterators, bUniqueKeys>                             this_type;
+					ExtractKey, bMutableIterators, bUniqueKeys, Augment>                    this_type;
 	typedef rb_base<Key, Value, Compare, ExtractKey, bUniqueKeys, this_type>                base_type;
 	typedef integral_constant<bool, bUniqueKeys>                                            has_unique_keys_type;
 	typedef typename base_type::extract_key                                                 extract_key;
@@ -627,6 +838,10 @@ public:
 	template <typename InputIterator>
 	rbtree(InputIterator first, InputIterator last, const Compare& compare, const allocator_type& allocator = allocator_type());
 
+	/// 调用方保证[first, last)已按compare有序(唯一键时无重复), 直接O(n)建树.
+	template <typename InputIterator>
+	rbtree(sorted_unique_t, InputIterator first, InputIterator last, const Compare& compare, const allocator_type& allocator = allocator_type());
+
 	~rbtree(){DoNukeSubtree((node_type*)mAnchor.mpNodeParent);}
 
 public:
@@ -644,6 +859,12 @@ public:
 
 	void swap(this_type& x);
 
+	/// 清空后用[first, last)重建. 输入有序时(或带sorted_unique标记)为O(n).
+	template <typename InputIterator>
+	void assign(InputIterator first, InputIterator last);
+	template <typename InputIterator>
+	void assign(sorted_unique_t, InputIterator first, InputIterator last);
+
 public: 
 	// iterators
 	iterator        begin() noexcept 		{ return iterator(static_cast<node_type*>(mAnchor.mpNodeLeft)); }
@@ -806,9 +1027,88 @@ public:
 	iterator       upper_bound(const key_type& key);
 	const_iterator upper_bound(const key_type& key) const;
 
+	/// 异构查找, 仅当Compare带is_transparent时存在(见rbtree_enable_if_transparent).
+	/// 比较器可能把好几个key都看作与u等价, 所以count/erase按整个等价区间处理.
+	///     map<string, int, less<>> m;
+	///     m.find("hello"); // 不构造string
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, iterator>::type
+	find(const U& u) { return find_as(u, mCompare); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, const_iterator>::type
+	find(const U& u) const { return find_as(u, mCompare); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, iterator>::type
+	lower_bound(const U& u) { return DoLowerBound(u); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, const_iterator>::type
+	lower_bound(const U& u) const { return const_iterator(const_cast<this_type*>(this)->DoLowerBound(u)); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, iterator>::type
+	upper_bound(const U& u) { return DoUpperBound(u); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, const_iterator>::type
+	upper_bound(const U& u) const { return const_iterator(const_cast<this_type*>(this)->DoUpperBound(u)); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, mmm::pair<iterator, iterator> >::type
+	equal_range(const U& u) { return mmm::pair<iterator, iterator>(DoLowerBound(u), DoUpperBound(u)); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, mmm::pair<const_iterator, const_iterator> >::type
+	equal_range(const U& u) const { return mmm::pair<const_iterator, const_iterator>(lower_bound(u), upper_bound(u)); }
+
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, size_type>::type
+	count(const U& u) const { return (size_type)mmm::distance(lower_bound(u), upper_bound(u)); }
+
+	// 能转成迭代器的U仍走erase(const_iterator)
+	template <typename U>
+	typename rbtree_enable_if_transparent<Compare, U, size_type,
+		!std::is_convertible<U, const_iterator>::value && !std::is_convertible<U, const_reverse_iterator>::value>::type
+	erase(const U& u);
+
+	/// 以下要求Augment为rbtree_order_statistics, 均为O(log n).
+	/// nth(k): 第k小(从0数)的元素, k >= size()时返回end().
+	/// rank(key): 小于key的元素个数, 即lower_bound(key)的下标.
+	/// count_range(lo, hi): key落在[lo, hi)内的元素个数.
+	iterator       nth(size_type k);
+	const_iterator nth(size_type k) const;
+	size_type      rank(const key_type& key) const;
+	size_type      count_range(const key_type& lo, const key_type& hi) const;
+
+	/// 把x整体接到末尾, 要求x的key都不小于自身的key(唯一键时大于). O(log n), x变空.
+	void join(this_type& x);
+	/// 不小于key的元素移入x(x原有内容先清掉), 自身留下小于key的. 结构调整O(log n);
+	/// 不带子树大小时还要数一遍较小的一侧来维护size().
+	void split(const key_type& key, this_type& x);
+
+	/// 集合运算, 结果留在自身. 语义同std::set_union/set_intersection/set_difference,
+	/// 多重键按个数取max/min/差, 键相等时保留自身的元素.
+	/// 规模相近时把自身摊成有序链与x线性归并, 再O(n)重建; 规模悬殊时,
+	/// 唯一键的并走split/join分治, 交/差只对小的一侧逐个查找.
+	void unite(const this_type& x);
+	void intersect(const this_type& x);
+	void subtract(const this_type& x);
+
 	bool validate() const;
 
 protected:
+	// 结点按allocator_type::value_type为单位分配, 带增强的结点可能比它大
+	static const size_type kNodeAllocCount =
+		(sizeof(node_type) + sizeof(typename allocator_type::value_type) - 1) / sizeof(typename allocator_type::value_type);
+
+	static RBTreeAugmentFunc DoGetAugment() { return Augment::template get_update<node_type>(); }
+
+	// lower_bound/upper_bound的树上查找, key_type与异构版本共用
+	template <typename U> iterator DoLowerBound(const U& u);
+	template <typename U> iterator DoUpperBound(const U& u);
+
 	node_type* DoAllocateNode();
 	void       DoFreeNode(node_type* pNode);
 
@@ -822,6 +1122,29 @@ protected:
 
 	node_type* DoCopySubtree(const node_type* pNodeSource, node_type* pNodeDest);
 	void       DoNukeSubtree(node_type* pNode);
+	void       DoFreeChain(rbtree_node_base* pChain);
+
+	template <typename InputIterator>
+	void       DoInsertRange(InputIterator first, InputIterator last, bool bKnownSorted);
+	node_type* DoBuildBalanced(rbtree_node_base*& pChain, size_type n, size_type nDepth, size_type nFullLevels);
+	void       DoBuildFromChain(rbtree_node_base* pChain, size_type n);
+	void       DoAttachRoot(rbtree_node_base* pNodeRoot, size_type n);
+
+	static const size_type kSetAlgebraRatio = 8; // 两边规模相差这么多倍以上算悬殊
+
+	static size_type         DoBlackHeight(const rbtree_node_base* pNode);
+	static rbtree_node_base* DoFlatten(rbtree_node_base* pNode, rbtree_node_base* pChain);
+	static size_type         DoCountLeft(const rbtree_node_base* pNodeLeft, const rbtree_node_base* pNodeRight, size_type n, true_type);
+	static size_type         DoCountLeft(const rbtree_node_base* pNodeLeft, const rbtree_node_base* pNodeRight, size_type n, false_type);
+	void                     DoSplit(rbtree_node_base* pNode, size_type nHeight, const key_type& key,
+									 rbtree_node_base*& pNodeLeft, size_type& nLeftHeight,
+									 rbtree_node_base*& pNodeRight, size_type& nRightHeight,
+									 rbtree_node_base** ppNodeEqual);
+	rbtree_node_base*        DoUnion(rbtree_node_base* pNode1, size_type nHeight1,
+									 rbtree_node_base* pNode2, size_type nHeight2,
+									 size_type& nHeight, size_type& nDuplicates);
+	void       DoInsertNode(true_type, node_type* pNode);
+	void       DoInsertNode(false_type, node_type* pNode);
 
 	template <class... Args>
 	mmm::pair<iterator, bool> DoInsertValue(true_type, Args&&... args);
@@ -878,17 +1201,17 @@ inline rbtree_node_base* RBTreeGetMaxChild(const rbtree_node_base* pNodeBase)
 // The C++ defect report #179 requires that we support comparisons between const and non-const iterators.
 // Thus we provide additional template paremeters here to support this. The defect report does not
 // require us to support comparisons between reverse_iterators and const_reverse_iterators.
-template <typename T, typename PointerA, typename ReferenceA, typename PointerB, typename ReferenceB>
-inline bool operator==(const rbtree_iterator<T, PointerA, ReferenceA>& a, 
-						const rbtree_iterator<T, PointerB, ReferenceB>& b)
+template <typename T, typename PointerA, typename ReferenceA, typename PointerB, typename ReferenceB, typename N>
+inline bool operator==(const rbtree_iterator<T, PointerA, ReferenceA, N>& a, 
+						const rbtree_iterator<T, PointerB, ReferenceB, N>& b)
 {
 	return a.mpNode == b.mpNode;
 }
 
 
-template <typename T, typename PointerA, typename ReferenceA, typename PointerB, typename ReferenceB>
-inline bool operator!=(const rbtree_iterator<T, PointerA, ReferenceA>& a, 
-						const rbtree_iterator<T, PointerB, ReferenceB>& b)
+template <typename T, typename PointerA, typename ReferenceA, typename PointerB, typename ReferenceB, typename N>
+inline bool operator!=(const rbtree_iterator<T, PointerA, ReferenceA, N>& a, 
+						const rbtree_iterator<T, PointerB, ReferenceB, N>& b)
 {
 	return a.mpNode != b.mpNode;
 }
@@ -896,9 +1219,9 @@ inline bool operator!=(const rbtree_iterator<T, PointerA, ReferenceA>& a,
 
 // We provide a version of operator!= for the case where the iterators are of the 
 // same type. This helps prevent ambiguity errors in the presence of rel_ops.
-template <typename T, typename Pointer, typename Reference>
-inline bool operator!=(const rbtree_iterator<T, Pointer, Reference>& a, 
-						const rbtree_iterator<T, Pointer, Reference>& b)
+template <typename T, typename Pointer, typename Reference, typename N>
+inline bool operator!=(const rbtree_iterator<T, Pointer, Reference, N>& a, 
+						const rbtree_iterator<T, Pointer, Reference, N>& b)
 {
 	return a.mpNode != b.mpNode;
 }
@@ -910,8 +1233,8 @@ inline bool operator!=(const rbtree_iterator<T, Pointer, Reference>& a,
 // rbtree functions
 ///////////////////////////////////////////////////////////////////////
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree()
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree()
 	: mAnchor(),
 		mnSize(0),
 		mAllocator()
@@ -920,8 +1243,8 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree()
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const allocator_type& allocator)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(const allocator_type& allocator)
 	: mAnchor(),
 		mnSize(0),
 		mAllocator(allocator)
@@ -930,8 +1253,8 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const allocator_type& allocator)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const C& compare, const allocator_type& allocator)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(const C& compare, const allocator_type& allocator)
 	: base_type(compare),
 		mAnchor(),
 		mnSize(0),
@@ -941,8 +1264,8 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const C& compare, const allocator_t
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const this_type& x)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(const this_type& x)
 	: base_type(x.mCompare),
 		mAnchor(),
 		mnSize(0),
@@ -960,8 +1283,8 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree(const this_type& x)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(this_type&& x)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(this_type&& x)
 	: base_type(x.mCompare),
 		mAnchor(),
 		mnSize(0),
@@ -971,8 +1294,8 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree(this_type&& x)
 	swap(x);
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(this_type&& x, const allocator_type& allocator)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(this_type&& x, const allocator_type& allocator)
 	: base_type(x.mCompare),
 		mAnchor(),
 		mnSize(0),
@@ -983,23 +1306,35 @@ inline rbtree<K, V, C, A, E, bM, bU>::rbtree(this_type&& x, const allocator_type
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename InputIterator>
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(InputIterator first, InputIterator last, const C& compare, const allocator_type& allocator)
+	: base_type(compare),
+		mAnchor(),
+		mnSize(0),
+		mAllocator(allocator)
+{
+	reset_lose_memory();
+	DoInsertRange(first, last, false);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <typename InputIterator>
-inline rbtree<K, V, C, A, E, bM, bU>::rbtree(InputIterator first, InputIterator last, const C& compare, const allocator_type& allocator)
+inline rbtree<K, V, C, A, E, bM, bU, G>::rbtree(sorted_unique_t, InputIterator first, InputIterator last, const C& compare, const allocator_type& allocator)
 	: base_type(compare),
 		mAnchor(),
 		mnSize(0),
 		mAllocator(allocator)
 {
 	reset_lose_memory();
-	for(; first != last; ++first)
-		insert(*first);
+	DoInsertRange(first, last, true);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::this_type&
-rbtree<K, V, C, A, E, bM, bU>::operator=(const this_type& x)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::this_type&
+rbtree<K, V, C, A, E, bM, bU, G>::operator=(const this_type& x)
 {
 	if(this != &x)
 	{
@@ -1018,9 +1353,9 @@ rbtree<K, V, C, A, E, bM, bU>::operator=(const this_type& x)
 	return *this;
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::this_type&
-rbtree<K, V, C, A, E, bM, bU>::operator=(this_type&& x)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::this_type&
+rbtree<K, V, C, A, E, bM, bU, G>::operator=(this_type&& x)
 {
 	if(this != &x)
 	{
@@ -1030,23 +1365,38 @@ rbtree<K, V, C, A, E, bM, bU>::operator=(this_type&& x)
 	return *this; 
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::this_type&
-rbtree<K, V, C, A, E, bM, bU>::operator=(std::initializer_list<value_type> ilist)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::this_type&
+rbtree<K, V, C, A, E, bM, bU, G>::operator=(std::initializer_list<value_type> ilist)
 {
 	// The simplest means of doing this is to clear and insert. There probably isn't a generic
 	// solution that's any more efficient without having prior knowledge of the ilist contents.
 	clear();
+	DoInsertRange(ilist.begin(), ilist.end(), false);
+	return *this;
+}
 
-	for(typename std::initializer_list<value_type>::iterator it = ilist.begin(), itEnd = ilist.end(); it != itEnd; ++it)
-		DoInsertValue(has_unique_keys_type(), mmm::move(*it));
 
-	return *this;
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename InputIterator>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::assign(InputIterator first, InputIterator last)
+{
+	clear();
+	DoInsertRange(first, last, false);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename InputIterator>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::assign(sorted_unique_t, InputIterator first, InputIterator last)
+{
+	clear();
+	DoInsertRange(first, last, true);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-void rbtree<K, V, C, A, E, bM, bU>::swap(this_type& x)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::swap(this_type& x)
 {
 	if(mAllocator == x.mAllocator) // If allocators are equivalent...
 	{
@@ -1106,10 +1456,10 @@ void rbtree<K, V, C, A, E, bM, bU>::swap(this_type& x)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class M>
-mmm::pair<typename rbtree<K, V, C, A, E, bM, bU>::iterator, bool>
-rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const key_type& k, M&& obj)
+mmm::pair<typename rbtree<K, V, C, A, E, bM, bU, G>::iterator, bool>
+rbtree<K, V, C, A, E, bM, bU, G>::insert_or_assign(const key_type& k, M&& obj)
 {
 	auto iter = find(k);
 
@@ -1124,10 +1474,10 @@ rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const key_type& k, M&& obj)
 	}
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class M>
-mmm::pair<typename rbtree<K, V, C, A, E, bM, bU>::iterator, bool>
-rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(key_type&& k, M&& obj)
+mmm::pair<typename rbtree<K, V, C, A, E, bM, bU, G>::iterator, bool>
+rbtree<K, V, C, A, E, bM, bU, G>::insert_or_assign(key_type&& k, M&& obj)
 {
 	auto iter = find(k);
 
@@ -1142,10 +1492,10 @@ rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(key_type&& k, M&& obj)
 	}
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class M>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const_iterator hint, const key_type& k, M&& obj)
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::insert_or_assign(const_iterator hint, const key_type& k, M&& obj)
 {
 	auto iter = find(k);
 
@@ -1160,10 +1510,10 @@ rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const_iterator hint, const key_t
 	}
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class M>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const_iterator hint, key_type&& k, M&& obj)
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::insert_or_assign(const_iterator hint, key_type&& k, M&& obj)
 {
 	auto iter = find(k);
 
@@ -1178,9 +1528,9 @@ rbtree<K, V, C, A, E, bM, bU>::insert_or_assign(const_iterator hint, key_type&&
 	}
 }
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionUniqueKeys(bool& canInsert, const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoGetKeyInsertionPositionUniqueKeys(bool& canInsert, const key_type& key)
 {
 	// This code is essentially a slightly modified copy of the the rbtree::insert 
 	// function whereby this version takes a key and not a full value_type.
@@ -1238,9 +1588,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionUniqueKeys(bool& canInse
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionNonuniqueKeys(const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoGetKeyInsertionPositionNonuniqueKeys(const key_type& key)
 {
 	// This is the pathway for insertion of non-unique keys (multimap and multiset, but not map and set).
 	node_type* pCurrent  = (node_type*)mAnchor.mpNodeParent; // Start with the root node.
@@ -1264,9 +1614,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionNonuniqueKeys(const key_
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-mmm::pair<typename rbtree<K, V, C, A, E, bM, bU>::iterator, bool> 
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(true_type, value_type&& value)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+mmm::pair<typename rbtree<K, V, C, A, E, bM, bU, G>::iterator, bool> 
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValue(true_type, value_type&& value)
 {
 	extract_key extractKey;
 	key_type    key(extractKey(value));
@@ -1283,9 +1633,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(true_type, value_type&& value)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator 
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(false_type, value_type&& value)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator 
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValue(false_type, value_type&& value)
 {
 	extract_key extractKey;
 	key_type    key(extractKey(value));
@@ -1295,10 +1645,10 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(false_type, value_type&& value)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class... Args>
-mmm::pair<typename rbtree<K, V, C, A, E, bM, bU>::iterator, bool>
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(true_type, Args&&... args) // true_type means keys are unique.
+mmm::pair<typename rbtree<K, V, C, A, E, bM, bU, G>::iterator, bool>
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValue(true_type, Args&&... args) // true_type means keys are unique.
 {
 	// This is the pathway for insertion of unique keys (map and set, but not multimap and multiset).
 	// Note that we return a pair and not an iterator. This is because the C++ standard for map
@@ -1321,10 +1671,10 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(true_type, Args&&... args) // true_
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class... Args>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(false_type, Args&&... args) // false_type means keys are not unique.
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValue(false_type, Args&&... args) // false_type means keys are not unique.
 {
 	// We have a problem here if sizeof(value_type) is too big for the stack. We may want to consider having a specialization for large value_types.
 	// To do: Change this so that we call DoCreateNode(mmm::forward<Args>(args)...) here and use the value from the resulting pNode to get the 
@@ -1339,10 +1689,10 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValue(false_type, Args&&... args) // fals
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <class... Args>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValueImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key, Args&&... args)
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValueImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key, Args&&... args)
 {
 	node_type* const pNodeNew = DoCreateNode(mmm::forward<Args>(args)...); // Note that pNodeNew->mpLeft, mpRight, mpParent, will be uninitialized.
 
@@ -1350,9 +1700,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValueImpl(node_type* pNodeParent, bool bF
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValueImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key, node_type* pNodeNew)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValueImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key, node_type* pNodeNew)
 {
 
 	RBTreeSide  side;
@@ -1366,16 +1716,16 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValueImpl(node_type* pNodeParent, bool bF
 	else
 		side = kRBTreeSideRight;
 
-	RBTreeInsert(pNodeNew, pNodeParent, &mAnchor, side);
+	RBTreeInsert(pNodeNew, pNodeParent, &mAnchor, side, DoGetAugment());
 	mnSize++;
 
 	return iterator(pNodeNew);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-mmm::pair<typename rbtree<K, V, C, A, E, bM, bU>::iterator, bool>
-rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(true_type, const key_type& key) // true_type means keys are unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+mmm::pair<typename rbtree<K, V, C, A, E, bM, bU, G>::iterator, bool>
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertKey(true_type, const key_type& key) // true_type means keys are unique.
 {
 	// This is the pathway for insertion of unique keys (map and set, but not multimap and multiset).
 	// Note that we return a pair and not an iterator. This is because the C++ standard for map
@@ -1393,9 +1743,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(true_type, const key_type& key) // tr
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(false_type, const key_type& key) // false_type means keys are not unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertKey(false_type, const key_type& key) // false_type means keys are not unique.
 {
 	node_type* pPosition = DoGetKeyInsertionPositionNonuniqueKeys(key);
 
@@ -1404,9 +1754,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(false_type, const key_type& key) // f
 
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionUniqueKeysHint(const_iterator position, bool& bForceToLeft, const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoGetKeyInsertionPositionUniqueKeysHint(const_iterator position, bool& bForceToLeft, const key_type& key)
 {
 	extract_key extractKey;
 
@@ -1452,9 +1802,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionUniqueKeysHint(const_ite
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionNonuniqueKeysHint(const_iterator position, bool& bForceToLeft, const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoGetKeyInsertionPositionNonuniqueKeysHint(const_iterator position, bool& bForceToLeft, const key_type& key)
 {
 	extract_key extractKey;
 
@@ -1496,9 +1846,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoGetKeyInsertionPositionNonuniqueKeysHint(const_
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValueHint(true_type, const_iterator position, const value_type& value) // true_type means keys are unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValueHint(true_type, const_iterator position, const value_type& value) // true_type means keys are unique.
 {
 	// This is the pathway for insertion of unique keys (map and set, but not multimap and multiset).
 	//
@@ -1517,9 +1867,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValueHint(true_type, const_iterator posit
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertValueHint(false_type, const_iterator position, const value_type& value) // false_type means keys are not unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertValueHint(false_type, const_iterator position, const value_type& value) // false_type means keys are not unique.
 {
 	// This is the pathway for insertion of non-unique keys (multimap and multiset, but not map and set).
 	//
@@ -1537,9 +1887,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertValueHint(false_type, const_iterator posi
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(true_type, const_iterator position, const key_type& key) // true_type means keys are unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertKey(true_type, const_iterator position, const key_type& key) // true_type means keys are unique.
 {
 	bool       bForceToLeft;
 	node_type* pPosition = DoGetKeyInsertionPositionUniqueKeysHint(position, bForceToLeft, key);
@@ -1551,9 +1901,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(true_type, const_iterator position, c
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(false_type, const_iterator position, const key_type& key) // false_type means keys are not unique.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertKey(false_type, const_iterator position, const key_type& key) // false_type means keys are not unique.
 {
 	// This is the pathway for insertion of non-unique keys (multimap and multiset, but not map and set).
 	//
@@ -1569,9 +1919,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertKey(false_type, const_iterator position,
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::DoInsertKeyImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoInsertKeyImpl(node_type* pNodeParent, bool bForceToLeft, const key_type& key)
 {
 	RBTreeSide  side;
 	extract_key extractKey;
@@ -1585,32 +1935,30 @@ rbtree<K, V, C, A, E, bM, bU>::DoInsertKeyImpl(node_type* pNodeParent, bool bFor
 		side = kRBTreeSideRight;
 
 	node_type* const pNodeNew = DoCreateNodeFromKey(key); // Note that pNodeNew->mpLeft, mpRight, mpParent, will be uninitialized.
-	RBTreeInsert(pNodeNew, pNodeParent, &mAnchor, side);
+	RBTreeInsert(pNodeNew, pNodeParent, &mAnchor, side, DoGetAugment());
 	mnSize++;
 
 	return iterator(pNodeNew);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-void rbtree<K, V, C, A, E, bM, bU>::insert(std::initializer_list<value_type> ilist)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::insert(std::initializer_list<value_type> ilist)
 {
-	for(typename std::initializer_list<value_type>::iterator it = ilist.begin(), itEnd = ilist.end(); it != itEnd; ++it)
-		DoInsertValue(has_unique_keys_type(), mmm::move(*it));
+	DoInsertRange(ilist.begin(), ilist.end(), false);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <typename InputIterator>
-void rbtree<K, V, C, A, E, bM, bU>::insert(InputIterator first, InputIterator last)
+void rbtree<K, V, C, A, E, bM, bU, G>::insert(InputIterator first, InputIterator last)
 {
-	for( ; first != last; ++first)
-		DoInsertValue(has_unique_keys_type(), *first); // Or maybe we should call 'insert(end(), *first)' instead. If the first-last range was sorted then this might make some sense.
+	DoInsertRange(first, last, false);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline void rbtree<K, V, C, A, E, bM, bU>::clear()
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::clear()
 {
 	// Erase the entire tree. DoNukeSubtree is not a 
 	// conventional erase function, as it does no rebalancing.
@@ -1619,8 +1967,8 @@ inline void rbtree<K, V, C, A, E, bM, bU>::clear()
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline void rbtree<K, V, C, A, E, bM, bU>::reset_lose_memory()
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::reset_lose_memory()
 {
 	// The reset_lose_memory function is a special extension function which unilaterally 
 	// resets the container to an empty state without freeing the memory of 
@@ -1634,22 +1982,22 @@ inline void rbtree<K, V, C, A, E, bM, bU>::reset_lose_memory()
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::erase(const_iterator position)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::erase(const_iterator position)
 {
 	const iterator iErase(position.mpNode);
 	--mnSize; // Interleave this between the two references to itNext. We expect no exceptions to occur during the code below.
 	++position;
-	RBTreeErase(iErase.mpNode, &mAnchor);
+	RBTreeErase(iErase.mpNode, &mAnchor, DoGetAugment());
 	DoFreeNode(iErase.mpNode);
 	return iterator(position.mpNode);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::erase(const_iterator first, const_iterator last)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::erase(const_iterator first, const_iterator last)
 {
 	// We expect that if the user means to clear the container, they will call clear.
 	if(((first.mpNode != mAnchor.mpNodeLeft) || (last.mpNode != &mAnchor))) // If (first != begin or last != end) ...
@@ -1678,17 +2026,17 @@ rbtree<K, V, C, A, E, bM, bU>::erase(const_iterator first, const_iterator last)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::reverse_iterator
-rbtree<K, V, C, A, E, bM, bU>::erase(const_reverse_iterator position)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::reverse_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::erase(const_reverse_iterator position)
 {
 	return reverse_iterator(erase((++position).base()));
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::reverse_iterator
-rbtree<K, V, C, A, E, bM, bU>::erase(const_reverse_iterator first, const_reverse_iterator last)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::reverse_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::erase(const_reverse_iterator first, const_reverse_iterator last)
 {
 	// Version which erases in order from first to last.
 	// difference_type i(first.base() - last.base());
@@ -1701,8 +2049,8 @@ rbtree<K, V, C, A, E, bM, bU>::erase(const_reverse_iterator first, const_reverse
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline void rbtree<K, V, C, A, E, bM, bU>::erase(const key_type* first, const key_type* last)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::erase(const key_type* first, const key_type* last)
 {
 	// We have no choice but to run a loop like this, as the first/last range could
 	// have values that are discontiguously located in the tree. And some may not 
@@ -1712,9 +2060,9 @@ inline void rbtree<K, V, C, A, E, bM, bU>::erase(const key_type* first, const ke
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::find(const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::find(const key_type& key)
 {
 	// To consider: Implement this instead via calling lower_bound and 
 	// inspecting the result. The following is an implementation of this:
@@ -1746,19 +2094,19 @@ rbtree<K, V, C, A, E, bM, bU>::find(const key_type& key)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::const_iterator
-rbtree<K, V, C, A, E, bM, bU>::find(const key_type& key) const
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::find(const key_type& key) const
 {
-	typedef rbtree<K, V, C, A, E, bM, bU> rbtree_type;
+	typedef rbtree<K, V, C, A, E, bM, bU, G> rbtree_type;
 	return const_iterator(const_cast<rbtree_type*>(this)->find(key));
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <typename U, typename Compare2>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::find_as(const U& u, Compare2 compare2)
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::find_as(const U& u, Compare2 compare2)
 {
 	extract_key extractKey;
 
@@ -1785,19 +2133,54 @@ rbtree<K, V, C, A, E, bM, bU>::find_as(const U& u, Compare2 compare2)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template <typename U, typename Compare2>
-inline typename rbtree<K, V, C, A, E, bM, bU>::const_iterator
-rbtree<K, V, C, A, E, bM, bU>::find_as(const U& u, Compare2 compare2) const
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::find_as(const U& u, Compare2 compare2) const
 {
-	typedef rbtree<K, V, C, A, E, bM, bU> rbtree_type;
+	typedef rbtree<K, V, C, A, E, bM, bU, G> rbtree_type;
 	return const_iterator(const_cast<rbtree_type*>(this)->find_as(u, compare2));
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::lower_bound(const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::lower_bound(const key_type& key)
+{
+	return DoLowerBound(key);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::lower_bound(const key_type& key) const
+{
+	typedef rbtree<K, V, C, A, E, bM, bU, G> rbtree_type;
+	return const_iterator(const_cast<rbtree_type*>(this)->lower_bound(key));
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::upper_bound(const key_type& key)
+{
+	return DoUpperBound(key);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::upper_bound(const key_type& key) const
+{
+	typedef rbtree<K, V, C, A, E, bM, bU, G> rbtree_type;
+	return const_iterator(const_cast<rbtree_type*>(this)->upper_bound(key));
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename U>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoLowerBound(const U& u)
 {
 	extract_key extractKey;
 
@@ -1806,7 +2189,7 @@ rbtree<K, V, C, A, E, bM, bU>::lower_bound(const key_type& key)
 
 	while((pCurrent)) // Do a walk down the tree.
 	{
-		if((!mCompare(extractKey(pCurrent->mValue), key))) // If pCurrent is >= key...
+		if((!mCompare(extractKey(pCurrent->mValue), u))) // If pCurrent is >= u...
 		{
 			pRangeEnd = pCurrent;
 			pCurrent  = (node_type*)pCurrent->mpNodeLeft;
@@ -1821,18 +2204,10 @@ rbtree<K, V, C, A, E, bM, bU>::lower_bound(const key_type& key)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::const_iterator
-rbtree<K, V, C, A, E, bM, bU>::lower_bound(const key_type& key) const
-{
-	typedef rbtree<K, V, C, A, E, bM, bU> rbtree_type;
-	return const_iterator(const_cast<rbtree_type*>(this)->lower_bound(key));
-}
-
-
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::iterator
-rbtree<K, V, C, A, E, bM, bU>::upper_bound(const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename U>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::DoUpperBound(const U& u)
 {
 	extract_key extractKey;
 
@@ -1841,9 +2216,9 @@ rbtree<K, V, C, A, E, bM, bU>::upper_bound(const key_type& key)
 
 	while((pCurrent)) // Do a walk down the tree.
 	{
-		if((mCompare(key, extractKey(pCurrent->mValue)))) // If key is < pCurrent...
+		if((mCompare(u, extractKey(pCurrent->mValue)))) // If u is < pCurrent...
 		{
-			mmm_VALIDATE_COMPARE(!mCompare(extractKey(pCurrent->mValue), key)); // Validate that the compare function is sane.
+			mmm_VALIDATE_COMPARE(!mCompare(extractKey(pCurrent->mValue), u)); // Validate that the compare function is sane.
 			pRangeEnd = pCurrent;
 			pCurrent  = (node_type*)pCurrent->mpNodeLeft;
 		}
@@ -1855,18 +2230,351 @@ rbtree<K, V, C, A, E, bM, bU>::upper_bound(const key_type& key)
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::const_iterator
-rbtree<K, V, C, A, E, bM, bU>::upper_bound(const key_type& key) const
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename U>
+typename rbtree_enable_if_transparent<C, U, typename rbtree<K, V, C, A, E, bM, bU, G>::size_type,
+	!std::is_convertible<U, typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator>::value &&
+	!std::is_convertible<U, typename rbtree<K, V, C, A, E, bM, bU, G>::const_reverse_iterator>::value>::type
+rbtree<K, V, C, A, E, bM, bU, G>::erase(const U& u)
 {
-	typedef rbtree<K, V, C, A, E, bM, bU> rbtree_type;
-	return const_iterator(const_cast<rbtree_type*>(this)->upper_bound(key));
+	const iterator first(DoLowerBound(u)), last(DoUpperBound(u));
+	const size_type n = (size_type)mmm::distance(first, last);
+	erase(first, last);
+	return n;
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::iterator
+rbtree<K, V, C, A, E, bM, bU, G>::nth(size_type k)
+{
+	rbtree_node_base* pNode = mAnchor.mpNodeParent;
+
+	// 左子树有nLeft个: k落在左边就往左, 正好是nLeft就是当前结点, 否则减掉后往右
+	while(pNode)
+	{
+		const size_type nLeft = G::size(pNode->mpNodeLeft);
+
+		if(k < nLeft)
+			pNode = pNode->mpNodeLeft;
+		else if(k == nLeft)
+			return iterator(static_cast<node_type*>(pNode));
+		else
+		{
+			k    -= nLeft + 1;
+			pNode = pNode->mpNodeRight;
+		}
+	}
+
+	return end();
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::const_iterator
+rbtree<K, V, C, A, E, bM, bU, G>::nth(size_type k) const
+{
+	typedef rbtree<K, V, C, A, E, bM, bU, G> rbtree_type;
+	return const_iterator(const_cast<rbtree_type*>(this)->nth(k));
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::size_type
+rbtree<K, V, C, A, E, bM, bU, G>::rank(const key_type& key) const
+{
+	extract_key             extractKey;
+	const rbtree_node_base* pNode = mAnchor.mpNodeParent;
+	size_type               nRank = 0;
+
+	// 和lower_bound走同一条路径, 每次往右时把左子树和当前结点计入
+	while(pNode)
+	{
+		if(mCompare(extractKey(static_cast<const node_type*>(pNode)->mValue), key))
+		{
+			nRank += G::size(pNode->mpNodeLeft) + 1;
+			pNode  = pNode->mpNodeRight;
+		}
+		else
+			pNode = pNode->mpNodeLeft;
+	}
+
+	return nRank;
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::size_type
+rbtree<K, V, C, A, E, bM, bU, G>::count_range(const key_type& lo, const key_type& hi) const
+{
+	if(!mCompare(lo, hi))
+		return 0;
+	return rank(hi) - rank(lo);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::join(this_type& x)
+{
+	if(x.mnSize == 0)
+		return;
+	if(mnSize == 0)
+	{
+		DoAttachRoot(x.mAnchor.mpNodeParent, x.mnSize);
+		x.reset_lose_memory();
+		return;
+	}
+
+	// x的最小结点摘下来当连接点, 其余部分仍是一棵红黑树
+	rbtree_node_base* const pNodePivot = x.mAnchor.mpNodeLeft;
+	rbtree_node_base* const pNodeMax   = x.mAnchor.mpNodeRight;
+	RBTreeErase(pNodePivot, &x.mAnchor, DoGetAugment());
+
+	rbtree_node_base* const pNodeLeft  = mAnchor.mpNodeParent;
+	rbtree_node_base* const pNodeRight = x.mAnchor.mpNodeParent;
+	size_type nHeight;
+	rbtree_node_base* const pNodeRoot = RBTreeJoin(pNodeLeft, DoBlackHeight(pNodeLeft), pNodePivot,
+												   pNodeRight, DoBlackHeight(pNodeRight), &nHeight, DoGetAugment());
+
+	pNodeRoot->mpNodeParent = &mAnchor;
+	mAnchor.mpNodeParent    = pNodeRoot;
+	mAnchor.mpNodeRight     = pNodeMax;
+	mnSize                 += x.mnSize;
+	x.reset_lose_memory();
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::split(const key_type& key, this_type& x)
+{
+	x.clear();
+	if(mnSize == 0)
+		return;
+
+	rbtree_node_base* const pNodeRoot = mAnchor.mpNodeParent;
+	rbtree_node_base*       pNodeLeft;
+	rbtree_node_base*       pNodeRight;
+	size_type               nLeftHeight, nRightHeight;
+
+	DoSplit(pNodeRoot, DoBlackHeight(pNodeRoot), key, pNodeLeft, nLeftHeight, pNodeRight, nRightHeight, NULL);
+
+	const size_type n     = mnSize;
+	const size_type nLeft = DoCountLeft(pNodeLeft, pNodeRight, n, typename G::has_subtree_size());
+	DoAttachRoot(pNodeLeft, nLeft);
+	x.DoAttachRoot(pNodeRight, n - nLeft);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::unite(const this_type& x)
+{
+	if((x.mnSize == 0) || (this == &x))
+		return;
+
+	if(bU && ((mnSize * kSetAlgebraRatio < x.mnSize) || (x.mnSize * kSetAlgebraRatio < mnSize)))
+	{
+		// 复制x后与自身分治合并: 以自身的根切开x, 左右分别递归, 再用根连接起来.
+		// 比较次数O(m log(n/m + 1)), m为较小一侧的规模.
+		rbtree_node_base* const pNodeCopy = DoCopySubtree((const node_type*)x.mAnchor.mpNodeParent, NULL);
+		rbtree_node_base* const pNodeRoot = mAnchor.mpNodeParent;
+		size_type nHeight, nDuplicates = 0;
+
+		rbtree_node_base* const pNodeUnion = DoUnion(pNodeRoot, DoBlackHeight(pNodeRoot), pNodeCopy,
+													 DoBlackHeight(pNodeCopy), nHeight, nDuplicates);
+		DoAttachRoot(pNodeUnion, mnSize + x.mnSize - nDuplicates);
+		return;
+	}
+
+	// 先在树不动的情况下为x多出的元素建好结点, 串成单独的链, mpNodeLeft记下它应排在
+	// 自身哪个结点之前(NULL表示排在最后). 建结点抛出时只需释放这条链, 自身仍完好.
+	extract_key        extractKey;
+	rbtree_node_base*  pNew     = NULL;
+	rbtree_node_base** ppNewTail = &pNew;
+	size_type          n        = mnSize;
+	iterator           itA      = begin();
+	const_iterator     itB      = x.begin();
+
+	try
+	{
+		while(itB != x.end())
+		{
+			if((itA == end()) || mCompare(extractKey(*itB), extractKey(*itA)))
+			{
+				node_type* const pNode = DoCreateNode(*itB++);
+				pNode->mpNodeLeft  = (itA == end()) ? NULL : itA.mpNode;
+				pNode->mpNodeRight = NULL;
+				*ppNewTail = pNode;
+				ppNewTail  = &pNode->mpNodeRight;
+				++n;
+			}
+			else
+			{
+				if(!mCompare(extractKey(*itA), extractKey(*itB)))
+					++itB;
+				++itA;
+			}
+		}
+	}
+	catch(...)
+	{
+		DoFreeChain(pNew);
+		throw;
+	}
+
+	// 以下不再抛出: 按记下的位置把新结点插进自身展平后的链
+	rbtree_node_base*  pNodeA = DoFlatten(mAnchor.mpNodeParent, NULL);
+	rbtree_node_base*  pChain = NULL;
+	rbtree_node_base** ppTail = &pChain;
+
+	for(; pNodeA; pNodeA = pNodeA->mpNodeRight)
+	{
+		for(; pNew && (pNew->mpNodeLeft == pNodeA); pNew = pNew->mpNodeRight)
+		{
+			*ppTail = pNew;
+			ppTail  = &pNew->mpNodeRight;
+		}
+		*ppTail = pNodeA;
+		ppTail  = &pNodeA->mpNodeRight;
+	}
+	*ppTail = pNew; // 排在最后的新结点已经连好
+
+	reset_lose_memory();
+	DoBuildFromChain(pChain, n);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::intersect(const this_type& x)
+{
+	if((mnSize == 0) || (this == &x))
+		return;
+	if(x.mnSize == 0)
+	{
+		clear();
+		return;
+	}
+
+	extract_key extractKey;
+
+	if(bU && (mnSize * kSetAlgebraRatio < x.mnSize))
+	{
+		// 自身小: 逐个到x里查, 查不到的删掉
+		for(iterator it = begin(); it != end(); )
+		{
+			if(x.find(extractKey(*it)) == x.end())
+				it = erase(it);
+			else
+				++it;
+		}
+		return;
+	}
+
+	rbtree_node_base*  pNodeA = DoFlatten(mAnchor.mpNodeParent, NULL);
+	rbtree_node_base*  pChain = NULL;
+	rbtree_node_base** ppTail = &pChain;
+	size_type          n      = 0;
+	const_iterator     itB    = x.begin();
+
+	while(pNodeA)
+	{
+		node_type* const pNode    = (node_type*)pNodeA;
+		const key_type&  keyA     = extractKey(pNode->mValue);
+		pNodeA = pNodeA->mpNodeRight;
+
+		while((itB != x.end()) && mCompare(extractKey(*itB), keyA))
+			++itB;
+
+		if((itB != x.end()) && !mCompare(keyA, extractKey(*itB)))
+		{
+			++itB;
+			*ppTail = pNode;
+			ppTail  = &pNode->mpNodeRight;
+			++n;
+		}
+		else
+			DoFreeNode(pNode);
+	}
+	*ppTail = NULL;
+
+	reset_lose_memory();
+	DoBuildFromChain(pChain, n);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::subtract(const this_type& x)
+{
+	if(this == &x)
+	{
+		clear();
+		return;
+	}
+	if((mnSize == 0) || (x.mnSize == 0))
+		return;
+
+	extract_key extractKey;
+
+	if(x.mnSize * kSetAlgebraRatio < mnSize)
+	{
+		// x小: x里的每个元素在自身里删掉一个相等的
+		for(const_iterator itB = x.begin(); itB != x.end(); ++itB)
+		{
+			const iterator it = lower_bound(extractKey(*itB));
+			if((it != end()) && !mCompare(extractKey(*itB), extractKey(*it)))
+				erase(it);
+		}
+		return;
+	}
+	if(bU && (mnSize * kSetAlgebraRatio < x.mnSize))
+	{
+		// 自身小: 逐个到x里查, 查得到的删掉
+		for(iterator it = begin(); it != end(); )
+		{
+			if(x.find(extractKey(*it)) != x.end())
+				it = erase(it);
+			else
+				++it;
+		}
+		return;
+	}
+
+	rbtree_node_base*  pNodeA = DoFlatten(mAnchor.mpNodeParent, NULL);
+	rbtree_node_base*  pChain = NULL;
+	rbtree_node_base** ppTail = &pChain;
+	size_type          n      = 0;
+	const_iterator     itB    = x.begin();
+
+	while(pNodeA)
+	{
+		node_type* const pNode    = (node_type*)pNodeA;
+		const key_type&  keyA     = extractKey(pNode->mValue);
+		pNodeA = pNodeA->mpNodeRight;
+
+		while((itB != x.end()) && mCompare(extractKey(*itB), keyA))
+			++itB;
+
+		if((itB != x.end()) && !mCompare(keyA, extractKey(*itB)))
+		{
+			++itB;
+			DoFreeNode(pNode);
+		}
+		else
+		{
+			*ppTail = pNode;
+			ppTail  = &pNode->mpNodeRight;
+			++n;
+		}
+	}
+	*ppTail = NULL;
+
+	reset_lose_memory();
+	DoBuildFromChain(pChain, n);
 }
 
 
 // To do: Move this validate function entirely to a template-less implementation.
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-bool rbtree<K, V, C, A, E, bM, bU>::validate() const
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+bool rbtree<K, V, C, A, E, bM, bU, G>::validate() const
 {
 	// Red-black trees have the following canonical properties which we validate here:
 	//   1 Every node is either red or black.
@@ -1953,84 +2661,112 @@ bool rbtree<K, V, C, A, E, bM, bU>::validate() const
 
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoAllocateNode()
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoAllocateNode()
 {
-	auto* pNode = (node_type*)allocator_type::allocate();
+	auto* pNode = (node_type*)allocator_type::allocate(kNodeAllocCount);
 	return pNode;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-inline void rbtree<K, V, C, A, E, bM, bU>::DoFreeNode(node_type* pNode)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline void rbtree<K, V, C, A, E, bM, bU, G>::DoFreeNode(node_type* pNode)
 {
 	pNode->~node_type();
-	allocator_type::deallocate(pNode, sizeof(node_type));
+	allocator_type::deallocate((typename allocator_type::value_type*)pNode, kNodeAllocCount);
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCreateNodeFromKey(const key_type& key)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCreateNodeFromKey(const key_type& key)
 {
 	// Note that this function intentionally leaves the node pointers uninitialized.
 	// The caller would otherwise just turn right around and modify them, so there's
 	// no point in us initializing them to anything (except in a debug build).
 	node_type* const pNode = DoAllocateNode();
-	::new (mmm::addressof(pNode->mValue)) value_type(pair_first_construct_t(), key);
+	try
+	{
+		::new(mmm::addressof(pNode->mValue)) value_type(pair_first_construct_t(), key);
+	}
+	catch(...)
+	{
+		// 值还没构造出来, 只归还内存
+		allocator_type::deallocate((typename allocator_type::value_type*)pNode, kNodeAllocCount);
+		throw;
+	}
 	return pNode;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCreateNode(const value_type& value)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCreateNode(const value_type& value)
 {
 	// Note that this function intentionally leaves the node pointers uninitialized.
 	// The caller would otherwise just turn right around and modify them, so there's
 	// no point in us initializing them to anything (except in a debug build).
 	node_type* const pNode = DoAllocateNode();
-	::new(mmm::addressof(pNode->mValue)) value_type(value);
+	try
+	{
+		::new(mmm::addressof(pNode->mValue)) value_type(value);
+	}
+	catch(...)
+	{
+		allocator_type::deallocate((typename allocator_type::value_type*)pNode, kNodeAllocCount);
+		throw;
+	}
 	return pNode;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCreateNode(value_type&& value)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCreateNode(value_type&& value)
 {
 	// Note that this function intentionally leaves the node pointers uninitialized.
 	// The caller would otherwise just turn right around and modify them, so there's
 	// no point in us initializing them to anything (except in a debug build).
 	node_type* const pNode = DoAllocateNode();
-
-	::new(mmm::addressof(pNode->mValue)) value_type(mmm::move(value));
-
-
+	try
+	{
+		::new(mmm::addressof(pNode->mValue)) value_type(mmm::move(value));
+	}
+	catch(...)
+	{
+		allocator_type::deallocate((typename allocator_type::value_type*)pNode, kNodeAllocCount);
+		throw;
+	}
 	return pNode;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
 template<class... Args>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCreateNode(Args&&... args)
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCreateNode(Args&&... args)
 {
 	// Note that this function intentionally leaves the node pointers uninitialized.
 	// The caller would otherwise just turn right around and modify them, so there's
 	// no point in us initializing them to anything (except in a debug build).
 	node_type* const pNode = DoAllocateNode();
-
-
-	::new(mmm::addressof(pNode->mValue)) value_type(mmm::forward<Args>(args)...);
+	try
+	{
+		::new(mmm::addressof(pNode->mValue)) value_type(mmm::forward<Args>(args)...);
+	}
+	catch(...)
+	{
+		allocator_type::deallocate((typename allocator_type::value_type*)pNode, kNodeAllocCount);
+		throw;
+	}
 	return pNode;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCreateNode(const node_type* pNodeSource, node_type* pNodeParent)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCreateNode(const node_type* pNodeSource, node_type* pNodeParent)
 {
 	node_type* const pNode = DoCreateNode(pNodeSource->mValue);
 
@@ -2043,9 +2779,9 @@ rbtree<K, V, C, A, E, bM, bU>::DoCreateNode(const node_type* pNodeSource, node_t
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-typename rbtree<K, V, C, A, E, bM, bU>::node_type*
-rbtree<K, V, C, A, E, bM, bU>::DoCopySubtree(const node_type* pNodeSource, node_type* pNodeDest)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoCopySubtree(const node_type* pNodeSource, node_type* pNodeDest)
 {
 	node_type* const pNewNodeRoot = DoCreateNode(pNodeSource, pNodeDest);
 
@@ -2068,13 +2804,21 @@ rbtree<K, V, C, A, E, bM, bU>::DoCopySubtree(const node_type* pNodeSource, node_
 			pNewNodeLeft->mpNodeRight = DoCopySubtree((const node_type*)pNodeSource->mpNodeRight, pNewNodeLeft);
 	}
 
+	// 右子树在递归里已算好附加信息, 这里沿左链由下往上补齐.
+	// 附加信息可能引用结点本身(如区间树的最大端点), 不能从源结点照搬.
+	if(RBTreeAugmentFunc pfnAugment = DoGetAugment())
+	{
+		for(rbtree_node_base* pNode = pNodeDest; pNode != pNewNodeRoot->mpNodeParent; pNode = pNode->mpNodeParent)
+			pfnAugment(pNode);
+	}
+
 
 	return pNewNodeRoot;
 }
 
 
-template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU>
-void rbtree<K, V, C, A, E, bM, bU>::DoNukeSubtree(node_type* pNode)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoNukeSubtree(node_type* pNode)
 {
 	while(pNode) // Recursively traverse the tree and destroy items as we go.
 	{
@@ -2087,13 +2831,324 @@ void rbtree<K, V, C, A, E, bM, bU>::DoNukeSubtree(node_type* pNode)
 }
 
 
+// 释放还没挂进树的一条链(mpNodeRight相连)
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoFreeChain(rbtree_node_base* pChain)
+{
+	while(pChain)
+	{
+		rbtree_node_base* const pNext = pChain->mpNodeRight;
+		DoFreeNode((node_type*)pChain);
+		pChain = pNext;
+	}
+}
+
+
+// 批量插入: 先把[first, last)全部构造成结点, 用mpNodeRight串成一条链, 顺带检查是否有序.
+// 树为空且输入有序时, 按中序把链直接摆成一棵平衡树, O(n)且没有任何比较/旋转;
+// 否则逐个插入这些已构造好的结点.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+template <typename InputIterator>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoInsertRange(InputIterator first, InputIterator last, bool bKnownSorted)
+{
+	extract_key        extractKey;
+	rbtree_node_base*  pChain  = NULL;
+	rbtree_node_base** ppTail  = &pChain;
+	node_type*         pPrev   = NULL;
+	size_type          n       = 0;
+	bool               bSorted = true;
+
+	try
+	{
+		for(; first != last; ++first, ++n)
+		{
+			node_type* const pNode = DoCreateNode(*first);
+			*ppTail = pNode;
+			ppTail  = &pNode->mpNodeRight;
+			*ppTail = NULL;
+
+			if(pPrev && bSorted && !bKnownSorted)
+			{
+				// 唯一键要求严格递增, 重复键交给逐个插入去丢弃
+				if(bU)
+					bSorted = mCompare(extractKey(pPrev->mValue), extractKey(pNode->mValue));
+				else
+					bSorted = !mCompare(extractKey(pNode->mValue), extractKey(pPrev->mValue));
+			}
+			pPrev = pNode;
+		}
+	}
+	catch(...)
+	{
+		// 构造或比较抛出: 已建好的结点都还在链上, 树没动过
+		DoFreeChain(pChain);
+		throw;
+	}
+
+	if(n == 0)
+		return;
+
+	if(mnSize == 0 && bSorted)
+		DoBuildFromChain(pChain, n);
+	else
+	{
+		node_type* pNode = NULL;
+		try
+		{
+			while(pChain)
+			{
+				pNode  = (node_type*)pChain;
+				pChain = pChain->mpNodeRight;
+				DoInsertNode(has_unique_keys_type(), pNode);
+			}
+		}
+		catch(...)
+		{
+			// 找插入位置时比较抛出: 当前结点和链上剩下的都没挂进树
+			DoFreeNode(pNode);
+			DoFreeChain(pChain);
+			throw;
+		}
+	}
+}
+
+
+// 空树上用有序链(mpNodeRight相连)里的n个结点直接建平衡树.
+// 满层数floor(log2(n+1)): 更深的(最后一层不满的)结点染红, 其余染黑,
+// 每条路径上的黑结点数都相同.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoBuildFromChain(rbtree_node_base* pChain, size_type n)
+{
+	size_type nFullLevels = 0;
+	while(((size_type)2 << nFullLevels) - 1 <= n)
+		++nFullLevels;
+
+	DoAttachRoot(DoBuildBalanced(pChain, n, 0, nFullLevels), n);
+}
+
+
+// 把一棵独立的子树(根的parent不管)装成整棵树
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoAttachRoot(rbtree_node_base* pNodeRoot, size_type n)
+{
+	if(pNodeRoot)
+	{
+		pNodeRoot->mpNodeParent = &mAnchor;
+		pNodeRoot->mColor       = kRBTreeColorBlack;
+		mAnchor.mpNodeParent    = pNodeRoot;
+		mAnchor.mpNodeLeft      = RBTreeGetMinChild(pNodeRoot);
+		mAnchor.mpNodeRight     = RBTreeGetMaxChild(pNodeRoot);
+		mnSize                  = n;
+	}
+	else
+		reset_lose_memory();
+}
+
+
+// 黑高: 沿最左路径数黑结点, 空树为0
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::size_type
+rbtree<K, V, C, A, E, bM, bU, G>::DoBlackHeight(const rbtree_node_base* pNode)
+{
+	size_type nHeight = 0;
+
+	for(; pNode; pNode = pNode->mpNodeLeft)
+	{
+		if(pNode->mColor == kRBTreeColorBlack)
+			++nHeight;
+	}
+	return nHeight;
+}
+
+
+// 把子树按中序用mpNodeRight串起来接在pChain前面, 返回链头. 只在右孩子上递归, 深度O(log n).
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+rbtree_node_base* rbtree<K, V, C, A, E, bM, bU, G>::DoFlatten(rbtree_node_base* pNode, rbtree_node_base* pChain)
+{
+	while(pNode)
+	{
+		rbtree_node_base* const pNodeLeft = pNode->mpNodeLeft;
+
+		pNode->mpNodeRight = DoFlatten(pNode->mpNodeRight, pChain);
+		pChain = pNode;
+		pNode  = pNodeLeft;
+	}
+	return pChain;
+}
+
+
+// split之后左边的元素个数: 带子树大小时直接读根
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+inline typename rbtree<K, V, C, A, E, bM, bU, G>::size_type
+rbtree<K, V, C, A, E, bM, bU, G>::DoCountLeft(const rbtree_node_base* pNodeLeft, const rbtree_node_base*, size_type, true_type)
+{
+	return G::size(pNodeLeft);
+}
+
+
+// 否则两边交替往前数, 先数完的一侧就是较小的, 代价O(min(左, 右))
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::size_type
+rbtree<K, V, C, A, E, bM, bU, G>::DoCountLeft(const rbtree_node_base* pNodeLeft, const rbtree_node_base* pNodeRight, size_type n, false_type)
+{
+	if(!pNodeLeft || !pNodeRight)
+		return pNodeLeft ? n : 0;
+
+	const rbtree_node_base* const pLeftLast  = RBTreeGetMaxChild(pNodeLeft);
+	const rbtree_node_base* const pRightLast = RBTreeGetMaxChild(pNodeRight);
+	size_type nCount = 1;
+
+	for(pNodeLeft = RBTreeGetMinChild(pNodeLeft), pNodeRight = RBTreeGetMinChild(pNodeRight); ; ++nCount)
+	{
+		if(pNodeLeft == pLeftLast)
+			return nCount;
+		if(pNodeRight == pRightLast)
+			return n - nCount;
+		pNodeLeft  = RBTreeIncrement(pNodeLeft);
+		pNodeRight = RBTreeIncrement(pNodeRight);
+	}
+}
+
+
+// 按key把黑高为nHeight的子树切成两棵: 小于key的和不小于key的, 各自带回黑高.
+// ppNodeEqual非空时(只用于唯一键), 遇到等于key的结点就把它单独摘出来.
+// 沿查找路径每层做一次RBTreeJoin, 相邻两次的黑高差可以相消, 总共O(log n).
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoSplit(rbtree_node_base* pNode, size_type nHeight, const key_type& key,
+												  rbtree_node_base*& pNodeLeft, size_type& nLeftHeight,
+												  rbtree_node_base*& pNodeRight, size_type& nRightHeight,
+												  rbtree_node_base** ppNodeEqual)
+{
+	if(!pNode)
+	{
+		pNodeLeft   = pNodeRight   = NULL;
+		nLeftHeight = nRightHeight = 0;
+		return;
+	}
+
+	extract_key             extractKey;
+	const key_type&         keyNode      = extractKey(((node_type*)pNode)->mValue);
+	const size_type         nChildHeight = nHeight - ((pNode->mColor == kRBTreeColorBlack) ? 1 : 0);
+	rbtree_node_base* const pNodeChildL  = pNode->mpNodeLeft;
+	rbtree_node_base* const pNodeChildR  = pNode->mpNodeRight;
+	rbtree_node_base*       pNodeMiddle;
+	size_type               nMiddleHeight;
+
+	if(mCompare(keyNode, key))
+	{
+		DoSplit(pNodeChildR, nChildHeight, key, pNodeMiddle, nMiddleHeight, pNodeRight, nRightHeight, ppNodeEqual);
+		pNodeLeft = RBTreeJoin(pNodeChildL, nChildHeight, pNode, pNodeMiddle, nMiddleHeight, &nLeftHeight, DoGetAugment());
+	}
+	else if(ppNodeEqual && !mCompare(key, keyNode))
+	{
+		*ppNodeEqual = pNode;
+		pNodeLeft    = pNodeChildL;
+		pNodeRight   = pNodeChildR;
+		nLeftHeight  = nRightHeight = nChildHeight;
+	}
+	else
+	{
+		DoSplit(pNodeChildL, nChildHeight, key, pNodeLeft, nLeftHeight, pNodeMiddle, nMiddleHeight, ppNodeEqual);
+		pNodeRight = RBTreeJoin(pNodeMiddle, nMiddleHeight, pNode, pNodeChildR, nChildHeight, &nRightHeight, DoGetAugment());
+	}
+}
+
+
+// 两棵独立子树的并(唯一键): 以pNode1的根切开pNode2, 左右两半分别递归, 再以根连接.
+// 相等的键保留pNode1里的, pNode2里的释放并计入nDuplicates.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+rbtree_node_base* rbtree<K, V, C, A, E, bM, bU, G>::DoUnion(rbtree_node_base* pNode1, size_type nHeight1,
+															 rbtree_node_base* pNode2, size_type nHeight2,
+															 size_type& nHeight, size_type& nDuplicates)
+{
+	if(!pNode1 || !pNode2)
+	{
+		nHeight = pNode1 ? nHeight1 : nHeight2;
+		return pNode1 ? pNode1 : pNode2;
+	}
+
+	extract_key             extractKey;
+	const size_type         nChildHeight = nHeight1 - ((pNode1->mColor == kRBTreeColorBlack) ? 1 : 0);
+	rbtree_node_base* const pNodeChildL  = pNode1->mpNodeLeft;
+	rbtree_node_base* const pNodeChildR  = pNode1->mpNodeRight;
+	rbtree_node_base*       pNodeLeft2;
+	rbtree_node_base*       pNodeRight2;
+	rbtree_node_base*       pNodeEqual = NULL;
+	size_type               nLeftHeight2, nRightHeight2, nLeftHeight, nRightHeight;
+
+	DoSplit(pNode2, nHeight2, extractKey(((node_type*)pNode1)->mValue),
+			pNodeLeft2, nLeftHeight2, pNodeRight2, nRightHeight2, &pNodeEqual);
+	if(pNodeEqual)
+	{
+		DoFreeNode((node_type*)pNodeEqual);
+		++nDuplicates;
+	}
+
+	rbtree_node_base* const pNodeLeft  = DoUnion(pNodeChildL, nChildHeight, pNodeLeft2, nLeftHeight2, nLeftHeight, nDuplicates);
+	rbtree_node_base* const pNodeRight = DoUnion(pNodeChildR, nChildHeight, pNodeRight2, nRightHeight2, nRightHeight, nDuplicates);
+	return RBTreeJoin(pNodeLeft, nLeftHeight, pNode1, pNodeRight, nRightHeight, &nHeight, DoGetAugment());
+}
+
+
+// 从链上依次取n个结点建子树: 左子树取(n-1)/2个, 右子树取其余, 两边高度至多差1.
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+typename rbtree<K, V, C, A, E, bM, bU, G>::node_type*
+rbtree<K, V, C, A, E, bM, bU, G>::DoBuildBalanced(rbtree_node_base*& pChain, size_type n, size_type nDepth, size_type nFullLevels)
+{
+	if(n == 0)
+		return NULL;
+
+	const size_type  nLeft = (n - 1) / 2;
+	node_type* const pLeft = DoBuildBalanced(pChain, nLeft, nDepth + 1, nFullLevels);
+	node_type* const pNode = (node_type*)pChain;
+	pChain = pChain->mpNodeRight;
+
+	pNode->mpNodeLeft = pLeft;
+	if(pLeft)
+		pLeft->mpNodeParent = pNode;
+	pNode->mColor = (nDepth < nFullLevels) ? kRBTreeColorBlack : kRBTreeColorRed;
+
+	node_type* const pRight = DoBuildBalanced(pChain, n - 1 - nLeft, nDepth + 1, nFullLevels);
+	pNode->mpNodeRight = pRight;
+	if(pRight)
+		pRight->mpNodeParent = pNode;
+
+	if(RBTreeAugmentFunc pfnAugment = DoGetAugment())
+		pfnAugment(pNode);
+
+	return pNode;
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoInsertNode(true_type, node_type* pNode)
+{
+	const key_type& key = extract_key{}(pNode->mValue);
+	bool            canInsert;
+	node_type*      pPosition = DoGetKeyInsertionPositionUniqueKeys(canInsert, key);
+
+	if(canInsert)
+		DoInsertValueImpl(pPosition, false, key, pNode);
+	else
+		DoFreeNode(pNode);
+}
+
+
+template <typename K, typename V, typename C, typename A, typename E, bool bM, bool bU, typename G>
+void rbtree<K, V, C, A, E, bM, bU, G>::DoInsertNode(false_type, node_type* pNode)
+{
+	const key_type& key = extract_key{}(pNode->mValue);
+	DoInsertValueImpl(DoGetKeyInsertionPositionNonuniqueKeys(key), false, key, pNode);
+}
+
+
 
 ///////////////////////////////////////////////////////////////////////
 // global operators
 ///////////////////////////////////////////////////////////////////////
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator==(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator==(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return (a.size() == b.size()) && mmm::equal(a.begin(), a.end(), b.begin());
 }
@@ -2105,43 +3160,43 @@ inline bool operator==(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V
 // utility.h, but it basically is uses the operator< for pair.first and pair.second. The C++ standard
 // appears to require this behaviour, whether intentionally or not. If anything, a good reason to do
 // this is for consistency. A map and a vector that contain the same items should compare the same.
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator<(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator<(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return mmm::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
 }
 
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator!=(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator!=(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return !(a == b);
 }
 
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator>(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator>(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return b < a;
 }
 
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator<=(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator<=(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return !(b < a);
 }
 
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline bool operator>=(const rbtree<K, V, C, A, E, bM, bU>& a, const rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline bool operator>=(const rbtree<K, V, C, A, E, bM, bU, G>& a, const rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	return !(a < b);
 }
 
 
-template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU>
-inline void swap(rbtree<K, V, C, A, E, bM, bU>& a, rbtree<K, V, C, A, E, bM, bU>& b)
+template <typename K, typename V, typename A, typename C, typename E, bool bM, bool bU, typename G>
+inline void swap(rbtree<K, V, C, A, E, bM, bU, G>& a, rbtree<K, V, C, A, E, bM, bU, G>& b)
 {
 	a.swap(b);
 }
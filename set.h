@@ -10,13 +10,15 @@
 namespace mmm {
 
 template <typename Key, typename Compare = mmm::less<Key>,
-          typename Allocator = mmm::allocator<rbtree_node<Key>>>
+          typename Allocator = mmm::allocator<rbtree_node<Key>>,
+          typename Augment = rbtree_no_augment>
 class set : public rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>,
-                          false, true> {
+                          false, true, Augment> {
 public:
-  typedef rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>, false, true>
+  typedef rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>, false, true,
+                 Augment>
       base_type;
-  typedef set<Key, Compare, Allocator> this_type;
+  typedef set<Key, Compare, Allocator, Augment> this_type;
   typedef typename base_type::size_type size_type;
   typedef typename base_type::value_type value_type;
   typedef typename base_type::iterator iterator;
@@ -28,7 +30,10 @@ public:
   // Other types are inherited from the base class.
 
   using base_type::begin;
+  using base_type::count;
   using base_type::end;
+  using base_type::equal_range;
+  using base_type::erase;
   using base_type::find;
   using base_type::lower_bound;
   using base_type::mCompare;
@@ -55,6 +60,12 @@ public:
   template <typename Iterator>
   set(Iterator itBegin, Iterator itEnd)
       : base_type(itBegin, itEnd, Compare(), allocator_type()) {}
+  //输入已有序时直接O(n)建树
+  template <typename Iterator>
+  set(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+      const Compare &compare = Compare(),
+      const allocator_type &allocator = allocator_type())
+      : base_type(sorted_unique, itBegin, itEnd, compare, allocator) {}
 
   this_type &operator=(const this_type &x) {
     return (this_type &)base_type::operator=(x);
@@ -104,13 +115,15 @@ public:
 }; // set
 
 template <typename Key, typename Compare = mmm::less<Key>,
-          typename Allocator = mmm::allocator<rbtree_node<Key>>>
+          typename Allocator = mmm::allocator<rbtree_node<Key>>,
+          typename Augment = rbtree_no_augment>
 class multiset : public rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>,
-                               false, false> {
+                               false, false, Augment> {
 public:
-  typedef rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>, false, false>
+  typedef rbtree<Key, Key, Compare, Allocator, mmm::identity<Key>, false, false,
+                 Augment>
       base_type;
-  typedef multiset<Key, Compare, Allocator> this_type;
+  typedef multiset<Key, Compare, Allocator, Augment> this_type;
   typedef typename base_type::size_type size_type;
   typedef typename base_type::value_type value_type;
   typedef typename base_type::iterator iterator;
@@ -121,7 +134,10 @@ public:
   typedef Compare value_compare;
 
   using base_type::begin;
+  using base_type::count;
   using base_type::end;
+  using base_type::equal_range;
+  using base_type::erase;
   using base_type::find;
   using base_type::lower_bound;
   using base_type::mCompare;
@@ -148,6 +164,12 @@ public:
   template <typename Iterator>
   multiset(Iterator itBegin, Iterator itEnd)
       : base_type(itBegin, itEnd, Compare(), allocator_type()) {}
+  //输入已有序时直接O(n)建树
+  template <typename Iterator>
+  multiset(sorted_unique_t, Iterator itBegin, Iterator itEnd,
+           const Compare &compare = Compare(),
+           const allocator_type &allocator = allocator_type())
+      : base_type(sorted_unique, itBegin, itEnd, compare, allocator) {}
 
   this_type &operator=(const this_type &x) {
     return (this_type &)base_type::operator=(x);
@@ -205,12 +227,49 @@ public:
 
 }; // multiset
 
+//集合运算, 返回新的容器; 实现见rbtree::unite/intersect/subtract
+template <typename Key, typename Compare, typename Allocator, typename Augment>
+inline set<Key, Compare, Allocator, Augment>
+set_union(const set<Key, Compare, Allocator, Augment> &a,
+          const set<Key, Compare, Allocator, Augment> &b) {
+  set<Key, Compare, Allocator, Augment> result(a);
+  result.unite(b);
+  return result;
+}
+template <typename Key, typename Compare, typename Allocator, typename Augment>
+inline set<Key, Compare, Allocator, Augment>
+set_intersection(const set<Key, Compare, Allocator, Augment> &a,
+                 const set<Key, Compare, Allocator, Augment> &b) {
+  set<Key, Compare, Allocator, Augment> result(a);
+  result.intersect(b);
+  return result;
+}
+template <typename Key, typename Compare, typename Allocator, typename Augment>
+inline set<Key, Compare, Allocator, Augment>
+set_difference(const set<Key, Compare, Allocator, Augment> &a,
+               const set<Key, Compare, Allocator, Augment> &b) {
+  set<Key, Compare, Allocator, Augment> result(a);
+  result.subtract(b);
+  return result;
+}
+
+//结点带子树大小的set/multiset, 额外提供O(log n)的nth/rank/count_range
+template <typename Key, typename Compare = mmm::less<Key>>
+using order_statistic_set =
+    set<Key, Compare, mmm::allocator<rbtree_node<Key, rbtree_size_node_base>>,
+        rbtree_order_statistics>;
+template <typename Key, typename Compare = mmm::less<Key>>
+using order_statistic_multiset = multiset<
+    Key, Compare, mmm::allocator<rbtree_node<Key, rbtree_size_node_base>>,
+    rbtree_order_statistics>;
+
 // set
 
-template <typename Key, typename Compare, typename Allocator>
-inline mmm::pair<typename set<Key, Compare, Allocator>::iterator,
-                 typename set<Key, Compare, Allocator>::iterator>
-set<Key, Compare, Allocator>::equal_range(const Key &k) {
+template <typename Key, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename set<Key, Compare, Allocator, Augment>::iterator,
+                 typename set<Key, Compare, Allocator, Augment>::iterator>
+set<Key, Compare, Allocator, Augment>::equal_range(const Key &k) {
   const iterator itLower(lower_bound(k));
 
   if ((itLower == end()) ||
@@ -221,10 +280,11 @@ set<Key, Compare, Allocator>::equal_range(const Key &k) {
   return mmm::pair<iterator, iterator>(itLower, ++itUpper);
 }
 
-template <typename Key, typename Compare, typename Allocator>
-inline mmm::pair<typename set<Key, Compare, Allocator>::const_iterator,
-                 typename set<Key, Compare, Allocator>::const_iterator>
-set<Key, Compare, Allocator>::equal_range(const Key &k) const {
+template <typename Key, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename set<Key, Compare, Allocator, Augment>::const_iterator,
+                 typename set<Key, Compare, Allocator, Augment>::const_iterator>
+set<Key, Compare, Allocator, Augment>::equal_range(const Key &k) const {
 
   const const_iterator itLower(lower_bound(k));
 
@@ -238,10 +298,11 @@ set<Key, Compare, Allocator>::equal_range(const Key &k) const {
 
 // multiset
 
-template <typename Key, typename Compare, typename Allocator>
-inline mmm::pair<typename multiset<Key, Compare, Allocator>::iterator,
-                 typename multiset<Key, Compare, Allocator>::iterator>
-multiset<Key, Compare, Allocator>::equal_range_small(const Key &k) {
+template <typename Key, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename multiset<Key, Compare, Allocator, Augment>::iterator,
+                 typename multiset<Key, Compare, Allocator, Augment>::iterator>
+multiset<Key, Compare, Allocator, Augment>::equal_range_small(const Key &k) {
   // We provide alternative version of equal_range here which works faster
   // for the case where there are at most small number of potential duplicated
   // keys.
@@ -254,10 +315,11 @@ multiset<Key, Compare, Allocator>::equal_range_small(const Key &k) {
   return mmm::pair<iterator, iterator>(itLower, itUpper);
 }
 
-template <typename Key, typename Compare, typename Allocator>
-inline mmm::pair<typename multiset<Key, Compare, Allocator>::const_iterator,
-                 typename multiset<Key, Compare, Allocator>::const_iterator>
-multiset<Key, Compare, Allocator>::equal_range_small(const Key &k) const {
+template <typename Key, typename Compare, typename Allocator,
+          typename Augment>
+inline mmm::pair<typename multiset<Key, Compare, Allocator, Augment>::const_iterator,
+                 typename multiset<Key, Compare, Allocator, Augment>::const_iterator>
+multiset<Key, Compare, Allocator, Augment>::equal_range_small(const Key &k) const {
 
   const const_iterator itLower(lower_bound(k));
   const_iterator itUpper(itLower);
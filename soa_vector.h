@@ -0,0 +1,421 @@
+#ifndef _SOA_VECTOR_H_
+#define _SOA_VECTOR_H_
+
+#include "allocator.h"
+#include "construct.h"
+#include "iterator.h"
+#include "span.h"
+#include "uninitialized.h"
+#include "utility.h"
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+namespace mmm {
+
+// soa_vector<Fields...>: struct-of-arrays.
+// 每个字段一段独立的连续数组, 共用 size/capacity. 只扫描某一列时访存是顺序的,
+// 列可以通过 column<I>() 以 span 的形式直接交给循环/算法.
+// 行通过代理 soa_row 访问: v[i].get<I>().
+
+namespace Detail {
+//第I个类型
+template <size_t I, class Head, class... Tail> struct soa_type_at {
+  typedef typename soa_type_at<I - 1, Tail...>::type type;
+};
+template <class Head, class... Tail> struct soa_type_at<0, Head, Tail...> {
+  typedef Head type;
+};
+
+//列存储: 递归地每层持有一列.
+//扩容时先整套分配新列并构造好新行, 再把旧行搬过去, 最后才释放旧列;
+//任何一步抛出都只清理新列, 旧列原样保留.
+template <class... Fields> struct soa_columns {
+  void allocate(size_t) {}
+  void relocate(soa_columns &, size_t) {}
+  void destroy(size_t, size_t) {}
+  void deallocate(size_t) {}
+  void construct_row(size_t) {}
+  void copy_rows(const soa_columns &, size_t) {}
+  void assign_row(size_t, const soa_columns &, size_t) {}
+  void swap(soa_columns &) {}
+};
+
+template <class Head, class... Tail> struct soa_columns<Head, Tail...> {
+  Head *data_;
+  soa_columns<Tail...> tail_;
+
+  soa_columns() : data_(nullptr) {}
+
+  //每列分配cap个元素的空间, 某列分配失败时释放已分配的列
+  void allocate(size_t cap) {
+    data_ = allocator<Head>::allocate(cap);
+    try {
+      tail_.allocate(cap);
+    } catch (...) {
+      allocator<Head>::deallocate(data_, cap);
+      data_ = nullptr;
+      throw;
+    }
+  }
+  //把other的前n行构造到自身(已分配): 移动不抛异常的列移动, 否则复制.
+  //后面的列抛出时把已移走的列移回去, other保持原样. 不析构other
+  void relocate(soa_columns &other, size_t n) {
+    Head *src = other.data_;
+    construct_column(n, [src](size_t i) -> decltype(auto) {
+      return std::move_if_noexcept(src[i]);
+    });
+    try {
+      tail_.relocate(other.tail_, n);
+    } catch (...) {
+      if (std::is_nothrow_move_constructible<Head>::value)
+        for (size_t i = 0; i != n; ++i) {
+          mmm::destroy(src + i);
+          new (src + i) Head(mmm::move(data_[i]));
+        }
+      destroy_column(0, n);
+      throw;
+    }
+  }
+  void destroy(size_t first, size_t last) {
+    destroy_column(first, last);
+    tail_.destroy(first, last);
+  }
+  void deallocate(size_t cap) {
+    allocator<Head>::deallocate(data_, cap);
+    data_ = nullptr;
+    tail_.deallocate(cap);
+  }
+  //默认构造第i行, 后面的字段抛出时析构已构造的字段
+  void construct_row(size_t i) {
+    mmm::construct(data_ + i);
+    try {
+      tail_.construct_row(i);
+    } catch (...) {
+      mmm::destroy(data_ + i);
+      throw;
+    }
+  }
+  template <class Arg, class... Args>
+  void construct_row(size_t i, Arg &&arg, Args &&... args) {
+    new (data_ + i) Head(mmm::forward<Arg>(arg));
+    try {
+      tail_.construct_row(i, mmm::forward<Args>(args)...);
+    } catch (...) {
+      mmm::destroy(data_ + i);
+      throw;
+    }
+  }
+  void copy_rows(const soa_columns &other, size_t n) {
+    const Head *src = other.data_;
+    construct_column(n, [src](size_t i) -> const Head & { return src[i]; });
+    try {
+      tail_.copy_rows(other.tail_, n);
+    } catch (...) {
+      destroy_column(0, n);
+      throw;
+    }
+  }
+  void assign_row(size_t i, const soa_columns &other, size_t j) {
+    data_[i] = other.data_[j];
+    tail_.assign_row(i, other.tail_, j);
+  }
+  void swap(soa_columns &other) {
+    mmm::swap(data_, other.data_);
+    tail_.swap(other.tail_);
+  }
+
+private:
+  void destroy_column(size_t first, size_t last) {
+    for (; first != last; ++first)
+      mmm::destroy(data_ + first);
+  }
+  //用get(i)构造本列前n个元素; 抛出时析构已构造的部分
+  template <class Get> void construct_column(size_t n, Get get) {
+    size_t i = 0;
+    try {
+      for (; i != n; ++i)
+        new (data_ + i) Head(get(i));
+    } catch (...) {
+      destroy_column(0, i);
+      throw;
+    }
+  }
+};
+
+//取第I列的指针
+template <size_t I> struct soa_get {
+  template <class Columns> static auto &data(Columns &c) {
+    return soa_get<I - 1>::data(c.tail_);
+  }
+};
+template <> struct soa_get<0> {
+  template <class Columns> static auto &data(Columns &c) { return c.data_; }
+};
+} // namespace Detail
+
+//行代理, 引用容器中的第index_行
+template <class Vector> class soa_row {
+public:
+  Vector *vec_;
+  size_t index_;
+
+public:
+  soa_row(Vector *v, size_t i) : vec_(v), index_(i) {}
+  soa_row(const soa_row &other) = default;
+
+  template <size_t I> decltype(auto) get() const {
+    return vec_->template get<I>(index_);
+  }
+  //逐字段赋值, 而不是重新绑定
+  soa_row &operator=(const soa_row &other) {
+    vec_->assign_row(index_, *other.vec_, other.index_);
+    return *this;
+  }
+};
+
+template <size_t I, class Vector> decltype(auto) get(const soa_row<Vector> &row) {
+  return row.template get<I>();
+}
+
+template <class Vector, class Row> class soa_iterator {
+public:
+  typedef mmm::random_access_iterator_tag iterator_category;
+  typedef Row value_type;
+  typedef Row reference;
+  typedef void pointer;
+  typedef ptrdiff_t difference_type;
+  typedef soa_iterator self;
+
+  Vector *vec_;
+  size_t index_;
+
+public:
+  soa_iterator() : vec_(nullptr), index_(0) {}
+  soa_iterator(Vector *v, size_t i) : vec_(v), index_(i) {}
+
+  reference operator*() const { return Row(vec_, index_); }
+  reference operator[](difference_type n) const { return Row(vec_, index_ + n); }
+  self &operator++() {
+    ++index_;
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    ++index_;
+    return tmp;
+  }
+  self &operator--() {
+    --index_;
+    return *this;
+  }
+  self operator--(int) {
+    self tmp = *this;
+    --index_;
+    return tmp;
+  }
+  self &operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+  self &operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+  self operator+(difference_type n) const { return self(vec_, index_ + n); }
+  self operator-(difference_type n) const { return self(vec_, index_ - n); }
+  difference_type operator-(const self &other) const {
+    return difference_type(index_) - difference_type(other.index_);
+  }
+  bool operator==(const self &other) const { return index_ == other.index_; }
+  bool operator!=(const self &other) const { return index_ != other.index_; }
+  bool operator<(const self &other) const { return index_ < other.index_; }
+};
+
+template <class... Fields> class soa_vector {
+  static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+
+public:
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef soa_row<soa_vector> reference;
+  typedef soa_row<const soa_vector> const_reference;
+  typedef soa_iterator<soa_vector, reference> iterator;
+  typedef soa_iterator<const soa_vector, const_reference> const_iterator;
+  template <size_t I>
+  using column_type = typename Detail::soa_type_at<I, Fields...>::type;
+
+private:
+  Detail::soa_columns<Fields...> columns_;
+  size_type size_;
+  size_type capacity_;
+
+public:
+  soa_vector() : size_(0), capacity_(0) {}
+  explicit soa_vector(size_type n) : soa_vector() { resize(n); }
+  soa_vector(const soa_vector &other) : soa_vector() {
+    reserve(other.size_);
+    columns_.copy_rows(other.columns_, other.size_);
+    size_ = other.size_;
+  }
+  soa_vector(soa_vector &&other) : soa_vector() { this->swap(other); }
+  soa_vector &operator=(const soa_vector &other) {
+    soa_vector tmp(other);
+    this->swap(tmp);
+    return *this;
+  }
+  soa_vector &operator=(soa_vector &&other) {
+    if (&other != this)
+      this->swap(other);
+    return *this;
+  }
+  ~soa_vector() { release(); }
+
+  iterator begin() noexcept { return iterator(this, 0); }
+  iterator end() noexcept { return iterator(this, size_); }
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+  const_iterator end() const noexcept { return const_iterator(this, size_); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  //容量
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+  void reserve(size_type n) {
+    if (n > capacity_)
+      grow_to(n);
+  }
+  void resize(size_type n);
+  void shrink_to_fit() {
+    if (capacity_ != size_)
+      grow_to(size_);
+  }
+
+  //列访问
+  template <size_t I> column_type<I> *data() noexcept {
+    return Detail::soa_get<I>::data(columns_);
+  }
+  template <size_t I> const column_type<I> *data() const noexcept {
+    return Detail::soa_get<I>::data(columns_);
+  }
+  template <size_t I> span<column_type<I>> column() noexcept {
+    return span<column_type<I>>(data<I>(), size_);
+  }
+  template <size_t I> span<const column_type<I>> column() const noexcept {
+    return span<const column_type<I>>(data<I>(), size_);
+  }
+
+  //元素访问
+  template <size_t I> column_type<I> &get(size_type i) { return data<I>()[i]; }
+  template <size_t I> const column_type<I> &get(size_type i) const {
+    return data<I>()[i];
+  }
+  reference operator[](size_type i) { return reference(this, i); }
+  const_reference operator[](size_type i) const {
+    return const_reference(this, i);
+  }
+  reference front() { return (*this)[0]; }
+  const_reference front() const { return (*this)[0]; }
+  reference back() { return (*this)[size_ - 1]; }
+  const_reference back() const { return (*this)[size_ - 1]; }
+
+  //修改器: 以整行为单位
+  void push_back(const Fields &... vals) { emplace_back(vals...); }
+  template <class... Args> reference emplace_back(Args &&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Fields),
+                  "emplace_back takes one argument per field");
+    if (size_ == capacity_)
+      realloc_append(mmm::forward<Args>(args)...);
+    else
+      columns_.construct_row(size_, mmm::forward<Args>(args)...);
+    return reference(this, size_++);
+  }
+  void pop_back() {
+    --size_;
+    columns_.destroy(size_, size_ + 1);
+  }
+  void clear() {
+    columns_.destroy(0, size_);
+    size_ = 0;
+  }
+  void swap(soa_vector &other) noexcept {
+    columns_.swap(other.columns_);
+    mmm::swap(size_, other.size_);
+    mmm::swap(capacity_, other.capacity_);
+  }
+
+  //供soa_row赋值使用
+  void assign_row(size_type i, const soa_vector &other, size_type j) {
+    columns_.assign_row(i, other.columns_, j);
+  }
+
+private:
+  size_type get_new_capacity() const {
+    return capacity_ == 0 ? size_type(8) : capacity_ * 2;
+  }
+  void grow_to(size_type n) {
+    Detail::soa_columns<Fields...> fresh;
+    fresh.allocate(n);
+    try {
+      fresh.relocate(columns_, size_);
+    } catch (...) {
+      fresh.deallocate(n);
+      throw;
+    }
+    adopt(fresh, n);
+  }
+  //满容量时追加: 参数可能引用自身的元素, 所以先在新列里构造新行, 再搬旧行
+  template <class... Args> void realloc_append(Args &&... args) {
+    const size_type n = get_new_capacity();
+    Detail::soa_columns<Fields...> fresh;
+    fresh.allocate(n);
+    try {
+      fresh.construct_row(size_, mmm::forward<Args>(args)...);
+    } catch (...) {
+      fresh.deallocate(n);
+      throw;
+    }
+    try {
+      fresh.relocate(columns_, size_);
+    } catch (...) {
+      fresh.destroy(size_, size_ + 1);
+      fresh.deallocate(n);
+      throw;
+    }
+    adopt(fresh, n);
+  }
+  //释放旧列, 换上已填好前size_行的新列
+  void adopt(Detail::soa_columns<Fields...> &fresh, size_type n) {
+    columns_.destroy(0, size_);
+    columns_.deallocate(capacity_);
+    columns_.swap(fresh);
+    capacity_ = n;
+  }
+  void release() {
+    columns_.destroy(0, size_);
+    columns_.deallocate(capacity_);
+    size_ = capacity_ = 0;
+  }
+}; // end of soa_vector
+
+template <class... Fields> void soa_vector<Fields...>::resize(size_type n) {
+  if (n < size_) {
+    columns_.destroy(n, size_);
+  } else {
+    reserve(n);
+    for (; size_ != n; ++size_)
+      columns_.construct_row(size_);
+  }
+  size_ = n;
+}
+
+template <class... Fields>
+inline void swap(soa_vector<Fields...> &x, soa_vector<Fields...> &y) noexcept {
+  x.swap(y);
+}
+
+} // namespace mmm
+
+#endif
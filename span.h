@@ -0,0 +1,63 @@
+#ifndef _SPAN_H_
+#define _SPAN_H_
+
+#include "iterator.h"
+#include <stddef.h>
+
+namespace mmm {
+
+// span: 一段连续内存的非拥有视图(指针 + 长度), 迭代器即原始指针.
+template <class T> class span {
+public:
+  typedef T element_type;
+  typedef T value_type;
+  typedef T *pointer;
+  typedef T &reference;
+  typedef T *iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+private:
+  pointer data_;
+  size_type size_;
+
+public:
+  span() noexcept : data_(nullptr), size_(0) {}
+  span(pointer p, size_type n) noexcept : data_(p), size_(n) {}
+  span(pointer first, pointer last) noexcept
+      : data_(first), size_(last - first) {}
+  template <size_t N>
+  span(T (&arr)[N]) noexcept : data_(arr), size_(N) {}
+  // span<T> -> span<const T>
+  template <class U>
+  span(const span<U> &other) noexcept
+      : data_(other.data()), size_(other.size()) {}
+
+  iterator begin() const noexcept { return data_; }
+  iterator end() const noexcept { return data_ + size_; }
+  reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+  size_type size() const noexcept { return size_; }
+  size_type size_bytes() const noexcept { return size_ * sizeof(T); }
+  bool empty() const noexcept { return size_ == 0; }
+  pointer data() const noexcept { return data_; }
+
+  reference operator[](size_type i) const { return data_[i]; }
+  reference front() const { return data_[0]; }
+  reference back() const { return data_[size_ - 1]; }
+
+  span first(size_type n) const { return span(data_, n); }
+  span last(size_type n) const { return span(data_ + size_ - n, n); }
+  span subspan(size_type offset, size_type n) const {
+    return span(data_ + offset, n);
+  }
+  span subspan(size_type offset) const {
+    return span(data_ + offset, size_ - offset);
+  }
+};
+
+} // namespace mmm
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include "allocator.h"
+#include "utility.h"
+#include <atomic>
+#include <new>
+#include <stddef.h>
+
+namespace mmm {
+
+// spsc_queue: 单生产者/单消费者的有界无锁环形队列.
+// 生产者只写tail_, 消费者只写head_, 二者各占一个缓存行.
+// 每一方缓存对方的下标(head_cache_/tail_cache_), 只有看起来满/空时才去读
+// 对方的原子变量, 因此稳态下一次push/pop不会读到对方正在写的缓存行.
+// 存储长度取整为2的幂, 下标不回绕, 用掩码取槽位.
+// try_push*只能由一个生产者线程调用, try_pop*/front/pop只能由一个消费者线程调用.
+template <class T, class Alloc = allocator<T>> class spsc_queue {
+public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef Alloc allocator_type;
+
+private:
+  typedef Alloc dataAllocator;
+
+  //生产者
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<size_type> tail_;
+  size_type head_cache_;
+  //消费者
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<size_type> head_;
+  size_type tail_cache_;
+  //只读
+  alignas(_MMM_CACHE_LINE_SIZE) T *buf_;
+  size_type mask_;
+  size_type capacity_;
+
+public:
+  explicit spsc_queue(size_type capacity)
+      : tail_(0), head_cache_(0), head_(0), tail_cache_(0), buf_(nullptr),
+        mask_(0), capacity_(capacity) {
+    size_type len = 1;
+    while (len < capacity)
+      len <<= 1;
+    buf_ = dataAllocator::allocate(len);
+    mask_ = len - 1;
+  }
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+  ~spsc_queue() {
+    const size_type tail = tail_.load(std::memory_order_relaxed);
+    for (size_type i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+      buf_[i & mask_].~T();
+    dataAllocator::deallocate(buf_, mask_ + 1);
+  }
+
+  //生产者
+  bool try_push(const value_type &val) { return try_emplace(val); }
+  bool try_push(value_type &&val) { return try_emplace(mmm::move(val)); }
+  template <class... Args> bool try_emplace(Args &&... args);
+  //最多放入n个, 返回实际放入的个数. 只发布一次tail_
+  template <class InputIterator>
+  size_type try_push_n(InputIterator first, size_type n);
+
+  //消费者
+  bool try_pop(value_type &out);
+  //最多取出n个写到out, 返回实际取出的个数. 只发布一次head_
+  template <class OutputIterator>
+  size_type try_pop_n(OutputIterator out, size_type n);
+  //队首元素, 为空时返回nullptr
+  value_type *front() {
+    const size_type head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_)
+        return nullptr;
+    }
+    return buf_ + (head & mask_);
+  }
+  //丢弃队首元素, 须在front()返回非空之后调用
+  void pop() {
+    const size_type head = head_.load(std::memory_order_relaxed);
+    buf_[head & mask_].~T();
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  //任意线程可调用, 并发时只是一个近似值
+  size_type size() const noexcept {
+    const size_type head = head_.load(std::memory_order_acquire);
+    const size_type tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+  bool empty() const noexcept { return size() == 0; }
+  size_type capacity() const noexcept { return capacity_; }
+
+private:
+  //还能放入的个数
+  size_type free_slots(size_type tail, size_type want) {
+    size_type room = capacity_ - (tail - head_cache_);
+    if (room < want) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      room = capacity_ - (tail - head_cache_);
+    }
+    return room;
+  }
+  //可以取出的个数
+  size_type ready_slots(size_type head, size_type want) {
+    size_type ready = tail_cache_ - head;
+    if (ready < want) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      ready = tail_cache_ - head;
+    }
+    return ready;
+  }
+}; // end of spsc_queue
+
+template <class T, class Alloc>
+template <class... Args>
+bool spsc_queue<T, Alloc>::try_emplace(Args &&... args) {
+  const size_type tail = tail_.load(std::memory_order_relaxed);
+  if (free_slots(tail, 1) == 0)
+    return false;
+  new (buf_ + (tail & mask_)) T(mmm::forward<Args>(args)...);
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <class T, class Alloc>
+template <class InputIterator>
+typename spsc_queue<T, Alloc>::size_type
+spsc_queue<T, Alloc>::try_push_n(InputIterator first, size_type n) {
+  const size_type tail = tail_.load(std::memory_order_relaxed);
+  const size_type room = free_slots(tail, n);
+  if (n > room)
+    n = room;
+  for (size_type i = 0; i != n; ++i, ++first)
+    new (buf_ + ((tail + i) & mask_)) T(*first);
+  tail_.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+template <class T, class Alloc>
+bool spsc_queue<T, Alloc>::try_pop(value_type &out) {
+  const size_type head = head_.load(std::memory_order_relaxed);
+  if (ready_slots(head, 1) == 0)
+    return false;
+  T *p = buf_ + (head & mask_);
+  out = mmm::move(*p);
+  p->~T();
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <class T, class Alloc>
+template <class OutputIterator>
+typename spsc_queue<T, Alloc>::size_type
+spsc_queue<T, Alloc>::try_pop_n(OutputIterator out, size_type n) {
+  const size_type head = head_.load(std::memory_order_relaxed);
+  const size_type ready = ready_slots(head, n);
+  if (n > ready)
+    n = ready;
+  for (size_type i = 0; i != n; ++i, ++out) {
+    T *p = buf_ + ((head + i) & mask_);
+    *out = mmm::move(*p);
+    p->~T();
+  }
+  head_.store(head + n, std::memory_order_release);
+  return n;
+}
+
+} // namespace mmm
+
+#endif
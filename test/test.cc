@@ -2,19 +2,35 @@
 
 #include "../algorithm.h"
 #include "../alloc.h"
+#include "../circular_buffer.h"
 #include "../allocator.h"
+#include "../blocking_queue.h"
+#include "../btree_map.h"
+#include "../btree_set.h"
+#include "../concurrent_vector.h"
 #include "../construct.h"
 #include "../deque.h"
+#include "../flat_map.h"
+#include "../flat_set.h"
+#include "../forward_list.h"
+#include "../interval_map.h"
+#include "../intrusive_list.h"
 #include "../list.h"
 #include "../map.h"
+#include "../mpmc_queue.h"
+#include "../mpsc_queue.h"
 #include "../mycstring.h"
 #include "../queue.h"
 #include "../rbtree.h"
 #include "../set.h"
+#include "../soa_vector.h"
+#include "../spsc_queue.h"
 #include "../stack.h"
 #include "../uninitialized.h"
+#include "../unrolled_list.h"
 #include "../utility.h"
 #include "../vector.h"
+#include "../work_stealing_deque.h"
 
 #include <algorithm>
 #include <cassert>
@@ -23,11 +39,13 @@
 #include <iterator>
 #include <list>
 #include <map>
+#include <numeric>
 #include <queue>
 #include <random>
 #include <set>
 #include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace mmm {
@@ -316,6 +334,320 @@ void testCase6() {
   assert(foo2 == bar);
 }
 
+void testCase7() {
+  std::deque<std::string> dq1;
+  mmm::deque<std::string> dq2;
+  for (auto i = 0; i != 5000; ++i) {
+    dq1.push_back(std::to_string(i));
+    dq2.push_back(std::to_string(i));
+    dq1.push_front(std::to_string(-i));
+    dq2.push_front(std::to_string(-i));
+  }
+  assert(mmm::container_equal(dq1, dq2));
+  //元素地址在map增长后保持不变
+  const std::string *p = &dq2[100];
+  for (auto i = 0; i != 5000; ++i)
+    dq2.push_back("x");
+  assert(p == &dq2[100]);
+  for (auto i = 0; i != 5000; ++i)
+    dq2.pop_back();
+
+  for (auto i = 0; i != 7000; ++i) {
+    dq1.pop_front();
+    dq2.pop_front();
+  }
+  assert(mmm::container_equal(dq1, dq2));
+  mmm::deque<std::string> dq3(dq2);
+  assert(dq3 == dq2);
+  dq2.clear();
+  assert(dq2.empty());
+  dq2.push_front("a");
+  dq2.push_back("b");
+  assert(dq2.front() == "a" && dq2.back() == "b");
+}
+void testCase8() {
+  //FIFO稳态: 前端释放的块被后端复用
+  mmm::deque<int> dq;
+  for (auto i = 0; i != 1000; ++i)
+    dq.push_back(i);
+  for (auto i = 1000; i != 200000; ++i) {
+    dq.push_back(i);
+    assert(dq.front() == i - 1000);
+    dq.pop_front();
+    assert(dq.spare_blocks() <= dq.max_spare_blocks());
+  }
+  assert(dq.size() == 1000 && dq.back() == 199999);
+
+  dq.clear();
+  assert(dq.spare_blocks() > 0);
+  dq.set_max_spare_blocks(1);
+  assert(dq.spare_blocks() <= 1);
+  dq.shrink_to_fit();
+  assert(dq.spare_blocks() == 0);
+  for (auto i = 0; i != 3000; ++i)
+    dq.push_front(i);
+  dq.shrink_to_fit();
+  for (auto i = 0; i != 3000; ++i)
+    dq.push_back(i);
+  assert(dq.size() == 6000 && dq.front() == 2999 && dq.back() == 2999);
+}
+void testCase9() {
+  //块长取整为2的幂
+  static_assert(mmm::deque_buf_traits<int, 512>::len == 128, "");
+  static_assert(mmm::deque_buf_traits<char[24], 512>::len == 32, "");
+  static_assert(mmm::deque_buf_traits<char[600], 512>::len == 1, "");
+
+  std::deque<int> dq1;
+  mmm::deque<int, mmm::allocator<int>, 64> dq2;
+  for (auto i = 0; i != 1000; ++i) {
+    dq1.push_back(i);
+    dq2.push_back(i);
+    dq1.push_front(-i);
+    dq2.push_front(-i);
+  }
+  assert(mmm::container_equal(dq1, dq2));
+  for (size_t i = 0; i != dq1.size(); ++i)
+    assert(dq1[i] == dq2[i]);
+  auto it = dq2.begin();
+  for (long step : {37L, 500L, -200L, 1L, -337L}) {
+    it += step;
+    assert(*it == dq1[it - dq2.begin()]);
+  }
+  assert(dq2.end() - dq2.begin() == 2000);
+
+  //块比指针还小: 进出备用块链表不能写越界
+  mmm::deque<char, mmm::allocator<char>, 4> dq3;
+  for (int round = 0; round != 3; ++round) {
+    for (int i = 0; i != 100; ++i)
+      dq3.push_back(char(i));
+    assert(dq3.size() == 100 && dq3[99] == 99);
+    while (!dq3.empty())
+      dq3.pop_front();
+  }
+  assert(dq3.spare_blocks() > 0);
+}
+void testCase10() {
+  //按块处理的算法: 跨块边界的各种起止位置
+  mmm::deque<int, mmm::allocator<int>, 64> dq1(1000, 0);
+  std::deque<int> dq2(1000, 0);
+  for (int i = 0; i != 1000; ++i)
+    dq1[i] = dq2[i] = i;
+  int arr[1000];
+  for (int i = 0; i != 1000; ++i)
+    arr[i] = -i;
+
+  mmm::copy(arr + 3, arr + 700, dq1.begin() + 5);
+  std::copy(arr + 3, arr + 700, dq2.begin() + 5);
+  assert(mmm::container_equal(dq1, dq2));
+  auto it = mmm::copy(dq1.begin() + 17, dq1.begin() + 500, arr + 1);
+  assert(it == arr + 484 && arr[1] == dq1[17] && arr[483] == dq1[499]);
+  mmm::copy(dq1.cbegin() + 600, dq1.cend(), dq1.begin() + 1);
+  std::copy(dq2.cbegin() + 600, dq2.cend(), dq2.begin() + 1);
+  assert(mmm::container_equal(dq1, dq2));
+  mmm::copy_backward(dq1.begin() + 1, dq1.begin() + 333, dq1.end());
+  std::copy_backward(dq2.begin() + 1, dq2.begin() + 333, dq2.end());
+  assert(mmm::container_equal(dq1, dq2));
+  auto end = mmm::copy(dq1.begin(), dq1.begin() + 16, dq1.begin() + 48);
+  assert(end == dq1.begin() + 64);
+
+  mmm::fill(dq1.begin() + 9, dq1.begin() + 901, 7);
+  std::fill(dq2.begin() + 9, dq2.begin() + 901, 7);
+  assert(mmm::container_equal(dq1, dq2));
+  assert(mmm::equal(dq1.begin(), dq1.end(), dq2.begin()));
+  assert(mmm::equal(dq1.begin() + 3, dq1.begin() + 803, dq1.begin() + 3));
+  dq1[950] = 12345;
+  assert(!mmm::equal(dq1.begin(), dq1.end(), dq2.begin()));
+  assert(*mmm::find(dq1.begin(), dq1.end(), 12345) == 12345);
+  assert(mmm::find(dq1.begin(), dq1.end(), 12345) - dq1.begin() == 950);
+  assert(mmm::find(dq1.begin(), dq1.begin() + 950, 12345) ==
+         dq1.begin() + 950);
+  long sum = 0;
+  mmm::for_each(dq1.begin() + 1, dq1.end(), [&sum](int v) { sum += v; });
+  assert(sum == std::accumulate(dq1.begin() + 1, dq1.end(), 0L));
+
+  //单字节类型走memset/memchr
+  mmm::deque<char> dq3(2000, 'a');
+  mmm::fill(dq3.begin() + 100, dq3.begin() + 1500, 'b');
+  assert(mmm::find(dq3.begin(), dq3.end(), 'b') - dq3.begin() == 100);
+  assert(mmm::find(dq3.begin() + 100, dq3.end(), 'a') - dq3.begin() == 1500);
+  assert(mmm::find(dq3.begin(), dq3.end(), 'z') == dq3.end());
+
+  //非平凡类型的拷贝构造
+  mmm::deque<std::string, mmm::allocator<std::string>, 64> dq4;
+  for (int i = 0; i != 300; ++i)
+    dq4.push_back(std::to_string(i));
+  auto dq5(dq4);
+  assert(mmm::equal(dq4.begin(), dq4.end(), dq5.begin()));
+  mmm::deque<std::string> dq6(100, "x");
+  assert(mmm::find(dq6.begin(), dq6.end(), "x") == dq6.begin());
+}
+void testCase11() {
+  //中间插入/删除与批量追加, 与std::deque逐步对照
+  mmm::deque<std::string, mmm::allocator<std::string>, 64> dq1;
+  std::deque<std::string> dq2;
+  std::mt19937 gen(11);
+  std::string arr[100];
+  for (int i = 0; i != 100; ++i)
+    arr[i] = std::to_string(-i);
+  mmm::list<std::string> ls(arr, arr + 37);
+
+  for (int round = 0; round != 2000; ++round) {
+    const size_t pos = dq2.empty() ? 0 : gen() % (dq2.size() + 1);
+    const size_t n = gen() % 40 + 1; // libstdc++的deque插入0个元素有问题
+    const std::string val = std::to_string(round);
+    switch (gen() % 9) {
+    case 0:
+      assert(*dq1.insert(dq1.begin() + pos, val) == val);
+      dq2.insert(dq2.begin() + pos, val);
+      break;
+    case 1:
+      dq1.insert(dq1.begin() + pos, n, val);
+      dq2.insert(dq2.begin() + pos, n, val);
+      break;
+    case 2:
+      dq1.insert(dq1.begin() + pos, arr, arr + n);
+      dq2.insert(dq2.begin() + pos, arr, arr + n);
+      break;
+    case 3:
+      dq1.insert(dq1.begin() + pos, ls.begin(), ls.end());
+      dq2.insert(dq2.begin() + pos, arr, arr + 37);
+      break;
+    case 4:
+      if (pos != dq2.size()) {
+        auto it = dq1.erase(dq1.begin() + pos);
+        dq2.erase(dq2.begin() + pos);
+        assert(it - dq1.begin() == long(pos));
+      }
+      break;
+    case 5: {
+      const size_t cnt = std::min(n * 3, dq2.size() - pos);
+      auto it = dq1.erase(dq1.begin() + pos, dq1.begin() + pos + cnt);
+      dq2.erase(dq2.begin() + pos, dq2.begin() + pos + cnt);
+      assert(it - dq1.begin() == long(pos));
+      break;
+    }
+    case 6:
+      assert(*dq1.emplace(dq1.begin() + pos, 3, 'e') == "eee");
+      dq2.emplace(dq2.begin() + pos, 3, 'e');
+      break;
+    case 7:
+      dq1.append(arr, arr + n);
+      dq2.insert(dq2.end(), arr, arr + n);
+      dq1.emplace_back(val);
+      dq2.emplace_back(val);
+      break;
+    case 8:
+      dq1.prepend(ls.begin(), ls.end());
+      dq2.insert(dq2.begin(), arr, arr + 37);
+      dq1.emplace_front(val);
+      dq2.emplace_front(val);
+      break;
+    }
+    assert(mmm::container_equal(dq1, dq2));
+  }
+
+  //整数参数走insert(pos, n, val)
+  int nums[] = {1, 2, 3, 4, 5};
+  mmm::vector<int> v(5, 1);
+  mmm::deque<int> dq3(v.begin(), v.end());
+  dq3.insert(dq3.begin() + 2, 3, 9);
+  assert(dq3.size() == 8 && dq3[2] == 9 && dq3[4] == 9 && dq3[5] == 1);
+  dq3.insert(dq3.begin() + 6, 0, 7);
+  dq3.insert(dq3.begin() + 1, nums, nums);
+  assert(dq3.size() == 8 && dq3[6] == 1);
+  mmm::deque<int> dq4(10, 10);
+  assert(dq4.size() == 10 && dq4[9] == 10);
+  mmm::deque<int> dq5(nums, nums + 5);
+  dq5.prepend(nums, nums + 2);
+  assert(dq5.size() == 7 && dq5[0] == 1 && dq5[1] == 2 && dq5[2] == 1);
+}
+//负数参数时构造抛出
+struct Strict {
+  int v;
+  explicit Strict(int x) : v(x) {
+    if (x < 0)
+      throw x;
+  }
+};
+void testCase12() {
+  //两端构造抛出: 为它新分配的块进备用链表, 不能留在map里被下一次push覆盖
+  mmm::deque<Strict> dq;
+  bool back_returned = false, front_returned = false;
+  for (int i = 0; i != 300; ++i) {
+    dq.emplace_back(i);
+    dq.emplace_front(i);
+    size_t spare = dq.spare_blocks();
+    try {
+      dq.emplace_back(-1);
+    } catch (int) {
+    }
+    back_returned |= dq.spare_blocks() > spare;
+    spare = dq.spare_blocks();
+    try {
+      dq.emplace_front(-1);
+    } catch (int) {
+    }
+    front_returned |= dq.spare_blocks() > spare;
+  }
+  assert(back_returned && front_returned);
+  assert(dq.size() == 600 && dq.back().v == 299 && dq.front().v == 299);
+}
+//第throwAt次复制时抛出
+struct Boom {
+  static int live;
+  static int throwAt;
+  int v;
+  Boom(int x = 0) : v(x) { ++live; }
+  Boom(const Boom &x) : v(x.v) {
+    if (throwAt > 0 && --throwAt == 0)
+      throw 1;
+    ++live;
+  }
+  ~Boom() { --live; }
+};
+int Boom::live = 0;
+int Boom::throwAt = 0;
+void testCase13() {
+  //批量插入中途复制抛出: 预留的块要还回去, 原有元素不变
+  typedef mmm::deque<Boom, mmm::allocator<Boom>, 16> bdeque;
+  Boom src[20];
+  for (int op = 0; op != 6; ++op) {
+    bdeque dq;
+    for (int i = 0; i != 6; ++i)
+      dq.push_back(Boom(i));
+    Boom::throwAt = 15;
+    bool thrown = false;
+    try {
+      switch (op) {
+      case 0:
+        dq.append(src, src + 20);
+        break;
+      case 1:
+        dq.prepend(src, src + 20);
+        break;
+      case 2:
+        dq.insert(dq.begin() + 1, 20, src[0]);
+        break;
+      case 3:
+        dq.insert(dq.end() - 1, 20, src[0]);
+        break;
+      case 4:
+        dq.insert(dq.begin() + 1, src, src + 20);
+        break;
+      case 5:
+        dq.insert(dq.end() - 1, src, src + 20);
+        break;
+      }
+    } catch (int) {
+      thrown = true;
+    }
+    Boom::throwAt = 0;
+    assert(thrown && dq.spare_blocks() != 0 && dq.size() == 6);
+    for (int i = 0; i != 6; ++i)
+      assert(dq[i].v == i);
+  }
+}
+
 void testAll() {
   testCase1();
   testCase2();
@@ -323,6 +655,13 @@ void testAll() {
   testCase4();
   testCase5();
   testCase6();
+  testCase7();
+  testCase8();
+  testCase9();
+  testCase10();
+  testCase11();
+  testCase12();
+  testCase13();
 }
 } // namespace DequeTest
 namespace ListTest {
@@ -578,6 +917,151 @@ void testCase15() {
   // *aaa = 1;
   // bbb = aaa;
 }
+void testCase16() {
+  //大链表排序, 与std::list对照
+  std::mt19937 gen(16);
+  std::list<int> l1;
+  mmm::list<int> l2;
+  for (auto i = 0; i != 100000; ++i) {
+    auto v = int(gen() % 1000);
+    l1.push_back(v);
+    l2.push_back(v);
+  }
+  l1.sort();
+  l2.sort();
+  assert(mmm::container_equal(l1, l2));
+  assert(*l2.begin() == l1.front() && *(--l2.end()) == l1.back());
+  //prev指针也要正确
+  auto rit = l1.rbegin();
+  for (auto it = l2.rbegin(); it != l2.rend(); ++it, ++rit)
+    assert(*it == *rit);
+
+  //稳定: 只按first比较, second保持原来的先后
+  typedef std::pair<int, int> P;
+  mmm::list<P> l3;
+  for (auto i = 0; i != 5000; ++i)
+    l3.push_back(P(int(gen() % 10), i));
+  auto by_key = [](const P &x, const P &y) { return x.first < y.first; };
+  l3.sort(by_key);
+  for (auto it = l3.begin(), next = ++l3.begin(); next != l3.end(); ++it, ++next)
+    assert(it->first < next->first ||
+           (it->first == next->first && it->second < next->second));
+
+  //merge: 整段搬运, 相等时本链表在前
+  mmm::list<P> a, b;
+  for (auto i = 0; i != 100; ++i) {
+    a.push_back(P(i / 10 * 2, i));
+    b.push_back(P(i / 20 * 4, 1000 + i));
+  }
+  a.merge(b, by_key);
+  assert(b.empty() && a.size() == 200);
+  for (auto it = a.begin(), next = ++a.begin(); next != a.end(); ++it, ++next)
+    assert(it->first < next->first ||
+           (it->first == next->first && it->second < next->second));
+}
+
+//size()在各种修改之后都与实际结点数一致
+template <class L> size_t walk_size(const L &l) {
+  size_t n = 0;
+  for (auto it = l.begin(); it != l.end(); ++it)
+    ++n;
+  return n;
+}
+void testCase17() {
+  mmm::list<std::string> ls(3, "ab");
+  std::list<std::string> rs(3, "ab");
+  assert(ls.size() == 3 && mmm::container_equal(ls, rs));
+  ls.insert(++ls.begin(), 2, "c");
+  rs.insert(++rs.begin(), 2, "c");
+  assert(ls.size() == 5 && mmm::container_equal(ls, rs));
+
+  std::mt19937 gen(3);
+  mmm::list<int> a, b;
+  std::list<int> ra, rb;
+  for (int round = 0; round != 2000; ++round) {
+    const int op = gen() % 8;
+    if (op == 0) {
+      int arr[] = {int(gen() % 100), int(gen() % 100), int(gen() % 100)};
+      a.insert(a.end(), arr, arr + 3);
+      ra.insert(ra.end(), arr, arr + 3);
+    } else if (op == 1) {
+      const size_t n = gen() % 4;
+      b.insert(b.begin(), n, int(round));
+      rb.insert(rb.begin(), n, int(round));
+    } else if (op == 2 && !a.empty()) {
+      a.erase(a.begin());
+      ra.erase(ra.begin());
+    } else if (op == 3 && !b.empty()) {
+      a.splice(a.begin(), b, b.begin());
+      ra.splice(ra.begin(), rb, rb.begin());
+    } else if (op == 4 && b.size() > 2) {
+      auto last = b.begin();
+      ++++last;
+      auto rlast = rb.begin();
+      ++++rlast;
+      a.splice(a.end(), b, b.begin(), last);
+      ra.splice(ra.end(), rb, rb.begin(), rlast);
+    } else if (op == 5 && a.size() > 3) {
+      //同一list内部移动
+      auto first = a.begin();
+      ++first;
+      auto rfirst = ra.begin();
+      ++rfirst;
+      a.splice(a.begin(), a, first, a.end());
+      ra.splice(ra.begin(), ra, rfirst, ra.end());
+    } else if (op == 6 && round % 50 == 0) {
+      a.sort();
+      b.sort();
+      ra.sort();
+      rb.sort();
+      a.merge(b);
+      ra.merge(rb);
+    } else if (op == 7) {
+      a.swap(b);
+      ra.swap(rb);
+    }
+    assert(a.size() == ra.size() && b.size() == rb.size());
+    assert(a.size() == walk_size(a) && b.size() == walk_size(b));
+  }
+  assert(mmm::container_equal(a, ra) && mmm::container_equal(b, rb));
+  a.splice(a.end(), b);
+  assert(b.size() == 0 && a.size() == ra.size() + rb.size());
+  mmm::list<int> c(a);
+  assert(c.size() == a.size() && c == a);
+  c.clear();
+  assert(c.size() == 0 && c.empty());
+}
+typedef DequeTest::Boom Boom;
+void testCase18() {
+  //批量插入中途抛出: 已构造的结点释放掉, 原链表不变
+  const int base = Boom::live;
+  {
+    mmm::list<Boom> l(2, Boom(7));
+    Boom arr[4];
+    const int before = Boom::live;
+    for (int at = 1; at <= 4; ++at) {
+      bool thrown = false;
+      Boom::throwAt = at;
+      try {
+        l.insert(l.begin(), arr, arr + 4);
+      } catch (int) {
+        thrown = true;
+      }
+      assert(thrown && Boom::live == before);
+      Boom::throwAt = at;
+      thrown = false;
+      try {
+        l.insert(l.end(), 4, arr[0]);
+      } catch (int) {
+        thrown = true;
+      }
+      assert(thrown && Boom::live == before);
+    }
+    Boom::throwAt = 0;
+    assert(l.size() == 2 && l.size() == walk_size(l) && l.front().v == 7);
+  }
+  assert(Boom::live == base);
+}
 
 void testAll() {
   testCase1();
@@ -597,6 +1081,9 @@ void testAll() {
   testCase14();
 
   testCase15();
+  testCase16();
+  testCase17();
+  testCase18();
 }
 } // namespace ListTest
 
@@ -1068,7 +1555,175 @@ void testCase1() {
 
   assert(mmm::container_equal(r1, s1));
 }
-void testAll() { testCase1(); }
+void testCase2() {
+  //有序输入O(n)建树: 各种规模下都满足红黑性质
+  typedef rbtree<int, int, mmm::less<int>, mmm::allocator<rbtree_node<int>>,
+                 mmm::identity<int>, false, true>
+      tree;
+  for (int n = 0; n != 300; ++n) {
+    std::vector<int> v(n);
+    std::iota(v.begin(), v.end(), 0);
+    tree t(v.data(), v.data() + n, mmm::less<int>());
+    assert(t.validate() && t.size() == size_t(n));
+    assert(std::equal(v.begin(), v.end(), t.begin()));
+    tree t2(sorted_unique, v.data(), v.data() + n, mmm::less<int>());
+    assert(t2.validate() && t2 == t);
+  }
+  std::vector<int> v(100000);
+  std::iota(v.begin(), v.end(), 0);
+  tree big(v.data(), v.data() + v.size(), mmm::less<int>());
+  assert(big.validate() && big.size() == v.size());
+  //建完之后照常插入/删除
+  for (int i = 0; i < 50000; i += 3)
+    big.erase(big.find(i));
+  for (int i = 200000; i != 201000; ++i)
+    big.insert(i);
+  assert(big.validate());
+
+  //无序/有重复键时退回逐个插入, 结果与std::set一致
+  std::mt19937 gen(9);
+  std::vector<int> u(5000);
+  for (auto &x : u)
+    x = int(gen() % 3000);
+  tree t3(u.data(), u.data() + u.size(), mmm::less<int>());
+  std::set<int> ref(u.begin(), u.end());
+  assert(t3.validate() && mmm::container_equal(t3, ref));
+  std::sort(u.begin(), u.end());
+  t3.assign(u.data(), u.data() + u.size());
+  assert(t3.validate() && mmm::container_equal(t3, ref));
+  t3.insert(v.data(), v.data() + 10);
+  ref.insert(v.begin(), v.begin() + 10);
+  assert(t3.validate() && mmm::container_equal(t3, ref));
+
+  //multiset: 有序且含重复键时也走批量构建, 相等元素保持输入顺序
+  mmm::multiset<int> ms(u.data(), u.data() + u.size());
+  assert(ms.validate() && ms.size() == u.size());
+  assert(std::equal(u.begin(), u.end(), ms.begin()));
+
+  // map
+  std::vector<mmm::pair<int, int>> kv;
+  for (int i = 0; i != 1000; ++i)
+    kv.push_back(mmm::pair<int, int>(i * 2, i));
+  mmm::map<int, int> m(sorted_unique, kv.data(), kv.data() + kv.size());
+  assert(m.validate() && m.size() == 1000 && m[1998] == 999);
+  assert(m.find(7) == m.end() && m.find(8)->second == 4);
+}
+void testCase3() {
+  //顺序统计: 随机插入/删除后nth/rank/count_range与有序数组一致
+  typedef mmm::order_statistic_multiset<int> os_multiset;
+  os_multiset ms;
+  std::multiset<int> ref;
+  std::mt19937 gen(47);
+  auto check = [&]() {
+    std::vector<int> v(ref.begin(), ref.end());
+    assert(ms.validate() && ms.size() == v.size());
+    for (size_t k = 0; k < v.size(); k += 7)
+      assert(*ms.nth(k) == v[k]);
+    assert(ms.nth(v.size()) == ms.end());
+    for (int key = -3; key < 1003; key += 5) {
+      size_t r = std::lower_bound(v.begin(), v.end(), key) - v.begin();
+      assert(ms.rank(key) == r);
+      size_t c = std::lower_bound(v.begin(), v.end(), key + 40) - v.begin();
+      assert(ms.count_range(key, key + 40) == c - r);
+    }
+    assert(ms.count_range(10, 10) == 0 && ms.count_range(20, 10) == 0);
+  };
+  for (int i = 0; i != 20000; ++i) {
+    int x = int(gen() % 1000);
+    if (gen() % 3 == 0) {
+      if (ms.find(x) != ms.end()) {
+        ms.erase(ms.find(x));
+        ref.erase(ref.find(x));
+      }
+    } else {
+      ms.insert(x);
+      ref.insert(x);
+    }
+    if (i % 4000 == 0)
+      check();
+  }
+  check();
+  //拷贝带上子树大小, 有序批量构建同样维护
+  os_multiset copy(ms);
+  assert(*copy.nth(ms.size() / 2) == *ms.nth(ms.size() / 2));
+  std::vector<int> v(ref.begin(), ref.end());
+  os_multiset built(v.data(), v.data() + v.size());
+  for (size_t k = 0; k != v.size(); ++k)
+    assert(*built.nth(k) == v[k]);
+  built.erase(built.begin(), built.nth(v.size() / 2));
+  assert(*built.nth(0) == v[v.size() / 2]);
+
+  // set/map: 滑动窗口中位数
+  mmm::order_statistic_set<int> s;
+  for (int i = 0; i != 1000; ++i) {
+    s.insert(i);
+    if (i >= 101)
+      s.erase(i - 101);
+    if (i >= 100)
+      assert(*s.nth(50) == i - 50);
+  }
+  mmm::order_statistic_map<int, int> m;
+  for (int i = 0; i != 100; ++i)
+    m[i * 2] = i;
+  assert(m.nth(10)->second == 10 && m.rank(21) == 11);
+  assert(m.count_range(0, 200) == 100);
+}
+void testCase4() {
+  // split/join: 切开后两边仍是合法红黑树, 再接回来与原来相同
+  typedef rbtree<int, int, mmm::less<int>, mmm::allocator<rbtree_node<int>>,
+                 mmm::identity<int>, false, true>
+      tree;
+  std::mt19937 gen(49);
+  for (int n : {0, 1, 2, 3, 10, 100, 1000, 5000}) {
+    std::set<int> ref;
+    while (ref.size() != size_t(n))
+      ref.insert(int(gen() % 100000));
+    tree t(ref.begin(), ref.end(), mmm::less<int>());
+    for (int i = 0; i != 20; ++i) {
+      const int key = int(gen() % 100010) - 5;
+      tree right;
+      right.insert(-1); // split会清掉x原有的内容
+      t.split(key, right);
+      assert(t.validate() && right.validate());
+      assert(mmm::container_equal(
+          t, std::set<int>(ref.begin(), ref.lower_bound(key))));
+      assert(mmm::container_equal(
+          right, std::set<int>(ref.lower_bound(key), ref.end())));
+      t.join(right);
+      assert(t.validate() && right.empty() && mmm::container_equal(t, ref));
+    }
+  }
+  //高度相差很大的两棵树相接
+  tree small, big;
+  for (int i = 0; i != 3; ++i)
+    small.insert(i);
+  for (int i = 10; i != 20000; ++i)
+    big.insert(i);
+  tree big2(big);
+  small.join(big);
+  assert(small.validate() && small.size() == 19993 && big.empty());
+  tree tail;
+  tail.insert(30000);
+  big2.join(tail);
+  assert(big2.validate() && big2.size() == 19991 && *big2.rbegin() == 30000);
+
+  //带子树大小: split之后nth仍正确, 元素个数直接从根读出
+  mmm::order_statistic_multiset<int> ms, rest;
+  for (int i = 0; i != 3000; ++i)
+    ms.insert(i / 3);
+  ms.split(500, rest);
+  assert(ms.validate() && rest.validate());
+  assert(ms.size() == 1500 && rest.size() == 1500);
+  assert(*ms.nth(1499) == 499 && *rest.nth(0) == 500 && rest.rank(600) == 300);
+  ms.join(rest);
+  assert(ms.size() == 3000 && *ms.nth(2999) == 999 && ms.rank(700) == 2100);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+  testCase4();
+}
 
 } // namespace RbtreeTest
 
@@ -1103,7 +1758,130 @@ void testCase1() {
       stdset.erase(stdset.find(ret));
   }
 }
-void testAll() { testCase1(); }
+//集合运算与std::set_union/set_intersection/set_difference比较,
+//覆盖规模相近(线性归并)和规模悬殊(分治/逐个查找)两种情况
+template <class Set, class StdSet> void checkAlgebra(const Set &a, const Set &b) {
+  StdSet sa(a.begin(), a.end()), sb(b.begin(), b.end());
+  std::vector<int> expect;
+  Set u(a);
+  u.unite(b);
+  std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                 std::back_inserter(expect));
+  assert(u.validate() && mmm::container_equal(u, expect));
+  expect.clear();
+  Set i(a);
+  i.intersect(b);
+  std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                        std::back_inserter(expect));
+  assert(i.validate() && mmm::container_equal(i, expect));
+  expect.clear();
+  Set d(a);
+  d.subtract(b);
+  std::set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                      std::back_inserter(expect));
+  assert(d.validate() && mmm::container_equal(d, expect));
+}
+void testCase2() {
+  std::mt19937 gen(50);
+  const int sizes[] = {0, 1, 5, 60, 1000, 20000};
+  for (int na : sizes)
+    for (int nb : sizes) {
+      mmm::set<int> a, b;
+      mmm::multiset<int> ma, mb;
+      for (int i = 0; i != na; ++i) {
+        a.insert(int(gen() % 30000));
+        ma.insert(int(gen() % 3000));
+      }
+      for (int i = 0; i != nb; ++i) {
+        b.insert(int(gen() % 30000));
+        mb.insert(int(gen() % 3000));
+      }
+      checkAlgebra<mmm::set<int>, std::set<int>>(a, b);
+      checkAlgebra<mmm::multiset<int>, std::multiset<int>>(ma, mb);
+    }
+  mmm::set<int> x{1, 2, 3, 4}, y{3, 4, 5};
+  assert(mmm::container_equal(mmm::set_union(x, y), std::set<int>{1, 2, 3, 4, 5}));
+  assert(mmm::container_equal(mmm::set_intersection(x, y), std::set<int>{3, 4}));
+  assert(mmm::container_equal(mmm::set_difference(x, y), std::set<int>{1, 2}));
+  x.unite(x);
+  x.subtract(x);
+  assert(x.empty());
+}
+//复制次数达到throwAt时抛出, live计数存活对象
+struct CopyThrows {
+  static int live;
+  static int throwAt;
+  int key;
+  CopyThrows(int k) : key(k) { ++live; }
+  CopyThrows(const CopyThrows &x) : key(x.key) {
+    if (throwAt > 0 && --throwAt == 0)
+      throw 1;
+    ++live;
+  }
+  CopyThrows(CopyThrows &&x) noexcept : key(x.key) { ++live; }
+  CopyThrows &operator=(const CopyThrows &) = default;
+  ~CopyThrows() { --live; }
+  bool operator<(const CopyThrows &x) const { return key < x.key; }
+};
+int CopyThrows::live = 0;
+int CopyThrows::throwAt = 0;
+void testCase3() {
+  //规模相近时的unite中途复制抛出: 自身保持原样, 不泄漏也不重复释放
+  {
+    mmm::set<CopyThrows> a, b;
+    for (int i = 0; i != 200; ++i) {
+      a.insert(CopyThrows(i * 2));
+      b.insert(CopyThrows(i * 3));
+    }
+    const int before = CopyThrows::live;
+    CopyThrows::throwAt = 50;
+    bool thrown = false;
+    try {
+      a.unite(b);
+    } catch (int) {
+      thrown = true;
+    }
+    CopyThrows::throwAt = 0;
+    assert(thrown && CopyThrows::live == before);
+    assert(a.validate() && a.size() == 200);
+    int k = 0;
+    for (auto it = a.begin(); it != a.end(); ++it, k += 2)
+      assert(it->key == k);
+    a.unite(b);
+    assert(a.validate() && a.size() == 200 + 200 - 67);
+  }
+  //批量插入中途复制抛出: 已构造的结点要释放, 原来的树不变
+  {
+    CopyThrows src[] = {5, 1, 4, 2, 6, 3};
+    for (int at = 1; at <= 6; ++at) {
+      CopyThrows::throwAt = at;
+      bool thrown = false;
+      try {
+        mmm::set<CopyThrows> s(src, src + 6);
+      } catch (int) {
+        thrown = true;
+      }
+      assert(thrown && CopyThrows::live == 6);
+    }
+    mmm::set<CopyThrows> s;
+    s.insert(CopyThrows(0));
+    CopyThrows::throwAt = 4;
+    bool thrown = false;
+    try {
+      s.insert(src, src + 6);
+    } catch (int) {
+      thrown = true;
+    }
+    CopyThrows::throwAt = 0;
+    assert(thrown && s.validate() && s.size() == 1 && CopyThrows::live == 7);
+  }
+  assert(CopyThrows::live == 0);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
 } // namespace SetTest
 
 namespace MapTest {
@@ -1119,9 +1897,1606 @@ void testCase1() {
   auto iter = mymap.find("ddd");
   assert(*iter == value1);
 }
-void testAll() { testCase1(); }
+void testCase2() {
+  //键相等时保留左边的值, 规模悬殊时走分治也一样
+  mmm::map<int, int> a, b;
+  for (int i = 0; i != 10000; ++i)
+    a[i * 2] = 0;
+  for (int i = 0; i != 50; ++i)
+    b[i * 3] = 1;
+  mmm::map<int, int> u = mmm::set_union(a, b);
+  assert(u.validate() && u.size() == 10025);
+  assert(u[6] == 0 && u[3] == 1 && u[9] == 1);
+  mmm::map<int, int> u2 = mmm::set_union(b, a);
+  assert(u2.validate() && u2.size() == 10025 && u2[6] == 1 && u2[8] == 0);
+  mmm::map<int, int> i = mmm::set_intersection(b, a);
+  assert(i.size() == 25 && i[0] == 1 && i[144] == 1);
+  mmm::map<int, int> d = mmm::set_difference(a, b);
+  assert(d.validate() && d.size() == 9975 && d.find(6) == d.end());
+}
+//按首字母比较, 一个字母同时等价于多个key
+struct FirstCharLess {
+  typedef int is_transparent;
+  bool operator()(const string &a, const string &b) const { return a < b; }
+  bool operator()(const string &a, char c) const { return a[0] < c; }
+  bool operator()(char c, const string &b) const { return c < b[0]; }
+};
+void testCase3() {
+  //less<>: 用const char*查找, 与std::map<string, int, std::less<>>对照
+  mmm::map<string, int, mmm::less<>> m;
+  std::map<string, int, std::less<>> sm;
+  const char *words[] = {"pear", "apple", "fig", "kiwi", "banana", "cherry"};
+  for (int i = 0; i != 6; ++i) {
+    m[words[i]] = i;
+    sm[words[i]] = i;
+  }
+  const char *probes[] = {"apple", "b", "banana", "fig", "grape", "zzz", ""};
+  for (const char *p : probes) {
+    assert(m.count(p) == sm.count(p));
+    assert(mmm::distance(m.begin(), m.lower_bound(p)) ==
+           std::distance(sm.begin(), sm.lower_bound(p)));
+    assert(mmm::distance(m.begin(), m.upper_bound(p)) ==
+           std::distance(sm.begin(), sm.upper_bound(p)));
+    auto r = m.equal_range(p);
+    assert(mmm::distance(r.first, r.second) == (ptrdiff_t)sm.count(p));
+    assert((m.find(p) == m.end()) == (sm.find(p) == sm.end()));
+  }
+  const mmm::map<string, int, mmm::less<>> &cm = m;
+  assert(cm.find("kiwi")->second == 3 && cm.count("kiwi") == 1);
+  assert(m.erase("fig") == 1 && m.erase("fig") == 0 && m.size() == 5);
+  //迭代器仍走erase(const_iterator)
+  m.erase(m.begin());
+  assert(m.begin()->first == "banana" && m.validate());
+
+  mmm::multiset<string, FirstCharLess> ms;
+  for (const char *w : {"apple", "avocado", "banana", "apricot", "cherry"})
+    ms.insert(w);
+  assert(ms.count('a') == 3 && ms.count('b') == 1 && ms.count('z') == 0);
+  assert(*ms.lower_bound('b') == "banana" && ms.upper_bound('c') == ms.end());
+  assert(ms.erase('a') == 3 && ms.size() == 2 && ms.validate());
+  mmm::set<string, FirstCharLess> s;
+  s.insert("cherry");
+  s.insert("coconut");
+  assert(s.count('c') == 2 && *s.find('c') == "cherry");
+  auto sr = s.equal_range('c');
+  assert(sr.first == s.begin() && sr.second == s.end());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
 } // namespace MapTest
 
+namespace ConcurrentVectorTest {
+void testCase1() {
+  mmm::concurrent_vector<int> v1;
+  assert(v1.empty());
+  for (int i = 0; i != 100; ++i)
+    v1.push_back(i);
+  assert(v1.size() == 100 && v1.capacity() >= 100);
+  for (int i = 0; i != 100; ++i)
+    assert(v1[i] == i);
+
+  auto it = v1.grow_by(10, 7);
+  assert(it - v1.begin() == 100 && v1.size() == 110);
+  assert(v1.back() == 7);
+
+  //已有元素的地址不会因增长而改变
+  int *p = &v1[3];
+  v1.grow_by(1000, 1);
+  assert(p == &v1[3]);
+
+  mmm::concurrent_vector<std::string> v2(5, "abc");
+  auto v3(v2);
+  assert(v2 == v3);
+  v3.push_back("def");
+  assert(v2 != v3);
+}
+void testCase2() {
+  mmm::concurrent_vector<int> v;
+  std::vector<std::thread> workers;
+  const int kThreads = 4, kPerThread = 10000;
+  for (int t = 0; t != kThreads; ++t) {
+    workers.emplace_back([&v, t] {
+      for (int i = 0; i != kPerThread; ++i) {
+        if (i % 100 == 0)
+          v.grow_by(10, t * kPerThread + i);
+        else
+          v.push_back(t * kPerThread + i);
+      }
+    });
+  }
+  for (auto &w : workers)
+    w.join();
+  assert(v.size() == size_t(kThreads) * kPerThread / 100 * 109);
+
+  std::map<int, int> seen;
+  for (auto it = v.begin(); it != v.end(); ++it)
+    ++seen[*it];
+  assert(seen.size() == size_t(kThreads) * kPerThread);
+  for (auto &kv : seen)
+    assert(kv.second == (kv.first % kPerThread % 100 == 0 ? 10 : 1));
+}
+//读出1..n的单遍输入迭代器, 各副本共享读取位置
+struct CountingInput
+    : public mmm::iterator<mmm::input_iterator_tag, int, ptrdiff_t, const int *,
+                           const int &> {
+  int *pos;
+  int last;
+  CountingInput() : pos(nullptr), last(0) {}
+  CountingInput(int *p, int n) : pos(p), last(n) { ++*pos; }
+  const int &operator*() const { return *pos; }
+  CountingInput &operator++() {
+    ++*pos;
+    return *this;
+  }
+  bool done() const { return !pos || *pos > last; }
+  bool operator==(const CountingInput &x) const { return done() == x.done(); }
+  bool operator!=(const CountingInput &x) const { return !(*this == x); }
+};
+//值为负时构造抛出
+struct Picky {
+  int value;
+  Picky(int v = 0) : value(v) {
+    if (v < 0)
+      throw v;
+  }
+};
+void testCase3() {
+  //构造抛出: 槽位以T()填上, 之后的追加照常发布, 不会卡住
+  mmm::concurrent_vector<Picky> v;
+  v.emplace_back(1);
+  bool thrown = false;
+  try {
+    v.emplace_back(-1);
+  } catch (int) {
+    thrown = true;
+  }
+  assert(thrown && v.size() == 2 && v[1].value == 0);
+  v.emplace_back(3);
+  assert(v.size() == 3 && v[2].value == 3);
+
+  //单遍输入迭代器: 从共享的源里读, 走过一次就没了
+  int source = 0;
+  mmm::concurrent_vector<int> w;
+  w.push_back(0);
+  auto it = w.grow_by(CountingInput(&source, 5), CountingInput());
+  assert(it - w.begin() == 1 && w.size() == 6 && w[5] == 5);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
+} // namespace ConcurrentVectorTest
+
+namespace SoaVectorTest {
+void testCase1() {
+  mmm::soa_vector<int, double, std::string> v;
+  assert(v.empty());
+  for (int i = 0; i != 100; ++i)
+    v.push_back(i, i * 0.5, std::to_string(i));
+  v.emplace_back(100, 50.0, "100");
+  assert(v.size() == 101);
+
+  assert(v[10].get<0>() == 10);
+  assert(v[10].get<1>() == 5.0);
+  assert(mmm::get<2>(v[10]) == "10");
+
+  //列是连续的
+  auto ids = v.column<0>();
+  assert(ids.size() == 101 && ids.data() + 100 == &v.get<0>(100));
+  long sum = 0;
+  for (auto id : ids)
+    sum += id;
+  assert(sum == 5050);
+
+  v[0] = v[100];
+  assert(v.front().get<2>() == "100");
+  v.pop_back();
+  assert(v.size() == 100 && v.back().get<0>() == 99);
+
+  auto v2(v);
+  int n = 0;
+  for (auto it = v2.begin(); it != v2.end(); ++it, ++n)
+    assert((*it).get<2>() == v.get<2>(n));
+  assert(n == 100);
+}
+void testCase2() {
+  mmm::soa_vector<int, char> v(10);
+  assert(v.size() == 10 && v.get<0>(9) == 0 && v.get<1>(9) == 0);
+  v.resize(3);
+  v.shrink_to_fit();
+  assert(v.size() == 3 && v.capacity() == 3);
+  v.clear();
+  assert(v.empty());
+}
+//计数存活对象, throwAt减到0时复制抛出
+struct Tracked {
+  static int live;
+  static int throwAt;
+  int value;
+  Tracked(int v = 0) : value(v) { ++live; }
+  Tracked(const Tracked &x) : value(x.value) {
+    if (throwAt > 0 && --throwAt == 0)
+      throw 1;
+    ++live;
+  }
+  Tracked &operator=(const Tracked &) = default;
+  ~Tracked() { --live; }
+};
+int Tracked::live = 0;
+int Tracked::throwAt = 0;
+void testCase3() {
+  //满容量时追加引用自身元素的行
+  mmm::soa_vector<std::string, int> v;
+  v.push_back(std::string(100, 'x'), 1);
+  while (v.size() != v.capacity())
+    v.push_back(v.get<0>(0), v.get<1>(0));
+  v.push_back(v.get<0>(0), v.get<1>(0));
+  assert(v.get<0>(v.size() - 1) == std::string(100, 'x'));
+
+  {
+    mmm::soa_vector<Tracked, std::string, Tracked> t;
+    for (int i = 0; i != 8; ++i)
+      t.emplace_back(i, std::to_string(i), i);
+    assert(t.size() == t.capacity() && Tracked::live == 16);
+    //扩容时第二个Tracked列复制到一半抛出: 旧内容不变, 不泄漏
+    Tracked::throwAt = 8 + 3;
+    bool thrown = false;
+    try {
+      t.emplace_back(8, "8", 8);
+    } catch (int) {
+      thrown = true;
+    }
+    assert(thrown && t.size() == 8 && Tracked::live == 16);
+    for (int i = 0; i != 8; ++i)
+      assert(t.get<0>(i).value == i && t.get<1>(i) == std::to_string(i));
+    //构造行时后面的字段抛出, 已构造的字段要析构
+    Tracked one(9);
+    Tracked::throwAt = 2;
+    thrown = false;
+    try {
+      t.push_back(one, "9", one);
+    } catch (int) {
+      thrown = true;
+    }
+    assert(thrown && t.size() == 8 && Tracked::live == 17);
+    Tracked::throwAt = 0;
+    t.push_back(one, "9", one);
+    assert(t.size() == 9 && t.get<2>(8).value == 9);
+  }
+  assert(Tracked::live == 0);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
+} // namespace SoaVectorTest
+
+namespace CircularBufferTest {
+void testCase1() {
+  //覆盖最旧的元素: 保留最近的N个
+  mmm::circular_buffer<int> cb(100);
+  std::deque<int> dq;
+  assert(cb.capacity() == 100 && cb.empty());
+  for (int i = 0; i != 1000; ++i) {
+    assert(cb.push_back(i));
+    dq.push_back(i);
+    if (dq.size() > 100)
+      dq.pop_front();
+    assert(cb.size() == dq.size() && cb.front() == dq.front() &&
+           cb.back() == dq.back());
+  }
+  assert(cb.full() && mmm::container_equal(cb, dq));
+  for (size_t i = 0; i != cb.size(); ++i)
+    assert(cb[i] == dq[i]);
+  assert(cb.end() - cb.begin() == 100 && *(cb.begin() + 50) == dq[50]);
+  assert(*cb.rbegin() == 999);
+
+  // push_front覆盖back
+  cb.push_front(-1);
+  assert(cb.front() == -1 && cb.back() == 998 && cb.size() == 100);
+  cb.pop_back();
+  cb.pop_front();
+  assert(cb.front() == 900 && cb.back() == 997 && cb.size() == 98);
+
+  bool thrown = false;
+  try {
+    cb.at(98);
+  } catch (const mmm::out_of_range &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  //缩容保留最新的元素
+  cb.set_capacity(10);
+  assert(cb.size() == 10 && cb.front() == 988 && cb.back() == 997);
+}
+void testCase2() {
+  //满时拒绝
+  mmm::circular_buffer<std::string> cb(3, mmm::overflow_policy::reject);
+  assert(cb.push_back("a") && cb.push_back("b") && cb.push_front("c"));
+  assert(!cb.push_back("d") && !cb.push_front("e"));
+  assert(cb.front() == "c" && cb.back() == "b" && cb.size() == 3);
+  auto cb2(cb);
+  assert(cb2 == cb);
+  cb.pop_front();
+  assert(cb.push_back("d") && cb.back() == "d" && cb2 != cb);
+  cb.clear();
+  assert(cb.empty());
+
+  //作为queue/stack的底层容器
+  mmm::queue<int, mmm::circular_buffer<int>> q(mmm::circular_buffer<int>(64));
+  std::queue<int> q2;
+  for (int i = 0; i != 200; ++i) {
+    q.push(i);
+    q2.push(i);
+    if (i % 3 == 0) {
+      q.pop();
+      q2.pop();
+    }
+  }
+  assert(q.size() == 64 && q.back() == q2.back());
+  //默认构造也有容量, 不会把push全丢掉
+  mmm::queue<int, mmm::circular_buffer<int>> dq;
+  dq.push(1);
+  dq.push(2);
+  assert(dq.size() == 2 && dq.front() == 1 && dq.back() == 2);
+  assert(mmm::circular_buffer<int>().capacity() ==
+         _MMM_CIRCULAR_BUFFER_CAPACITY);
+  mmm::stack<int, mmm::circular_buffer<int>> st(
+      mmm::circular_buffer<int>(8, mmm::overflow_policy::reject));
+  for (int i = 0; i != 10; ++i)
+    st.push(i);
+  assert(st.size() == 8 && st.top() == 7);
+  st.pop();
+  assert(st.top() == 6);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace CircularBufferTest
+
+namespace SpscQueueTest {
+void testCase1() {
+  mmm::spsc_queue<std::string> q(5);
+  assert(q.capacity() == 5 && q.empty() && q.front() == nullptr);
+  for (int i = 0; i != 5; ++i)
+    assert(q.try_push(std::to_string(i)));
+  assert(!q.try_push("x") && q.size() == 5);
+  std::string s;
+  assert(q.try_pop(s) && s == "0");
+  assert(*q.front() == "1");
+  q.pop();
+  std::string in[] = {"a", "b", "c"};
+  assert(q.try_push_n(in, 3) == 2 && q.size() == 5);
+  std::string out[8];
+  assert(q.try_pop_n(out, 8) == 5);
+  assert(out[0] == "2" && out[2] == "4" && out[3] == "a" && out[4] == "b");
+  assert(q.empty() && !q.try_pop(s));
+  assert(q.try_emplace(3, 'z') && *q.front() == "zzz");
+}
+void testCase2() {
+  //两个线程之间传递, 顺序不变
+  const int kCount = 200000;
+  mmm::spsc_queue<int> q(1000);
+  std::thread producer([&q, kCount] {
+    int buf[64];
+    for (int i = 0; i < kCount;) {
+      int n = 0;
+      for (; n != 64 && i + n < kCount; ++n)
+        buf[n] = i + n;
+      int done = 0;
+      while (done != n) {
+        done += q.try_push_n(buf + done, n - done);
+        if (done != n)
+          std::this_thread::yield();
+      }
+      i += n;
+    }
+  });
+  int expect = 0;
+  int buf[100];
+  while (expect != kCount) {
+    auto n = q.try_pop_n(buf, 100);
+    for (size_t k = 0; k != n; ++k)
+      assert(buf[k] == expect++);
+    if (n == 0)
+      std::this_thread::yield();
+  }
+  producer.join();
+  assert(q.empty());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace SpscQueueTest
+
+namespace MpmcQueueTest {
+void testCase1() {
+  mmm::mpmc_queue<std::string> q(5);
+  assert(q.capacity() == 8 && q.empty());
+  for (int i = 0; i != 8; ++i)
+    assert(q.try_push(std::to_string(i)));
+  assert(!q.try_push("x") && q.size() == 8);
+  std::string s;
+  for (int i = 0; i != 8; ++i) {
+    assert(q.try_pop(s) && s == std::to_string(i));
+  }
+  assert(!q.try_pop(s) && q.empty());
+  q.emplace(2, 'y');
+  q.pop(s);
+  assert(s == "yy");
+}
+void testCase2() {
+  //容量很小, 生产者和消费者都会阻塞
+  const int kProducers = 3, kConsumers = 3, kCount = 20000;
+  mmm::mpmc_queue<int> q(8);
+  std::vector<std::thread> threads;
+  std::atomic<long> sum(0);
+  std::atomic<int> popped(0);
+  for (int c = 0; c != kConsumers; ++c) {
+    threads.emplace_back([&] {
+      int v;
+      while (true) {
+        q.pop(v);
+        if (v < 0)
+          break;
+        sum += v;
+        ++popped;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p != kProducers; ++p) {
+    producers.emplace_back([&q, p, kCount] {
+      for (int i = 0; i != kCount; ++i)
+        q.push(p * kCount + i);
+    });
+  }
+  for (auto &t : producers)
+    t.join();
+  for (int c = 0; c != kConsumers; ++c)
+    q.push(-1);
+  for (auto &t : threads)
+    t.join();
+  const long n = long(kProducers) * kCount;
+  assert(popped == n && sum == n * (n - 1) / 2 && q.empty());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace MpmcQueueTest
+
+namespace MpscQueueTest {
+struct Event : public mmm::mpsc_hook {
+  int id;
+  explicit Event(int i = 0) : id(i) {}
+};
+void testCase1() {
+  Event events[10];
+  mmm::intrusive_mpsc_queue<Event> q;
+  assert(q.empty() && q.pop() == nullptr);
+  for (int i = 0; i != 10; ++i) {
+    events[i].id = i;
+    q.push(&events[i]);
+  }
+  assert(!q.empty() && q.pop()->id == 0);
+  Event *out[20];
+  assert(q.pop_batch(out, 4) == 4 && out[0]->id == 1 && out[3]->id == 4);
+  assert(q.pop_batch(out, 20) == 5 && out[4]->id == 9);
+  assert(q.empty() && q.pop() == nullptr);
+  q.push(&events[3]);
+  assert(q.pop() == &events[3] && q.empty());
+
+  mmm::mpsc_queue<std::string> q2;
+  q2.push("a");
+  q2.emplace(2, 'b');
+  std::string s;
+  assert(q2.try_pop(s) && s == "a" && q2.try_pop(s) && s == "bb");
+  assert(!q2.try_pop(s) && q2.empty());
+  q2.push("left in queue");
+
+  //节点改用加锁的内存池
+  mmm::mpsc_queue<int, mmm::locked_allocator_alloc<mmm::mpsc_value_node<int>>>
+      q3;
+  q3.push(1);
+  q3.push(2);
+  int v = 0;
+  assert(q3.try_pop(v) && v == 1 && q3.try_pop(v) && v == 2 && q3.empty());
+}
+void testCase2() {
+  //多个生产者, 每个生产者自己的元素保持先后顺序
+  const int kProducers = 4, kCount = 20000;
+  mmm::mpsc_queue<int> q;
+  std::vector<std::thread> producers;
+  for (int p = 0; p != kProducers; ++p) {
+    producers.emplace_back([&q, p, kCount] {
+      for (int i = 0; i != kCount; ++i)
+        q.push(p * kCount + i);
+    });
+  }
+  int last[kProducers] = {-1, -1, -1, -1};
+  int total = 0, buf[128];
+  while (total != kProducers * kCount) {
+    const auto n = q.pop_batch(buf, 128);
+    for (size_t i = 0; i != n; ++i) {
+      const int p = buf[i] / kCount, v = buf[i] % kCount;
+      assert(v == last[p] + 1);
+      last[p] = v;
+    }
+    total += n;
+    if (n == 0)
+      std::this_thread::yield();
+  }
+  for (auto &t : producers)
+    t.join();
+  assert(q.empty());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace MpscQueueTest
+
+namespace BlockingQueueTest {
+void testCase1() {
+  mmm::blocking_queue<std::string> q(4);
+  std::string s;
+  assert(!q.pop_wait(s, std::chrono::milliseconds(1)));
+  assert(q.push("a") && q.try_push("b") && q.size() == 2);
+  assert(q.pop_wait(s) && s == "a");
+  std::string in[] = {"c", "d", "e"};
+  assert(q.push_bulk(in, in + 3) == 3 && q.size() == 4);
+  assert(!q.try_push("f"));
+  std::string out[10];
+  assert(q.pop_bulk(out, 2) == 2 && out[0] == "b" && out[1] == "c");
+  assert(q.try_pop(s) && s == "d");
+  q.push("f");
+  q.close();
+  assert(q.closed() && !q.push("g"));
+  //关闭后已有元素仍可取出
+  assert(q.drain(out) == 2 && out[0] == "e" && out[1] == "f");
+  assert(!q.pop_wait(s) && q.pop_bulk(out, 10) == 0);
+}
+void testCase2() {
+  const int kProducers = 2, kConsumers = 2, kCount = 30000;
+  mmm::blocking_queue<int> q(64);
+  std::atomic<long> sum(0), popped(0);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c != kConsumers; ++c) {
+    consumers.emplace_back([&] {
+      int buf[50];
+      size_t n;
+      while ((n = q.pop_bulk(buf, 50)) != 0) {
+        for (size_t i = 0; i != n; ++i)
+          sum += buf[i];
+        popped += n;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p != kProducers; ++p) {
+    producers.emplace_back([&q, kCount] {
+      mmm::vector<int> v;
+      for (int i = 0; i != kCount; ++i)
+        v.push_back(i);
+      assert(q.push_bulk(v.begin(), v.end()) == size_t(kCount));
+    });
+  }
+  for (auto &t : producers)
+    t.join();
+  q.close();
+  for (auto &t : consumers)
+    t.join();
+  assert(popped == kProducers * kCount);
+  assert(sum == long(kProducers) * kCount * (kCount - 1) / 2);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace BlockingQueueTest
+
+namespace WorkStealingDequeTest {
+void testCase1() {
+  //所有者LIFO, 窃取者FIFO, 数组自动增长
+  mmm::work_stealing_deque<int> dq(4);
+  assert(dq.capacity() == 4 && dq.empty());
+  for (int i = 0; i != 100; ++i)
+    dq.push(i);
+  assert(dq.size() == 100 && dq.capacity() == 128);
+  int x;
+  assert(dq.pop(x) && x == 99);
+  assert(dq.steal(x) && x == 0);
+  assert(dq.steal(x) && x == 1);
+  for (int i = 98; i >= 2; --i)
+    assert(dq.pop(x) && x == i);
+  assert(!dq.pop(x) && !dq.steal(x) && dq.empty());
+}
+void testCase2() {
+  //所有者边push边pop, 三个窃取者同时steal, 每个元素恰好被取走一次
+  const int kCount = 100000, kThieves = 3;
+  mmm::work_stealing_deque<int> dq(8);
+  std::vector<std::atomic<int>> taken(kCount);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> thieves;
+  for (int i = 0; i != kThieves; ++i) {
+    thieves.emplace_back([&] {
+      int x;
+      while (!done.load()) {
+        if (dq.steal(x))
+          ++taken[x];
+        else
+          std::this_thread::yield();
+      }
+      while (dq.steal(x))
+        ++taken[x];
+    });
+  }
+  int x;
+  for (int i = 0; i != kCount; ++i) {
+    dq.push(i);
+    if (i % 3 == 0 && dq.pop(x))
+      ++taken[x];
+  }
+  while (dq.pop(x))
+    ++taken[x];
+  done = true;
+  for (auto &t : thieves)
+    t.join();
+  for (int i = 0; i != kCount; ++i)
+    assert(taken[i] == 1);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace WorkStealingDequeTest
+
+namespace IntrusiveListTest {
+struct item {
+  int key;
+  int id;
+  list_hook hook;
+  auto_unlink_list_hook auto_hook;
+  item(int k = 0, int i = 0) : key(k), id(i) {}
+  bool operator<(const item &other) const { return key < other.key; }
+};
+typedef intrusive_list<item, &item::hook> item_list;
+typedef intrusive_list<item, &item::auto_hook> auto_item_list;
+
+template <class List> std::vector<int> ids(const List &l) {
+  std::vector<int> v;
+  for (auto &x : l)
+    v.push_back(x.id);
+  return v;
+}
+void testCase1() {
+  //基本操作, 同一对象同时挂在两条链表上, O(1)摘除
+  std::vector<item> items;
+  for (int i = 0; i != 10; ++i)
+    items.emplace_back(i, i);
+  item_list l1;
+  auto_item_list l2;
+  for (auto &x : items) {
+    l1.push_back(x);
+    l2.push_front(x);
+  }
+  assert(l1.size() == 10 && l2.size() == 10);
+  assert(l1.front().id == 0 && l1.back().id == 9);
+  assert(l2.front().id == 9 && l2.back().id == 0);
+  assert(&*l1.iterator_to(items[3]) == &items[3]);
+  item_list::unlink(items[3]);
+  assert(!items[3].hook.is_linked() && items[3].auto_hook.is_linked());
+  l1.erase(l1.iterator_to(items[5]));
+  l1.pop_front();
+  l1.pop_back();
+  assert((ids(l1) == std::vector<int>{1, 2, 4, 6, 7, 8}));
+  std::vector<int> rev;
+  for (auto it = l1.rbegin(); it != l1.rend(); ++it)
+    rev.push_back(it->id);
+  assert((rev == std::vector<int>{8, 7, 6, 4, 2, 1}));
+  l1.insert(l1.iterator_to(items[4]), items[3]);
+  assert((ids(l1) == std::vector<int>{1, 2, 3, 4, 6, 7, 8}));
+  l1.remove_if([](const item &x) { return x.id % 2 == 0; });
+  assert((ids(l1) == std::vector<int>{1, 3, 7}));
+  l1.reverse();
+  assert((ids(l1) == std::vector<int>{7, 3, 1}));
+  l1.clear();
+  assert(l1.empty() && !items[7].hook.is_linked());
+  assert(l2.size() == 10);
+
+  // auto_unlink: 对象析构时自动离开链表
+  {
+    item tmp(100, 100);
+    l2.push_back(tmp);
+    assert(l2.size() == 11);
+  }
+  assert(l2.size() == 10 && l2.back().id == 0);
+  l2.clear();
+}
+void testCase2() {
+  // splice/swap/move
+  std::vector<item> items;
+  for (int i = 0; i != 10; ++i)
+    items.emplace_back(i, i);
+  item_list a, b;
+  for (int i = 0; i != 5; ++i)
+    a.push_back(items[i]);
+  for (int i = 5; i != 10; ++i)
+    b.push_back(items[i]);
+  a.splice(a.iterator_to(items[2]), b, b.iterator_to(items[7]));
+  assert((ids(a) == std::vector<int>{0, 1, 7, 2, 3, 4}));
+  a.splice(a.begin(), b, b.begin(), b.iterator_to(items[9]));
+  assert((ids(a) == std::vector<int>{5, 6, 8, 0, 1, 7, 2, 3, 4}));
+  assert((ids(b) == std::vector<int>{9}));
+  a.splice(a.begin(), a, a.begin());
+  a.splice(a.end(), b);
+  assert(b.empty() && a.size() == 10 && a.back().id == 9);
+  a.swap(b);
+  assert(a.empty() && b.size() == 10 && b.front().id == 5);
+  item_list c(mmm::move(b));
+  assert(b.empty() && c.size() == 10);
+  a = mmm::move(c);
+  assert(c.empty() && a.size() == 10 && a.front().id == 5);
+}
+void testCase3() {
+  // sort/merge与std::list对照, 且稳定
+  std::mt19937 gen(7);
+  const int kCount = 20000;
+  std::vector<item> items;
+  items.reserve(kCount);
+  std::list<std::pair<int, int>> ref;
+  item_list l;
+  for (int i = 0; i != kCount; ++i) {
+    items.emplace_back(int(gen() % 1000), i);
+    l.push_back(items.back());
+    ref.emplace_back(items.back().key, i);
+  }
+  l.sort();
+  ref.sort([](const std::pair<int, int> &x, const std::pair<int, int> &y) {
+    return x.first < y.first;
+  });
+  auto it = l.begin();
+  for (auto &p : ref) {
+    assert(it->key == p.first && it->id == p.second);
+    ++it;
+  }
+  assert(it == l.end());
+  int prev = -1;
+  for (auto r = l.rbegin(); r != l.rend(); ++r) {
+    assert(prev == -1 || r->key <= prev);
+    prev = r->key;
+  }
+
+  std::vector<item> more;
+  more.reserve(1000);
+  item_list l2;
+  for (int i = 0; i != 1000; ++i) {
+    more.emplace_back(int(gen() % 1000), kCount + i);
+    l2.push_back(more.back());
+  }
+  l2.sort();
+  l.merge(l2);
+  assert(l2.empty() && l.size() == size_t(kCount + 1000));
+  for (auto i = l.begin(), j = ++l.begin(); j != l.end(); ++i, ++j) {
+    assert(i->key <= j->key);
+    if (i->key == j->key && j->id < kCount)
+      assert(i->id < kCount); // l中原有的元素排在前面
+  }
+  l.sort([](const item &x, const item &y) { return x.key > y.key; });
+  assert(l.front().key >= l.back().key);
+  l.clear();
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
+} // namespace IntrusiveListTest
+
+namespace UnrolledListTest {
+template <class List> void check(const List &l, const std::vector<int> &v) {
+  assert(l.size() == v.size());
+  assert(std::equal(l.begin(), l.end(), v.begin()));
+  auto r = v.rbegin();
+  for (auto it = l.rbegin(); it != l.rend(); ++it, ++r)
+    assert(*it == *r);
+  assert(r == v.rend());
+}
+void testCase1() {
+  //随机插入/删除, 与vector对照; K取4使分裂/合并频繁发生
+  typedef unrolled_list<int, 4> ulist;
+  std::mt19937 gen(11);
+  ulist l;
+  std::vector<int> v;
+  for (int round = 0; round != 4000; ++round) {
+    const size_t pos = v.empty() ? 0 : gen() % (v.size() + 1);
+    auto it = l.begin();
+    for (size_t i = 0; i != pos; ++i)
+      ++it;
+    const int op = gen() % 10;
+    if (op < 6 || v.empty()) {
+      const int val = int(gen() % 1000);
+      auto r = l.insert(it, val);
+      v.insert(v.begin() + pos, val);
+      assert(*r == val);
+    } else if (pos < v.size()) {
+      auto r = l.erase(it);
+      v.erase(v.begin() + pos);
+      if (pos < v.size())
+        assert(*r == v[pos]);
+      else
+        assert(r == l.end());
+    }
+    if (round % 97 == 0)
+      check(l, v);
+  }
+  check(l, v);
+  l.push_front(-1);
+  l.push_back(-2);
+  v.insert(v.begin(), -1);
+  v.push_back(-2);
+  check(l, v);
+  l.pop_front();
+  l.pop_back();
+  v.erase(v.begin());
+  v.pop_back();
+  check(l, v);
+
+  //范围删除
+  auto first = l.begin(), last = l.begin();
+  for (int i = 0; i != 10; ++i)
+    ++first;
+  for (int i = 0; i != 200; ++i)
+    ++last;
+  auto r = l.erase(first, last);
+  v.erase(v.begin() + 10, v.begin() + 200);
+  assert(*r == v[10]);
+  check(l, v);
+
+  //范围插入/拷贝/交换
+  int arr[] = {7, 8, 9};
+  auto pos = l.begin();
+  ++pos;
+  l.insert(pos, arr, arr + 3);
+  v.insert(v.begin() + 1, arr, arr + 3);
+  check(l, v);
+  ulist l2(l);
+  assert(l2 == l);
+  ulist l3(5, 3);
+  check(l3, std::vector<int>(5, 3));
+  l3.swap(l2);
+  check(l3, v);
+  check(l2, std::vector<int>(5, 3));
+  l2 = ulist();
+  assert(l2.empty() && l2.begin() == l2.end());
+  ulist l4(mmm::move(l3));
+  assert(l3.empty());
+  check(l4, v);
+  l4.clear();
+  assert(l4.empty());
+}
+void testCase2() {
+  //其它节点中的元素不受插入/删除影响
+  unrolled_list<int, 8> l;
+  for (int i = 0; i != 64; ++i)
+    l.push_back(i);
+  auto it = l.begin();
+  for (int i = 0; i != 60; ++i)
+    ++it;
+  int *p = &*it;
+  for (int i = 0; i != 20; ++i)
+    l.insert(l.begin(), -i);
+  assert(*p == 60 && &*it == p);
+  l.erase(l.begin());
+  assert(*p == 60 && &*it == p);
+}
+void testCase3() {
+  //分段算法
+  unrolled_list<std::string, 4> ls;
+  std::vector<std::string> vs;
+  for (int i = 0; i != 50; ++i) {
+    ls.push_back(std::to_string(i));
+    vs.push_back(std::to_string(i));
+  }
+  assert(mmm::equal(ls.begin(), ls.end(), vs.begin()));
+  auto f = mmm::find(ls.begin(), ls.end(), std::string("33"));
+  assert(f != ls.end() && *f == "33");
+  assert(mmm::find(ls.begin(), ls.end(), std::string("x")) == ls.end());
+  size_t total = 0;
+  mmm::for_each(ls.begin(), ls.end(),
+                [&total](const std::string &s) { total += s.size(); });
+  assert(total == 90);
+
+  unrolled_list<int> l(1000, 0);
+  std::vector<int> v(1000);
+  std::iota(v.begin(), v.end(), 0);
+  auto e = mmm::copy(v.data(), v.data() + 1000, l.begin());
+  assert(e == l.end());
+  check(l, v);
+  auto mid = l.begin();
+  for (int i = 0; i != 500; ++i)
+    ++mid;
+  mmm::fill(mid, l.end(), 7);
+  std::fill(v.begin() + 500, v.end(), 7);
+  check(l, v);
+
+  //空区间写到end(): 原样返回end(), 不能跳到下一段
+  assert(mmm::copy(v.data(), v.data(), l.end()) == l.end());
+  mmm::deque<int> d(100, 1);
+  assert(mmm::copy(d.begin(), d.begin(), l.end()) == l.end());
+  assert(mmm::uninitialized_copy(v.data(), v.data(), l.end()) == l.end());
+  assert(mmm::equal(v.data(), v.data(), l.end()));
+}
+void testCase4() {
+  //构造抛出时不留下空节点
+  typedef SetTest::CopyThrows Item;
+  {
+    unrolled_list<Item, 4> l;
+    Item x(1);
+    Item::throwAt = 1;
+    bool thrown = false;
+    try {
+      l.push_back(x);
+    } catch (int) {
+      thrown = true;
+    }
+    assert(thrown && l.empty() && l.begin() == l.end());
+    for (int i = 0; i != 4; ++i)
+      l.push_back(Item(i));
+    Item::throwAt = 1;
+    thrown = false;
+    try {
+      l.push_back(x);
+    } catch (int) {
+      thrown = true;
+    }
+    Item::throwAt = 0;
+    assert(thrown && l.size() == 4);
+    int k = 0;
+    for (auto it = l.begin(); it != l.end(); ++it, ++k)
+      assert(it->key == k);
+    assert(k == 4);
+  }
+  assert(Item::live == 0);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+  testCase4();
+}
+} // namespace UnrolledListTest
+
+namespace ForwardListTest {
+template <class L> std::vector<int> to_vector(const L &l) {
+  std::vector<int> v;
+  for (auto &x : l)
+    v.push_back(x);
+  return v;
+}
+void testCase1() {
+  forward_list<int> l;
+  assert(l.empty() && l.begin() == l.end());
+  for (int i = 0; i != 5; ++i)
+    l.push_front(i);
+  assert((to_vector(l) == std::vector<int>{4, 3, 2, 1, 0}));
+  auto it = l.insert_after(l.before_begin(), 9);
+  assert(*it == 9 && l.front() == 9);
+  it = l.insert_after(it, 2, 7);
+  assert((to_vector(l) == std::vector<int>{9, 7, 7, 4, 3, 2, 1, 0}));
+  int arr[] = {5, 6};
+  it = l.insert_after(it, arr, arr + 2);
+  assert(*it == 6);
+  assert((to_vector(l) == std::vector<int>{9, 7, 7, 5, 6, 4, 3, 2, 1, 0}));
+  it = l.erase_after(l.begin());
+  assert(*it == 7);
+  auto last = it;
+  ++++++last;
+  it = l.erase_after(it, last);
+  assert(it == last);
+  assert((to_vector(l) == std::vector<int>{9, 7, 4, 3, 2, 1, 0}));
+  l.pop_front();
+  l.emplace_front(1);
+  l.remove(1);
+  assert((to_vector(l) == std::vector<int>{7, 4, 3, 2, 0}));
+  l.remove_if([](int x) { return x % 2 == 0; });
+  assert((to_vector(l) == std::vector<int>{7, 3}));
+  l.reverse();
+  assert((to_vector(l) == std::vector<int>{3, 7}));
+
+  forward_list<int> l2(3, 1);
+  forward_list<int> l3(l2);
+  assert(l2 == l3 && !(l2 < l3));
+  l3.push_front(0);
+  assert(l2 != l3 && l3 < l2);
+  l3.unique();
+  assert((to_vector(l3) == std::vector<int>{0, 1}));
+  l2.swap(l3);
+  assert((to_vector(l2) == std::vector<int>{0, 1}));
+  forward_list<int> l4(mmm::move(l2));
+  assert(l2.empty() && (to_vector(l4) == std::vector<int>{0, 1}));
+  l4.clear();
+  assert(l4.empty());
+}
+void testCase2() {
+  // splice_after
+  forward_list<int> a, b;
+  int x[] = {1, 2, 3}, y[] = {10, 20, 30, 40};
+  a.insert_after(a.before_begin(), x, x + 3);
+  b.insert_after(b.before_begin(), y, y + 4);
+  a.splice_after(a.begin(), b, b.begin()); // 20
+  assert((to_vector(a) == std::vector<int>{1, 20, 2, 3}));
+  assert((to_vector(b) == std::vector<int>{10, 30, 40}));
+  auto last = b.begin();
+  ++++last;
+  a.splice_after(a.before_begin(), b, b.before_begin(), last); // 10 30
+  assert((to_vector(a) == std::vector<int>{10, 30, 1, 20, 2, 3}));
+  assert((to_vector(b) == std::vector<int>{40}));
+  a.splice_after(a.before_begin(), b);
+  assert(b.empty() && a.front() == 40);
+  a.splice_after(a.begin(), a, a.before_begin());
+  assert((to_vector(a) == std::vector<int>{40, 10, 30, 1, 20, 2, 3}));
+}
+void testCase3() {
+  // sort/merge与std::list对照, 且稳定
+  std::mt19937 gen(5);
+  typedef std::pair<int, int> P;
+  auto by_key = [](const P &p, const P &q) { return p.first < q.first; };
+  forward_list<P> l;
+  std::list<P> ref;
+  auto tail = l.before_begin();
+  for (int i = 0; i != 50000; ++i) {
+    P p(int(gen() % 500), i);
+    tail = l.insert_after(tail, p);
+    ref.push_back(p);
+  }
+  l.sort(by_key);
+  ref.sort(by_key);
+  assert(std::equal(ref.begin(), ref.end(), l.begin()));
+
+  forward_list<P> l2;
+  std::list<P> ref2;
+  tail = l2.before_begin();
+  for (int i = 0; i != 1000; ++i) {
+    P p(int(gen() % 500), 50000 + i);
+    tail = l2.insert_after(tail, p);
+    ref2.push_back(p);
+  }
+  l2.sort(by_key);
+  ref2.sort(by_key);
+  l.merge(l2, by_key);
+  ref.merge(ref2, by_key);
+  assert(l2.empty());
+  auto it = l.begin();
+  for (auto &p : ref) {
+    assert(*it == p);
+    ++it;
+  }
+  assert(it == l.end());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+}
+} // namespace ForwardListTest
+
+namespace BtreeTest {
+// 小节点(每个节点3个值)能覆盖到分裂/合并/借值的各种情形
+template <class BT, class REF> void check(const BT &bt, const REF &ref) {
+  assert(bt.validate());
+  assert(bt.size() == ref.size());
+  auto it = bt.begin();
+  for (auto &v : ref) {
+    assert((*it).first == v.first && (*it).second == v.second);
+    ++it;
+  }
+  assert(it == bt.end());
+  for (auto rit = ref.rbegin(); rit != ref.rend(); ++rit) {
+    --it;
+    assert((*it).first == rit->first);
+  }
+  assert(it == bt.begin());
+}
+template <size_t NodeSize> void randomMap(unsigned seed) {
+  std::mt19937 gen(seed);
+  btree_map<int, int, mmm::less<int>, NodeSize> bt;
+  std::map<int, int> ref;
+  for (int i = 0; i != 20000; ++i) {
+    int k = int(gen() % 3000);
+    switch (gen() % 6) {
+    case 0:
+    case 1: {
+      auto r = bt.insert(mmm::pair<const int, int>(k, i));
+      auto e = ref.insert(std::make_pair(k, i));
+      assert(r.second == e.second && (*r.first).first == k &&
+             (*r.first).second == e.first->second);
+      break;
+    }
+    case 2: {
+      //hint: 一半给正确位置, 一半给随机位置
+      auto h = bt.lower_bound(gen() % 2 ? k : int(gen() % 3000));
+      auto it = bt.insert(h, mmm::pair<const int, int>(k, i));
+      ref.insert(std::make_pair(k, i));
+      assert((*it).first == k && (*it).second == ref[k]);
+      break;
+    }
+    case 3: {
+      auto it = bt.find(k);
+      auto e = ref.find(k);
+      assert((it == bt.end()) == (e == ref.end()));
+      if (e != ref.end()) {
+        auto next = bt.erase(it);
+        e = ref.erase(e);
+        assert(e == ref.end() ? next == bt.end() : (*next).first == e->first);
+      }
+      break;
+    }
+    case 4:
+      assert(bt.erase(k) == ref.erase(k));
+      break;
+    case 5: {
+      bt[k] += 1;
+      ref[k] += 1;
+      auto lb = bt.lower_bound(k + 1), ub = bt.upper_bound(k);
+      assert(lb == ub);
+      auto e = ref.upper_bound(k);
+      assert(e == ref.end() ? ub == bt.end() : (*ub).first == e->first);
+      break;
+    }
+    }
+    if (i % 1000 == 0)
+      check(bt, ref);
+  }
+  check(bt, ref);
+  //从前/从后/从中间整段删除
+  while (!ref.empty()) {
+    int n = int(gen() % 200);
+    auto b = bt.begin();
+    auto e = ref.begin();
+    if (gen() % 2) {
+      b = bt.lower_bound(ref.rbegin()->first);
+      e = --ref.end();
+    }
+    auto bl = b;
+    auto el = e;
+    for (; n && el != ref.end(); --n, ++el, ++bl)
+      ;
+    auto it = bt.erase(b, bl);
+    ref.erase(e, el);
+    assert(el == ref.end() ? it == bt.end() : (*it).first == el->first);
+    check(bt, ref);
+  }
+  assert(bt.empty() && bt.begin() == bt.end());
+}
+void testCase1() {
+  randomMap<64>(1);
+  randomMap<128>(2);
+  randomMap<_MMM_BTREE_NODE_SIZE>(3);
+  randomMap<4096>(4);
+
+  //顺序插入时节点是满的
+  btree_map<int, int> m;
+  for (int i = 0; i != 100000; ++i)
+    m.insert(m.end(), mmm::pair<const int, int>(i, i));
+  assert(m.validate() && m.size() == 100000);
+  for (int i = 0; i < 100000; i += 7)
+    assert(m.at(i) == i);
+  assert(m.find(100000) == m.end() && m.count(5) == 1);
+  btree_map<int, int> m2(m);
+  assert(m2 == m && !(m2 < m));
+  m2.erase(99999);
+  assert(m2 != m && m2 < m);
+  m2 = mmm::move(m);
+  assert(m2.size() == 100000 && m.empty());
+  //移动赋值给自己: 内容不变
+  btree_map<int, int> &self = m2;
+  m2 = mmm::move(self);
+  assert(m2.validate() && m2.size() == 100000 && m2.at(7) == 7);
+}
+void testCase2() {
+  // multimap: 等值元素保持插入顺序
+  std::mt19937 gen(7);
+  btree_multimap<int, int, mmm::less<int>, 64> bt;
+  std::multimap<int, int> ref;
+  for (int i = 0; i != 20000; ++i) {
+    int k = int(gen() % 300);
+    if (gen() % 4) {
+      if (gen() % 2) {
+        bt.insert(mmm::pair<const int, int>(k, i));
+      } else {
+        auto h = bt.upper_bound(k);
+        bt.insert(h, mmm::pair<const int, int>(k, i));
+      }
+      ref.insert(std::make_pair(k, i));
+    } else {
+      assert(bt.count(k) == ref.count(k));
+      assert(bt.erase(k) == ref.erase(k));
+    }
+    if (i % 1000 == 0)
+      check(bt, ref);
+  }
+  check(bt, ref);
+  for (int k = 0; k != 300; ++k) {
+    auto r = bt.equal_range(k);
+    auto e = ref.equal_range(k);
+    assert(size_t(mmm::distance(r.first, r.second)) ==
+           size_t(std::distance(e.first, e.second)));
+    for (; e.first != e.second; ++e.first, ++r.first)
+      assert((*r.first).second == e.first->second);
+  }
+}
+void testCase3() {
+  std::vector<int> v;
+  for (int i = 0; i != 5000; ++i)
+    v.push_back(i * 2);
+  btree_set<int> s(sorted_unique, v.begin(), v.end());
+  assert(s.validate() && s.size() == 5000);
+  btree_set<int> s2(v.rbegin(), v.rend());
+  assert(s2.validate() && s == s2);
+  assert(*s.lower_bound(3) == 4 && *s.upper_bound(4) == 6);
+  assert(s.lower_bound(9999) == s.end());
+  assert(!s.insert(10).second && s.insert(11).second);
+  assert(*s.erase(s.find(11)) == 12);
+  auto rit = s.rbegin();
+  assert(*rit == 9998 && *++rit == 9996);
+
+  btree_multiset<int> ms{3, 1, 3, 2, 3};
+  assert(ms.count(3) == 3 && ms.size() == 5 && *ms.begin() == 1);
+  ms.erase(ms.lower_bound(3), ms.end());
+  assert(ms.size() == 2 && ms.validate());
+
+  btree_map<std::string, int> sm{{"b", 2}, {"a", 1}};
+  sm["c"] = 3;
+  assert(sm.size() == 3 && sm.at("a") == 1 && (*sm.begin()).first == "a");
+  sm.clear();
+  assert(sm.empty() && sm.validate());
+}
+void testCase4() {
+  //插到叶子中间时复制抛出: 节点里不留空洞, 存活对象不多不少
+  typedef SetTest::CopyThrows Item;
+  {
+    btree_set<Item> s;
+    for (int i = 0; i != 1000; ++i)
+      s.insert(Item(i * 2));
+    const int before = Item::live;
+    const Item item(501);
+    Item::throwAt = 1;
+    bool thrown = false;
+    try {
+      s.insert(item);
+    } catch (int) {
+      thrown = true;
+    }
+    Item::throwAt = 0;
+    assert(thrown && Item::live == before + 1);
+    assert(s.validate() && s.size() == 1000);
+    int k = 0;
+    for (auto it = s.begin(); it != s.end(); ++it, k += 2)
+      assert(it->key == k);
+    s.insert(item);
+    assert(s.size() == 1001 && s.find(item) != s.end());
+  }
+  assert(Item::live == 0);
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+  testCase4();
+}
+} // namespace BtreeTest
+
+namespace FlatMapTest {
+void testCase1() {
+  // 与std::map对照: 单个插入/hint/删除/查找/上下界
+  std::mt19937 gen(11);
+  flat_map<int, int> fm;
+  std::map<int, int> ref;
+  for (int i = 0; i != 20000; ++i) {
+    int k = int(gen() % 2000);
+    switch (gen() % 5) {
+    case 0: {
+      auto r = fm.insert(mmm::pair<int, int>(k, i));
+      auto e = ref.insert(std::make_pair(k, i));
+      assert(r.second == e.second && (*r.first).second == e.first->second);
+      break;
+    }
+    case 1: {
+      auto it = fm.insert(fm.lower_bound(gen() % 2 ? k : int(gen() % 2000)),
+                          mmm::pair<int, int>(k, i));
+      ref.insert(std::make_pair(k, i));
+      assert(it->first == k && it->second == ref[k]);
+      break;
+    }
+    case 2:
+      assert(fm.erase(k) == ref.erase(k));
+      break;
+    case 3:
+      fm[k] += 1;
+      ref[k] += 1;
+      break;
+    case 4: {
+      auto lb = fm.lower_bound(k), ub = fm.upper_bound(k);
+      auto elb = ref.lower_bound(k), eub = ref.upper_bound(k);
+      assert(elb == ref.end() ? lb == fm.end() : lb->first == elb->first);
+      assert(eub == ref.end() ? ub == fm.end() : ub->first == eub->first);
+      assert(fm.count(k) == ref.count(k) && fm.contains(k) == (ref.count(k) == 1));
+      break;
+    }
+    }
+  }
+  assert(fm.size() == ref.size());
+  auto it = fm.begin();
+  for (auto &p : ref) {
+    assert((*it).first == p.first && (*it).second == p.second);
+    ++it;
+  }
+  assert(it == fm.end() && fm.end() - fm.begin() == (ptrdiff_t)ref.size());
+  auto rit = fm.rbegin();
+  assert((*rit).first == ref.rbegin()->first);
+}
+void testCase2() {
+  // 批量插入: 原有的key优先, 新的里面先出现的优先
+  std::mt19937 gen(12);
+  flat_map<int, int> fm{{5, 0}, {1, 0}, {9, 0}};
+  std::map<int, int> ref{{5, 0}, {1, 0}, {9, 0}};
+  for (int round = 0; round != 20; ++round) {
+    std::vector<mmm::pair<int, int>> batch;
+    for (int i = 0; i != 500; ++i) {
+      mmm::pair<int, int> p(int(gen() % 5000), round * 1000 + i);
+      batch.push_back(p);
+      ref.insert(std::make_pair(p.first, p.second));
+    }
+    fm.insert(batch.begin(), batch.end());
+    assert(fm.size() == ref.size());
+    auto it = fm.begin();
+    for (auto &p : ref) {
+      assert(it->first == p.first && it->second == p.second);
+      ++it;
+    }
+  }
+  //有序且都在末尾的一段不用归并
+  std::vector<mmm::pair<int, int>> tail;
+  for (int i = 0; i != 100; ++i)
+    tail.push_back(mmm::pair<int, int>(10000 + i, i));
+  fm.insert(sorted_unique, tail.begin(), tail.end());
+  assert(fm.at(10099) == 99 && (fm.end() - 1)->first == 10099);
+
+  // sorted_unique构造与extract/replace
+  mmm::vector<int> keys, values;
+  for (int i = 0; i != 1000; ++i) {
+    keys.push_back(i * 3);
+    values.push_back(i);
+  }
+  flat_map<int, int> fm2(sorted_unique, keys, values);
+  assert(fm2.size() == 1000 && fm2.at(2997) == 999 && fm2.find(1) == fm2.end());
+  auto c = fm2.extract();
+  assert(fm2.empty() && c.keys.size() == 1000 && c.values[10] == 10);
+  fm2.replace(mmm::move(c.keys), mmm::move(c.values));
+  assert(fm2.size() == 1000 && fm2[3] == 1);
+  flat_map<int, int> fm3(fm2);
+  assert(fm3 == fm2);
+  fm3.erase(fm3.begin(), fm3.begin() + 10);
+  assert(fm3 != fm2 && fm3.begin()->first == 30);
+}
+void testCase3() {
+  std::mt19937 gen(13);
+  std::vector<int> v;
+  for (int i = 0; i != 10000; ++i)
+    v.push_back(int(gen() % 3000));
+  flat_set<int, mmm::greater<int>> fs(v.begin(), v.end());
+  std::set<int, std::greater<int>> ref(v.begin(), v.end());
+  assert(fs.size() == ref.size() && std::equal(ref.begin(), ref.end(), fs.begin()));
+  for (int k = -1; k != 3001; ++k) {
+    assert((fs.find(k) != fs.end()) == (ref.count(k) == 1));
+    auto lb = ref.lower_bound(k), ub = ref.upper_bound(k);
+    assert(fs.lower_bound(k) - fs.begin() == std::distance(ref.begin(), lb));
+    assert(fs.upper_bound(k) - fs.begin() == std::distance(ref.begin(), ub));
+  }
+  assert(!fs.insert(*fs.begin()).second);
+  fs.erase(fs.begin() + 5, fs.end() - 5);
+  assert(fs.size() == 10);
+  auto keys = fs.extract();
+  assert(fs.empty() && keys.size() == 10);
+  flat_set<int, mmm::greater<int>> fs2(sorted_unique, keys);
+  assert(fs2.size() == 10 && *fs2.begin() == *ref.begin());
+
+  flat_set<int> a{3, 1, 2}, b{1, 2, 3, 3};
+  assert(a == b && !(a < b));
+  assert(a.erase(2) == 1 && a.erase(2) == 0 && a != b && b < a);
+}
+//统计拷贝次数, 移动不计
+struct CountCopies {
+  static int copies;
+  int v;
+  CountCopies(int x = 0) : v(x) {}
+  CountCopies(const CountCopies &x) : v(x.v) { ++copies; }
+  CountCopies(CountCopies &&x) noexcept : v(x.v) {}
+  CountCopies &operator=(const CountCopies &x) {
+    v = x.v;
+    ++copies;
+    return *this;
+  }
+  bool operator<(const CountCopies &x) const { return v < x.v; }
+};
+int CountCopies::copies = 0;
+void testCase4() {
+  //批量插入的归并只移动元素, 拷贝只发生在把输入追加进来时
+  flat_map<int, CountCopies> m;
+  flat_set<CountCopies> s;
+  m.reserve(200);
+  s.reserve(200);
+  for (int i = 0; i != 100; ++i) {
+    m.insert(mmm::pair<const int, CountCopies>(i * 2, CountCopies(i)));
+    s.insert(CountCopies(i * 2));
+  }
+  //flat_set的新段会原地排序, 这里给有序的输入, 只看归并
+  std::vector<mmm::pair<const int, CountCopies>> in;
+  std::vector<CountCopies> ins;
+  for (int i = 0; i != 10; ++i) {
+    in.push_back(mmm::pair<const int, CountCopies>(181 - i * 20, CountCopies(9 - i)));
+    ins.push_back(CountCopies(i * 20 + 1));
+  }
+  CountCopies::copies = 0;
+  m.insert(in.begin(), in.end());
+  s.insert(ins.begin(), ins.end());
+  assert(CountCopies::copies == 20);
+  assert(m.size() == 110 && m.find(21)->second.v == 1);
+  assert(s.size() == 110 && s.find(CountCopies(181)) != s.end());
+
+  //插key抛出时撤掉已插的值, 两个数组一样长
+  flat_map<SetTest::CopyThrows, int> fm;
+  for (int i = 0; i != 10; ++i)
+    fm[SetTest::CopyThrows(i * 2)] = i;
+  SetTest::CopyThrows::throwAt = 1;
+  bool thrown = false;
+  try {
+    fm[SetTest::CopyThrows(5)] = 5;
+  } catch (int) {
+    thrown = true;
+  }
+  SetTest::CopyThrows::throwAt = 0;
+  assert(thrown && fm.size() == 10 && fm.keys().size() == fm.values().size());
+  assert(fm.find(SetTest::CopyThrows(5)) == fm.end() &&
+         fm.find(SetTest::CopyThrows(6))->second == 3);
+
+  //批量插入中途抛出: 截回原来的长度, 不留下未排序的尾部
+  typedef SetTest::CopyThrows Item;
+  flat_map<int, Item> im;
+  flat_set<Item> is;
+  for (int i = 0; i != 10; ++i) {
+    im.insert(mmm::pair<const int, Item>(i * 2, Item(i)));
+    is.insert(Item(i * 2));
+  }
+  std::vector<mmm::pair<const int, Item>> bad;
+  std::vector<Item> bads;
+  for (int k : {7, 3, 1}) {
+    bad.push_back(mmm::pair<const int, Item>(k, Item(k)));
+    bads.push_back(Item(k));
+  }
+  Item::throwAt = 2;
+  thrown = false;
+  try {
+    im.insert(bad.begin(), bad.end());
+  } catch (int) {
+    thrown = true;
+  }
+  assert(thrown && im.keys().size() == 10 && im.values().size() == 10);
+  Item::throwAt = 3;
+  thrown = false;
+  try {
+    is.insert(bads.begin(), bads.end());
+  } catch (int) {
+    thrown = true;
+  }
+  Item::throwAt = 0;
+  assert(thrown && is.size() == 10);
+  assert(im.find(7) == im.end() && im.find(8)->second.key == 4);
+  assert(is.find(Item(3)) == is.end() && is.find(Item(8)) != is.end());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+  testCase3();
+  testCase4();
+}
+} // namespace FlatMapTest
+
+namespace IntervalMapTest {
+struct Ref {
+  int low, high, value;
+};
+//与暴力扫描比较: 相交区间的集合相同
+void checkOverlap(const interval_map<int, int> &m, const std::vector<Ref> &ref,
+                  int low, int high) {
+  std::multiset<std::pair<int, int>> expect, got;
+  for (const Ref &r : ref)
+    if (!(r.high < low) && !(high < r.low))
+      expect.insert(std::make_pair(r.low, r.value));
+  int prevLow = -1;
+  m.for_each_overlap(low, high,
+                     [&](const mmm::pair<const interval<int>, int> &v) {
+                       assert(prevLow <= v.first.low); //按low升序
+                       prevLow = v.first.low;
+                       got.insert(std::make_pair(v.first.low, v.second));
+                     });
+  assert(got == expect);
+  assert(m.count_overlaps(low, high) == expect.size());
+  auto it = m.find_overlap(low, high);
+  assert((it == m.end()) == expect.empty());
+  if (it != m.end())
+    assert(!(it->first.high < low) && !(high < it->first.low));
+}
+void testCase1() {
+  interval_map<int, int> m;
+  std::vector<Ref> ref;
+  std::mt19937 gen(48);
+  for (int i = 0; i != 5000; ++i) {
+    int low = int(gen() % 100000), len = int(gen() % 500);
+    m.insert(low, low + len, i);
+    ref.push_back(Ref{low, low + len, i});
+  }
+  assert(m.validate() && m.size() == ref.size());
+  for (int i = 0; i != 300; ++i) {
+    int low = int(gen() % 101000), len = int(gen() % 2000);
+    checkOverlap(m, ref, low, low + len);
+    checkOverlap(m, ref, low, low); //穿刺
+  }
+  //随机删除一半后最大端点仍然正确
+  for (int i = 0; i != 2500; ++i) {
+    size_t k = gen() % ref.size();
+    auto it = m.lower_bound(interval<int>(ref[k].low, ref[k].high));
+    while (it->second != ref[k].value)
+      ++it;
+    m.erase(it);
+    ref[k] = ref.back();
+    ref.pop_back();
+  }
+  assert(m.validate() && m.size() == ref.size());
+  for (int i = 0; i != 300; ++i) {
+    int low = int(gen() % 101000), len = int(gen() % 2000);
+    checkOverlap(m, ref, low, low + len);
+  }
+  //拷贝后的结点记录的是自己树里的结点
+  interval_map<int, int> copy(m);
+  m.clear();
+  assert(copy.validate());
+  checkOverlap(copy, ref, 0, 200000);
+  checkOverlap(copy, ref, 5000, 6000);
+}
+void testCase2() {
+  interval_map<int, std::string> m;
+  m.insert(1, 5, "a");
+  m.insert(3, 3, "b");
+  m.insert(10, 20, "c");
+  m.insert(1, 5, "d");
+  std::string hit;
+  m.for_each_stab(3, [&](mmm::pair<const interval<int>, std::string> &v) {
+    hit += v.second;
+    v.second += "!";
+  });
+  assert(hit.size() == 3 && m.count_overlaps(6, 9) == 0);
+  assert(m.find_overlap(6, 9) == m.end());
+  assert(m.find_overlap(20, 30)->second == "c");
+  assert(m.erase(interval<int>(1, 5)) == 2 && m.size() == 2);
+  assert(m.begin()->second == "b!" && m.validate());
+}
+void testAll() {
+  testCase1();
+  testCase2();
+}
+} // namespace IntervalMapTest
+
 } // namespace mmm
 
 int main() {
@@ -1138,5 +3513,19 @@ int main() {
   mmm::SetTest::testAll();
   mmm::MapTest::testAll();
 
+  mmm::ConcurrentVectorTest::testAll();
+  mmm::SoaVectorTest::testAll();
+  mmm::CircularBufferTest::testAll();
+  mmm::SpscQueueTest::testAll();
+  mmm::MpmcQueueTest::testAll();
+  mmm::MpscQueueTest::testAll();
+  mmm::BlockingQueueTest::testAll();
+  mmm::WorkStealingDequeTest::testAll();
+  mmm::IntrusiveListTest::testAll();
+  mmm::UnrolledListTest::testAll();
+  mmm::ForwardListTest::testAll();
+  mmm::BtreeTest::testAll();
+  mmm::FlatMapTest::testAll();
+  mmm::IntervalMapTest::testAll();
   std::cout << "finish test" << std::endl;
 }
\ No newline at end of file
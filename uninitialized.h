@@ -9,45 +9,128 @@
 
 namespace mmm{
 
-	/*** uninitialized_copy: [first,last) to result .考虑平凡类型 *****/
+	/*** uninitialized_copy: [first,last) to result .考虑平凡类型及分段迭代器 *****/
 	//返回指向最后复制的元素后一元素的迭代器
+	//分段迭代器(如deque)按块拆开, 每块落到指针到指针的复制: 平凡类型memcpy, 否则逐个构造.
 	template<class InputIterator, class ForwardIterator>
-	ForwardIterator _uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest, true_type){
-		memcpy(dest, first, (last - first) * sizeof(*first));
-		return dest + (last - first);
+	ForwardIterator _uninitialized_copy_loop(InputIterator first, InputIterator last, ForwardIterator dest){
+		for (; first != last; ++first, ++dest){
+			construct(&*dest, *first);
+		}
+		return dest;
+	}
+	template<class T>
+	T* _uninitialized_copy_trivial(const T* first, const T* last, T* dest, true_type){
+		const size_t n = last - first;
+		if (n != 0)
+			memcpy(dest, first, n * sizeof(T));
+		return dest + n;
+	}
+	template<class T>
+	T* _uninitialized_copy_trivial(const T* first, const T* last, T* dest, false_type){
+		return _uninitialized_copy_loop(first, last, dest);
 	}
 	template<class InputIterator, class ForwardIterator>
-	ForwardIterator _uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest, false_type){
-		int i = 0;
-		while(first != last){
-			construct((dest + i), *first);
-			++first;
-			++i;
+	ForwardIterator _uninitialized_copy_leaf(InputIterator first, InputIterator last, ForwardIterator dest){
+		return _uninitialized_copy_loop(first, last, dest);
+	}
+	template<class T>
+	T* _uninitialized_copy_leaf(const T* first, const T* last, T* dest){
+		return _uninitialized_copy_trivial(first, last, dest, is_pod<T>());
+	}
+	template<class T>
+	T* _uninitialized_copy_leaf(T* first, T* last, T* dest){
+		return _uninitialized_copy_trivial<T>(first, last, dest, is_pod<T>());
+	}
+
+	//目标为分段迭代器: 输入可随机访问时一次填满一个目标块
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator _uninitialized_copy_out_seg(InputIterator first, InputIterator last, ForwardIterator dest, input_iterator_tag){
+		return _uninitialized_copy_loop(first, last, dest);
+	}
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator _uninitialized_copy_out_seg(InputIterator first, InputIterator last, ForwardIterator dest, random_access_iterator_tag){
+		typedef segmented_iterator_traits<ForwardIterator> traits;
+		//空区间直接返回: dest可能是end(), 其段为空, 进循环会走到下一段
+		if (first == last)
+			return dest;
+		auto seg = traits::segment(dest);
+		auto local = traits::local(dest);
+		while (true){
+			const auto n = last - first;
+			const auto room = traits::end(seg) - local;
+			if (n < room)
+				return traits::compose(seg, _uninitialized_copy_leaf(first, last, local));
+			_uninitialized_copy_leaf(first, first + room, local);
+			first += room;
+			++seg;
+			local = traits::begin(seg);
+			if (first == last)
+				return traits::compose(seg, local);
 		}
-		return (dest + i);
+	}
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator _uninitialized_copy_out(InputIterator first, InputIterator last, ForwardIterator dest, false_type){
+		return _uninitialized_copy_leaf(first, last, dest);
+	}
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator _uninitialized_copy_out(InputIterator first, InputIterator last, ForwardIterator dest, true_type){
+		return _uninitialized_copy_out_seg(first, last, dest, iterator_category<InputIterator>());
 	}
 
 	template<class InputIterator, class ForwardIterator>
-	ForwardIterator uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest){
-			return _uninitialized_copy(first, last, dest, is_pod<iterator_value_type<InputIterator>>());
+	ForwardIterator _uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest, false_type){
+		return _uninitialized_copy_out(first, last, dest, is_segmented_iterator<ForwardIterator>());
+	}
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator _uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest, true_type){
+		typedef segmented_iterator_traits<InputIterator> traits;
+		auto sf = traits::segment(first), sl = traits::segment(last);
+		if (sf == sl)
+			return _uninitialized_copy(traits::local(first), traits::local(last), dest, false_type());
+		dest = _uninitialized_copy(traits::local(first), traits::end(sf), dest, false_type());
+		for (++sf; sf != sl; ++sf)
+			dest = _uninitialized_copy(traits::begin(sf), traits::end(sf), dest, false_type());
+		return _uninitialized_copy(traits::begin(sl), traits::local(last), dest, false_type());
 	}
 
-	/****uninitialized_fill: [first,last) with value 考虑平凡类型****/
+	template<class InputIterator, class ForwardIterator>
+	ForwardIterator uninitialized_copy(InputIterator first, InputIterator last, ForwardIterator dest){
+		return _uninitialized_copy(first, last, dest, is_segmented_iterator<InputIterator>());
+	}
 
+	/****uninitialized_fill: [first,last) with value 考虑平凡类型及分段迭代器****/
 
 	template<class ForwardIterator, class T>
-	void _uninitialized_fill(ForwardIterator first, ForwardIterator last, const T& value, true_type){
+	void _uninitialized_fill_leaf(ForwardIterator first, ForwardIterator last, const T& value, true_type){
 		 fill(first, last, value);
 	}
 	template<class ForwardIterator, class T>
-	void _uninitialized_fill(ForwardIterator first, ForwardIterator last, const T& value, false_type){
+	void _uninitialized_fill_leaf(ForwardIterator first, ForwardIterator last, const T& value, false_type){
 		for (; first != last; ++first){
-			construct(first, value);
+			construct(&*first, value);
+		}
+	}
+	template<class ForwardIterator, class T>
+	void _uninitialized_fill(ForwardIterator first, ForwardIterator last, const T& value, false_type){
+		_uninitialized_fill_leaf(first, last, value, is_pod<T>());
+	}
+	template<class ForwardIterator, class T>
+	void _uninitialized_fill(ForwardIterator first, ForwardIterator last, const T& value, true_type){
+		typedef segmented_iterator_traits<ForwardIterator> traits;
+		auto sf = traits::segment(first), sl = traits::segment(last);
+		if (sf == sl){
+			_uninitialized_fill_leaf(traits::local(first), traits::local(last), value, is_pod<T>());
+			return;
 		}
+		_uninitialized_fill_leaf(traits::local(first), traits::end(sf), value, is_pod<T>());
+		for (++sf; sf != sl; ++sf)
+			_uninitialized_fill_leaf(traits::begin(sf), traits::end(sf), value, is_pod<T>());
+		_uninitialized_fill_leaf(traits::begin(sl), traits::local(last), value, is_pod<T>());
 	}
 	template<class ForwardIterator, class T>
 	void uninitialized_fill(ForwardIterator first, ForwardIterator last, const T& value){
-		_uninitialized_fill(first, last, value, is_pod<T>());
+		_uninitialized_fill(first, last, value, is_segmented_iterator<ForwardIterator>());
 	}
 
 
@@ -0,0 +1,456 @@
+#ifndef _UNROLLED_LIST_H_
+#define _UNROLLED_LIST_H_
+
+#include "algorithm.h"
+#include "allocator.h"
+#include "iterator.h"
+#include "type_traits.h"
+#include "utility.h"
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+//默认节点大小(字节), 每个节点的元素个数K由此推出(至少为4)
+#ifndef _MMM_UNROLLED_NODE_SIZE
+#define _MMM_UNROLLED_NODE_SIZE 256
+#endif
+
+// unrolled_list: 展开链表. 每个节点是一小段数组, 最多存K个元素,
+// 节点之间仍是双向循环链表. 遍历在节点内是顺序访问, 每K个元素才跳一次指针.
+// 插入: 节点未满时在节点内挪动; 已满时分裂成两个半满的节点.
+// 删除: 节点空了就释放; 不足半满且能放下后继时与后继合并.
+// 迭代器稳定性: 插入/删除只会移动所在节点(分裂/合并时还有相邻的一个节点)里的元素,
+// 其它节点的元素地址和迭代器都保持有效.
+namespace Detail {
+struct unrolled_node_base {
+  unrolled_node_base *prev;
+  unrolled_node_base *next;
+  size_t count; //元素个数, 只有哨兵为0
+};
+template <class T, size_t K> struct unrolled_node : public unrolled_node_base {
+  alignas(T) unsigned char storage[K * sizeof(T)];
+  T *data() { return reinterpret_cast<T *>(storage); }
+};
+constexpr size_t unrolled_list_default_k(size_t size) {
+  return (_MMM_UNROLLED_NODE_SIZE - sizeof(unrolled_node_base)) / size < 4
+             ? 4
+             : (_MMM_UNROLLED_NODE_SIZE - sizeof(unrolled_node_base)) / size;
+}
+} // namespace Detail
+
+// 迭代器: (节点, 节点内下标). end()是(哨兵, 0)
+template <class T, size_t K, class Ref, class Ptr>
+struct unrolled_list_iterator {
+public:
+  typedef ptrdiff_t difference_type;
+  typedef mmm::bidirectional_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef Detail::unrolled_node_base *base_ptr;
+  typedef Detail::unrolled_node<T, K> *node_ptr;
+  typedef unrolled_list_iterator<T, K, T &, T *> iterator;
+  typedef unrolled_list_iterator self;
+
+  base_ptr node_;
+  size_t index_;
+
+public:
+  unrolled_list_iterator(base_ptr n = nullptr, size_t i = 0)
+      : node_(n), index_(i) {}
+  //只接受非const迭代器; 写成模板, 不顶替隐式的拷贝构造/赋值
+  template <class R, class P,
+            class = typename std::enable_if<std::is_same<
+                unrolled_list_iterator<T, K, R, P>, iterator>::value>::type>
+  unrolled_list_iterator(const unrolled_list_iterator<T, K, R, P> &other)
+      : node_(other.node_), index_(other.index_) {}
+
+  self &operator++() {
+    if (++index_ == node_->count) {
+      node_ = node_->next;
+      index_ = 0;
+    }
+    return *this;
+  }
+  self operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  self &operator--() {
+    if (index_ == 0) {
+      node_ = node_->prev;
+      index_ = node_->count;
+    }
+    --index_;
+    return *this;
+  }
+  self operator--(int) {
+    auto tmp = *this;
+    --*this;
+    return tmp;
+  }
+  reference operator*() const {
+    return static_cast<node_ptr>(node_)->data()[index_];
+  }
+  pointer operator->() const { return &(operator*()); }
+  bool operator==(const self &right) const {
+    return node_ == right.node_ && index_ == right.index_;
+  }
+  bool operator!=(const self &right) const { return !(*this == right); }
+};
+
+// 每个节点是一段, 段内是指针, algorithm.h中的分段算法据此在节点内跑紧凑循环.
+// 哨兵段为空段: begin == end == nullptr.
+template <class T, size_t K, class Ref, class Ptr>
+struct segmented_iterator_traits<unrolled_list_iterator<T, K, Ref, Ptr>> {
+  typedef true_type is_segmented_iterator;
+  typedef unrolled_list_iterator<T, K, Ref, Ptr> iterator;
+  typedef Ptr local_iterator;
+  struct segment_iterator {
+    Detail::unrolled_node_base *p;
+    segment_iterator &operator++() {
+      p = p->next;
+      return *this;
+    }
+    segment_iterator &operator--() {
+      p = p->prev;
+      return *this;
+    }
+    bool operator==(const segment_iterator &right) const {
+      return p == right.p;
+    }
+    bool operator!=(const segment_iterator &right) const {
+      return p != right.p;
+    }
+  };
+
+  static segment_iterator segment(const iterator &it) { return {it.node_}; }
+  static local_iterator local(const iterator &it) {
+    return begin(segment(it)) + it.index_;
+  }
+  static local_iterator begin(segment_iterator s) {
+    return s.p->count
+               ? static_cast<typename iterator::node_ptr>(s.p)->data()
+               : nullptr;
+  }
+  static local_iterator end(segment_iterator s) {
+    return s.p->count ? begin(s) + s.p->count : nullptr;
+  }
+  //落在段末尾时规范化到下一段的开头, 与operator++一致
+  static iterator compose(segment_iterator s, local_iterator l) {
+    if (s.p->count && l == end(s))
+      return iterator(s.p->next, 0);
+    return iterator(s.p, l - begin(s));
+  }
+};
+
+template <class T, size_t K = Detail::unrolled_list_default_k(sizeof(T)),
+          class Allocator = allocator<Detail::unrolled_node<T, K>>>
+class unrolled_list {
+  static_assert(K >= 2, "unrolled_list needs at least two elements per node");
+
+public:
+  typedef Allocator allocator_type;
+  typedef T value_type;
+  typedef unrolled_list_iterator<T, K, T &, T *> iterator;
+  typedef unrolled_list_iterator<T, K, const T &, const T *> const_iterator;
+  typedef mmm::reverse_iterator<iterator> reverse_iterator;
+  typedef mmm::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  static constexpr size_type node_capacity = K;
+
+private:
+  typedef Detail::unrolled_node_base *base_ptr;
+  typedef Detail::unrolled_node<T, K> *node_ptr;
+
+  Detail::unrolled_node_base head_; //哨兵
+  size_type size_;
+
+public:
+  unrolled_list() : size_(0) { reset(); }
+  explicit unrolled_list(size_type n, const value_type &val = value_type())
+      : unrolled_list() {
+    insert(end(), n, val);
+  }
+  template <class InputIterator>
+  unrolled_list(InputIterator first, InputIterator last) : unrolled_list() {
+    insert(end(), first, last);
+  }
+  unrolled_list(const unrolled_list &other) : unrolled_list() {
+    insert(end(), other.begin(), other.end());
+  }
+  unrolled_list(unrolled_list &&other) noexcept : unrolled_list() {
+    swap(other);
+  }
+  unrolled_list &operator=(unrolled_list other) {
+    swap(other);
+    return *this;
+  }
+  ~unrolled_list() { clear(); }
+
+  iterator begin() noexcept { return iterator(head_.next, 0); }
+  iterator end() noexcept { return iterator(&head_, 0); }
+  const_iterator begin() const noexcept { return const_iterator(head_.next, 0); }
+  const_iterator end() const noexcept {
+    return const_iterator(const_cast<base_ptr>(&head_), 0);
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *(--end()); }
+  const_reference back() const { return *(--end()); }
+
+  void push_back(const value_type &val) { emplace_back(val); }
+  void push_back(value_type &&val) { emplace_back(mmm::move(val)); }
+  void push_front(const value_type &val) { emplace_front(val); }
+  void push_front(value_type &&val) { emplace_front(mmm::move(val)); }
+  template <class... Args> reference emplace_back(Args &&... args) {
+    return *emplace(end(), mmm::forward<Args>(args)...);
+  }
+  template <class... Args> reference emplace_front(Args &&... args) {
+    return *emplace(begin(), mmm::forward<Args>(args)...);
+  }
+  void pop_back() { erase(--end()); }
+  void pop_front() { erase(begin()); }
+
+  template <class... Args>
+  iterator emplace(const_iterator position, Args &&... args);
+  iterator insert(const_iterator position, const value_type &val) {
+    return emplace(position, val);
+  }
+  iterator insert(const_iterator position, value_type &&val) {
+    return emplace(position, mmm::move(val));
+  }
+  void insert(const_iterator position, size_type n, const value_type &val) {
+    insert_aux(position, n, val, true_type());
+  }
+  template <class InputIterator>
+  void insert(const_iterator position, InputIterator first,
+              InputIterator last) {
+    insert_aux(position, first, last, is_integer<InputIterator>());
+  }
+  //返回被删除元素之后的位置
+  iterator erase(const_iterator position);
+  iterator erase(const_iterator first, const_iterator last);
+  void clear();
+  void swap(unrolled_list &x) noexcept;
+
+private:
+  void reset() {
+    head_.prev = head_.next = &head_;
+    head_.count = 0;
+  }
+  static T *data(base_ptr n) { return static_cast<node_ptr>(n)->data(); }
+  //在pos之前挂一个空节点
+  base_ptr insert_node(base_ptr pos) {
+    node_ptr n = allocator_type::allocate();
+    n->count = 0;
+    n->next = pos;
+    n->prev = pos->prev;
+    pos->prev->next = n;
+    pos->prev = n;
+    return n;
+  }
+  void delete_node(base_ptr n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    allocator_type::deallocate(static_cast<node_ptr>(n));
+  }
+  //把src的[first, last)移动构造到dst末尾
+  static void move_to_back(base_ptr dst, base_ptr src, size_type first,
+                           size_type last) {
+    T *d = data(dst) + dst->count;
+    T *s = data(src);
+    for (size_type i = first; i != last; ++i, ++d) {
+      new (d) T(mmm::move(s[i]));
+      s[i].~T();
+    }
+    dst->count += last - first;
+  }
+
+  void insert_aux(const_iterator position, size_type n, const value_type &val,
+                  true_type) {
+    iterator it(position.node_, position.index_);
+    for (; n != 0; --n) {
+      it = emplace(it, val);
+      ++it;
+    }
+  }
+  template <class InputIterator>
+  void insert_aux(const_iterator position, InputIterator first,
+                  InputIterator last, false_type) {
+    iterator it(position.node_, position.index_);
+    for (; first != last; ++first) {
+      it = emplace(it, *first);
+      ++it;
+    }
+  }
+}; // end of unrolled_list
+
+template <class T, size_t K, class Allocator>
+template <class... Args>
+typename unrolled_list<T, K, Allocator>::iterator
+unrolled_list<T, K, Allocator>::emplace(const_iterator position,
+                                        Args &&... args) {
+  base_ptr n = position.node_;
+  size_type i = position.index_;
+  if (i == 0 && n->prev != &head_ && n->prev->count < K) {
+    //节点开头(或末尾之后)插入时, 前一个节点有空位就放在它的末尾
+    n = n->prev;
+    i = n->count;
+  } else if (n == &head_) {
+    n = insert_node(&head_);
+    i = 0;
+  } else if (n->count == K) {
+    //分裂: 后一半搬到新节点
+    base_ptr m = insert_node(n->next);
+    move_to_back(m, n, K / 2, K);
+    n->count = K / 2;
+    if (i > K / 2) {
+      n = m;
+      i -= K / 2;
+    }
+  }
+  T *d = data(n);
+  const size_type c = n->count;
+  try {
+    if (i == c) {
+      new (d + c) T(mmm::forward<Args>(args)...);
+    } else {
+      value_type tmp(mmm::forward<Args>(args)...);
+      new (d + c) T(mmm::move(d[c - 1]));
+      for (size_type j = c - 1; j != i; --j)
+        d[j] = mmm::move(d[j - 1]);
+      d[i] = mmm::move(tmp);
+    }
+  } catch (...) {
+    //刚挂上的空节点要摘掉, 否则遍历会走进count为0的节点
+    if (c == 0)
+      delete_node(n);
+    throw;
+  }
+  ++n->count;
+  ++size_;
+  return iterator(n, i);
+}
+
+template <class T, size_t K, class Allocator>
+typename unrolled_list<T, K, Allocator>::iterator
+unrolled_list<T, K, Allocator>::erase(const_iterator position) {
+  base_ptr n = position.node_;
+  const size_type i = position.index_;
+  T *d = data(n);
+  for (size_type j = i + 1; j < n->count; ++j)
+    d[j - 1] = mmm::move(d[j]);
+  d[n->count - 1].~T();
+  --n->count;
+  --size_;
+  base_ptr next = n->next;
+  if (n->count == 0) {
+    delete_node(n);
+    return iterator(next, 0);
+  }
+  //不足半满且能装下后继时合并, 避免大量删除后节点稀疏
+  if (n->count < K / 2 && next != &head_ && n->count + next->count <= K) {
+    move_to_back(n, next, 0, next->count);
+    delete_node(next);
+  }
+  if (i < n->count)
+    return iterator(n, i);
+  return iterator(n->next, 0);
+}
+
+template <class T, size_t K, class Allocator>
+typename unrolled_list<T, K, Allocator>::iterator
+unrolled_list<T, K, Allocator>::erase(const_iterator first,
+                                      const_iterator last) {
+  //合并会使last失效, 先数出个数
+  size_type n = 0;
+  for (const_iterator it = first; it != last; ++it)
+    ++n;
+  iterator it(first.node_, first.index_);
+  while (n--)
+    it = erase(it);
+  return it;
+}
+
+template <class T, size_t K, class Allocator>
+void unrolled_list<T, K, Allocator>::clear() {
+  base_ptr n = head_.next;
+  while (n != &head_) {
+    base_ptr next = n->next;
+    T *d = data(n);
+    for (size_type i = 0; i != n->count; ++i)
+      d[i].~T();
+    allocator_type::deallocate(static_cast<node_ptr>(n));
+    n = next;
+  }
+  reset();
+  size_ = 0;
+}
+
+template <class T, size_t K, class Allocator>
+void unrolled_list<T, K, Allocator>::swap(unrolled_list &x) noexcept {
+  //哨兵在对象内部, 交换后要修正首尾节点指回哨兵的指针
+  mmm::swap(head_.prev, x.head_.prev);
+  mmm::swap(head_.next, x.head_.next);
+  mmm::swap(size_, x.size_);
+  if (head_.next == &x.head_)
+    reset();
+  else
+    head_.next->prev = head_.prev->next = &head_;
+  if (x.head_.next == &head_)
+    x.reset();
+  else
+    x.head_.next->prev = x.head_.prev->next = &x.head_;
+}
+
+template <class T, size_t K, class Allocator>
+inline void swap(unrolled_list<T, K, Allocator> &x,
+                 unrolled_list<T, K, Allocator> &y) noexcept {
+  x.swap(y);
+}
+
+template <class T, size_t K, class Allocator>
+bool operator==(const unrolled_list<T, K, Allocator> &lhs,
+                const unrolled_list<T, K, Allocator> &rhs) {
+  return lhs.size() == rhs.size() &&
+         mmm::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+template <class T, size_t K, class Allocator>
+bool operator!=(const unrolled_list<T, K, Allocator> &lhs,
+                const unrolled_list<T, K, Allocator> &rhs) {
+  return !(lhs == rhs);
+}
+template <class T, size_t K, class Allocator>
+bool operator<(const unrolled_list<T, K, Allocator> &lhs,
+               const unrolled_list<T, K, Allocator> &rhs) {
+  return mmm::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end());
+}
+
+} // namespace mmm
+
+#endif
@@ -3,6 +3,11 @@
 
 #include "type_traits.h"
 
+//缓存行大小. 并发容器用它把不同线程写的字段隔开, 避免伪共享
+#ifndef _MMM_CACHE_LINE_SIZE
+#define _MMM_CACHE_LINE_SIZE 64
+#endif
+
 namespace mmm{
 	//************ [swap] ***************
 	template<class T>
@@ -29,6 +34,13 @@ namespace mmm{
 	struct pair_first_construct_t {
 
 	};
+
+	//标记输入已按比较函数有序(且对唯一键容器没有重复键), 容器可直接批量构建
+	struct sorted_unique_t
+	{
+		explicit sorted_unique_t() = default;
+	};
+	constexpr sorted_unique_t sorted_unique{};
 }
 
 #endif
\ No newline at end of file
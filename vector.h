@@ -131,7 +131,23 @@ class vector{
 		}
 	}
 	void push_back(const value_type& value){
-		insert(end(), value);
+		if (finish_ != end_of_storage_){
+			::new (static_cast<void*>(finish_)) value_type(value);
+			++finish_;
+		}else{
+			insert(end(), value);
+		}
+	}
+	//右值: 有空位时直接移动构造到末尾. 扩容前先移到局部, value可能就是自身的元素
+	void push_back(value_type&& value){
+		if (finish_ == end_of_storage_){
+			value_type tmp(mmm::move(value));
+			reserve(get_new_capacity(1));
+			::new (static_cast<void*>(finish_)) value_type(mmm::move(tmp));
+		}else{
+			::new (static_cast<void*>(finish_)) value_type(mmm::move(value));
+		}
+		++finish_;
 	}
 	void pop_back(){
 		--finish_;
@@ -283,11 +299,20 @@ void vector<T, Alloc>::insert_aux(iterator position, size_type n, const value_ty
 	difference_type need = n;
 	//enough
 	if (end_of_storage_ - finish_ >= need){
-		//后移
-    mmm::copy_backward(position,finish_ ,finish_+ need);
-		//填充
-		mmm::uninitialized_fill_n(position, need, value);
-		finish_ += need;
+		//先复制value(可能引用自身的元素, 复制也可能抛出), 再后移.
+		//末尾未初始化的部分用构造, 已有元素的位置用赋值
+		value_type copy(value);
+		const difference_type elems_after = finish_ - position;
+		iterator old_finish = finish_;
+		if (elems_after > need){
+			finish_ = mmm::uninitialized_copy(finish_ - need, finish_, finish_);
+			mmm::copy_backward(position, old_finish - need, old_finish);
+			mmm::fill(position, position + need, copy);
+		}else{
+			finish_ = mmm::uninitialized_fill_n(finish_, need - elems_after, copy);
+			finish_ = mmm::uninitialized_copy(position, old_finish, finish_);
+			mmm::fill(position, old_finish, copy);
+		}
 	}
 	else{
 		// not enough
@@ -0,0 +1,157 @@
+#ifndef _WORK_STEALING_DEQUE_H_
+#define _WORK_STEALING_DEQUE_H_
+
+#include "allocator.h"
+#include "utility.h"
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+
+namespace mmm {
+
+// work_stealing_deque: Chase-Lev工作窃取双端队列(按Lê等人的C11内存序版本).
+// 所有者在bottom端push/pop(LIFO), 其它线程从top端steal(FIFO).
+// 所有者push不需要原子读-改-写; 只有pop取最后一个元素、或steal时才用CAS争top.
+// 存储是2的幂长度的环形数组, 下标不回绕, 用掩码取槽位. 满了之后换成两倍大的数组,
+// 只复制[top, bottom)之间的元素; 窃取者可能还在读旧数组, 所以旧数组挂在retired_链上,
+// 析构时才释放(与deque换map时只搬指针、不动旧块的思路相同).
+// 元素要在并发下按值读写, 因此T须是可平凡复制的(通常是任务指针).
+template <class T> class work_stealing_deque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "work_stealing_deque requires a trivially copyable T");
+
+public:
+  typedef T value_type;
+  typedef size_t size_type;
+
+private:
+  struct ring {
+    ptrdiff_t mask_;
+    std::atomic<T> *slots_;
+    ring *retired_; //更早的(已被替换的)数组
+
+    T get(ptrdiff_t i) const {
+      return slots_[i & mask_].load(std::memory_order_relaxed);
+    }
+    void put(ptrdiff_t i, T x) {
+      slots_[i & mask_].store(x, std::memory_order_relaxed);
+    }
+  };
+  typedef allocator<ring> ringAllocator;
+  typedef allocator<std::atomic<T>> slotAllocator;
+
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<ptrdiff_t> top_;
+  alignas(_MMM_CACHE_LINE_SIZE) std::atomic<ptrdiff_t> bottom_;
+  std::atomic<ring *> ring_;
+
+public:
+  explicit work_stealing_deque(size_type capacity = 64) : top_(0), bottom_(0) {
+    size_type len = 2;
+    while (len < capacity)
+      len <<= 1;
+    ring_.store(create_ring(len, nullptr), std::memory_order_relaxed);
+  }
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+  ~work_stealing_deque() {
+    ring *r = ring_.load(std::memory_order_relaxed);
+    while (r) {
+      ring *prev = r->retired_;
+      destroy_ring(r);
+      r = prev;
+    }
+  }
+
+  //所有者线程
+  void push(const value_type &x);
+  bool pop(value_type &out);
+  //任意线程. 与其它窃取者或所有者竞争失败时也返回false
+  bool steal(value_type &out);
+
+  //并发时只是一个近似值
+  size_type size() const noexcept {
+    const ptrdiff_t b = bottom_.load(std::memory_order_relaxed);
+    const ptrdiff_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? size_type(b - t) : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+  size_type capacity() const noexcept {
+    return ring_.load(std::memory_order_relaxed)->mask_ + 1;
+  }
+
+private:
+  static ring *create_ring(size_type len, ring *retired) {
+    ring *r = ringAllocator::allocate();
+    r->mask_ = ptrdiff_t(len) - 1;
+    r->slots_ = slotAllocator::allocate(len);
+    for (size_type i = 0; i != len; ++i)
+      new (r->slots_ + i) std::atomic<T>();
+    r->retired_ = retired;
+    return r;
+  }
+  static void destroy_ring(ring *r) {
+    slotAllocator::deallocate(r->slots_, r->mask_ + 1);
+    ringAllocator::deallocate(r);
+  }
+  //数组满了: 换成两倍大小, 旧数组留给可能还在读它的窃取者
+  ring *grow(ring *old, ptrdiff_t top, ptrdiff_t bottom) {
+    ring *r = create_ring(size_type(old->mask_ + 1) * 2, old);
+    for (ptrdiff_t i = top; i != bottom; ++i)
+      r->put(i, old->get(i));
+    ring_.store(r, std::memory_order_release);
+    return r;
+  }
+}; // end of work_stealing_deque
+
+template <class T> void work_stealing_deque<T>::push(const value_type &x) {
+  const ptrdiff_t b = bottom_.load(std::memory_order_relaxed);
+  const ptrdiff_t t = top_.load(std::memory_order_acquire);
+  ring *r = ring_.load(std::memory_order_relaxed);
+  if (b - t > r->mask_)
+    r = grow(r, t, b);
+  r->put(b, x);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+template <class T> bool work_stealing_deque<T>::pop(value_type &out) {
+  const ptrdiff_t b = bottom_.load(std::memory_order_relaxed) - 1;
+  ring *r = ring_.load(std::memory_order_relaxed);
+  bottom_.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ptrdiff_t t = top_.load(std::memory_order_relaxed);
+  if (t > b) {
+    //空
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+  out = r->get(b);
+  if (t == b) {
+    //最后一个元素, 与窃取者争抢
+    const bool won = top_.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+template <class T> bool work_stealing_deque<T>::steal(value_type &out) {
+  ptrdiff_t t = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const ptrdiff_t b = bottom_.load(std::memory_order_acquire);
+  if (t >= b)
+    return false;
+  ring *r = ring_.load(std::memory_order_acquire);
+  const T x = r->get(t);
+  if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
+    return false;
+  out = x;
+  return true;
+}
+
+} // namespace mmm
+
+#endif